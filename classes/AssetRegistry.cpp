@@ -0,0 +1,153 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#include "AssetRegistry.h"
+
+#include <map>
+#include <mutex>
+#include <functional>
+#include <iostream>
+
+#include "Shader.h"
+#include "Model.h"
+#include "Skybox.h"
+#include "FileWatcher.h"
+
+template <typename T>
+using AssetCache = std::map<std::string, std::weak_ptr<T>>;
+
+static AssetCache<Texture2D> textures;
+static AssetCache<Shader> shaders;
+static AssetCache<Model> models;
+static AssetCache<Skybox> skyboxes;
+
+// Deletions waiting for the frame boundary, the last handle can be dropped on any thread
+static std::mutex pendingMutex;
+static std::vector<std::function<void()>> pending;
+
+template <typename T, typename Load>
+static AssetHandle<T> acquire(AssetCache<T> &cache, const std::string &key, Load load) {
+    auto it = cache.find(key);
+    if(it != cache.end())
+    {
+        AssetHandle<T> asset = it->second.lock();
+        if(asset)
+            return asset;
+    }
+    T *loaded = load();
+    // A failed load isn't cached, the next request tries again
+    if(loaded == nullptr)
+        return AssetHandle<T>();
+    AssetHandle<T> asset(loaded, [](T *resource) {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        pending.push_back([resource]() {
+            resource->del();
+            delete resource;
+        });
+    });
+    cache[key] = asset;
+    return asset;
+}
+
+AssetHandle<Texture2D> assetTexture(const std::string &path, texType type, GLenum wrapping, GLenum filtering) {
+    std::string key = FileWatcher::canonicalPath(path) + '|' + std::to_string(type) + '|' + std::to_string(wrapping)
+                      + '|' + std::to_string(filtering);
+    return acquire(textures, key, [&]() {
+        return new Texture2D(path, type, wrapping, filtering);
+    });
+}
+
+AssetHandle<Texture2D> assetTexture(const std::string &path, texType type, const ImageData &image, GLenum wrapping, GLenum filtering) {
+    std::string key = FileWatcher::canonicalPath(path) + '|' + std::to_string(type) + '|' + std::to_string(wrapping)
+                      + '|' + std::to_string(filtering);
+    return acquire(textures, key, [&]() {
+        return Texture2D::create(image, path, type, wrapping, filtering);
+    });
+}
+
+AssetHandle<Shader> assetShader(const std::string &vertexShaderPath, const std::string &fragmentShaderPath) {
+    std::string key = FileWatcher::canonicalPath(vertexShaderPath) + '|' + FileWatcher::canonicalPath(fragmentShaderPath);
+    return acquire(shaders, key, [&]() {
+        return new Shader(vertexShaderPath, fragmentShaderPath);
+    });
+}
+
+AssetHandle<Model> assetModel(const std::string &path, bool keepGeometry) {
+    std::string key = FileWatcher::canonicalPath(path) + (keepGeometry ? "|geometry" : "");
+    return acquire(models, key, [&]() {
+        return new Model(path, keepGeometry);
+    });
+}
+
+AssetHandle<Skybox> assetSkybox(const std::vector<std::string> &facePaths) {
+    std::string key;
+    for(const std::string &path : facePaths)
+        key += FileWatcher::canonicalPath(path) + '|';
+    return acquire(skyboxes, key, [&]() {
+        return new Skybox(facePaths);
+    });
+}
+
+template <typename T>
+static void prune(AssetCache<T> &cache) {
+    for(auto it = cache.begin(); it != cache.end();)
+    {
+        if(it->second.expired())
+            it = cache.erase(it);
+        else
+            ++it;
+    }
+}
+
+void assetCollect() {
+    bool collected = false;
+    // Deleting a model drops the handles of its textures, those get deleted in the next round
+    for(;;)
+    {
+        std::vector<std::function<void()>> batch;
+        {
+            std::lock_guard<std::mutex> lock(pendingMutex);
+            batch.swap(pending);
+        }
+        if(batch.empty())
+            break;
+        for(auto &deletion : batch)
+            deletion();
+        collected = true;
+    }
+    if(!collected)
+        return;
+    prune(textures);
+    prune(shaders);
+    prune(models);
+    prune(skyboxes);
+}
+
+template <typename T>
+static void reportHeld(const AssetCache<T> &cache, const char *kind) {
+    for(auto &it : cache)
+        if(!it.second.expired())
+            std::cerr << kind << " " << it.first << " still in use at shutdown" << std::endl;
+}
+
+void assetShutdown() {
+    assetCollect();
+    reportHeld(textures, "Texture");
+    reportHeld(shaders, "Shader");
+    reportHeld(models, "Model");
+    reportHeld(skyboxes, "Skybox");
+}
+
+size_t assetCount() {
+    size_t count = 0;
+    for(auto &it : textures)
+        count += !it.second.expired();
+    for(auto &it : shaders)
+        count += !it.second.expired();
+    for(auto &it : models)
+        count += !it.second.expired();
+    for(auto &it : skyboxes)
+        count += !it.second.expired();
+    return count;
+}
@@ -0,0 +1,44 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#ifndef RG_3D_SAH_ASSETREGISTRY_H
+#define RG_3D_SAH_ASSETREGISTRY_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <glad/glad.h>
+
+#include "Texture2D.h"
+
+class Shader;
+class Model;
+class Skybox;
+
+// Shared reference to a resource held by the registry, copying one is cheap. When the last handle of a
+// resource goes away its GL objects are deleted by the next assetCollect()
+template <typename T>
+using AssetHandle = std::shared_ptr<T>;
+
+// Process wide cache of GL resources keyed by canonical path and import options, asking for a resource that's
+// already loaded hands out the same one again. Resources are created on the thread owning the GL context,
+// handles may be dropped anywhere
+AssetHandle<Texture2D> assetTexture(const std::string &path, texType type, GLenum wrapping = GL_REPEAT, GLenum filtering = GL_LINEAR);
+// Same, but a texture not loaded yet is made from an image already decoded off the GL thread. An image that
+// can't be uploaded gives an empty handle instead of exiting
+AssetHandle<Texture2D> assetTexture(const std::string &path, texType type, const ImageData &image,
+                                    GLenum wrapping = GL_REPEAT, GLenum filtering = GL_LINEAR);
+AssetHandle<Shader> assetShader(const std::string &vertexShaderPath, const std::string &fragmentShaderPath);
+// A model kept with its geometry on the CPU is a different resource from the same file without it
+AssetHandle<Model> assetModel(const std::string &path, bool keepGeometry = false);
+AssetHandle<Skybox> assetSkybox(const std::vector<std::string> &facePaths);
+
+// Deletes the resources whose last handle went away, called between frames on the GL thread
+void assetCollect();
+// Collects everything released and reports resources still held, called before the GL context goes away
+void assetShutdown();
+// Resources currently loaded
+size_t assetCount();
+
+#endif //RG_3D_SAH_ASSETREGISTRY_H
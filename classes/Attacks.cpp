@@ -0,0 +1,164 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#include "Attacks.h"
+
+Bitboard knightAttackTable[64];
+Bitboard kingAttackTable[64];
+Bitboard pawnAttackTable[2][64];
+Magic bishopMagics[64];
+Magic rookMagics[64];
+Bitboard betweenTable[64][64];
+Bitboard lineTable[64][64];
+
+// Every square gets its own slice of these, sized by the number of relevant blocker subsets
+static Bitboard bishopTable[5248];
+static Bitboard rookTable[102400];
+
+static const int bishopDirections[4][2] = {{1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+static const int rookDirections[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+
+static Bitboard slidingAttacks(int square, Bitboard occupancy, const int directions[4][2]) {
+    Bitboard attacks = 0;
+    for(int d = 0; d < 4; d++)
+    {
+        int file = fileOf(square) + directions[d][0];
+        int rank = rankOf(square) + directions[d][1];
+        while(file >= 0 && file < 8 && rank >= 0 && rank < 8)
+        {
+            Bitboard b = squareBB(makeSquare(file, rank));
+            attacks |= b;
+            if(occupancy & b)
+                break;
+            file += directions[d][0];
+            rank += directions[d][1];
+        }
+    }
+    return attacks;
+}
+
+static Bitboard stepAttacks(int square, const int steps[][2], int count) {
+    Bitboard attacks = 0;
+    for(int i = 0; i < count; i++)
+    {
+        int file = fileOf(square) + steps[i][0];
+        int rank = rankOf(square) + steps[i][1];
+        if(file >= 0 && file < 8 && rank >= 0 && rank < 8)
+            attacks |= squareBB(makeSquare(file, rank));
+    }
+    return attacks;
+}
+
+// Found once by trying sparse random numbers until one maps every blocker subset without a harmful collision,
+// searching for them on every start took longer than the rest of the startup
+static const Bitboard bishopMagicNumbers[64] = {
+        0x0020428400408200ULL, 0x2008010104210004ULL, 0x02D0009200480190ULL, 0x0018158B00010100ULL,
+        0x02C4042132048008ULL, 0x020082202000C221ULL, 0x4000421050080009ULL, 0x0210140202022020ULL,
+        0x00C0101410042248ULL, 0x0405204800D48080ULL, 0x3800C89200420002ULL, 0x180844124A020440ULL,
+        0x04403410A8002221ULL, 0x4040209004200400ULL, 0x084004020202A204ULL, 0x3010002104022000ULL,
+        0x00200240A9110900ULL, 0x2302800404080210ULL, 0x0204188800240010ULL, 0x8048000C01401200ULL,
+        0x120C001A11040900ULL, 0x0000401200500440ULL, 0x00004040840420A0ULL, 0x0020930822880804ULL,
+        0x4044401090900161ULL, 0x0034100015210804ULL, 0x8004100009010120ULL, 0x48C8080000820500ULL,
+        0x0080848004002000ULL, 0x0801004012005044ULL, 0x000080902C040400ULL, 0x0004009005004100ULL,
+        0x0B103010048A0200ULL, 0x8004100203181A00ULL, 0x0800140200100080ULL, 0x8401010800910040ULL,
+        0x0840010011290040ULL, 0x40100214202E1000ULL, 0x0842040040010840ULL, 0x0028010040010860ULL,
+        0x00080202A2051000ULL, 0x4200841008084204ULL, 0x0021120110000D02ULL, 0x48C1004208000084ULL,
+        0x0010088100414400ULL, 0x0021101000420580ULL, 0x0010040558401410ULL, 0x200C0C82A1050205ULL,
+        0x0011108820088000ULL, 0x0001011910120402ULL, 0x1580008608091248ULL, 0x8010018020880C02ULL,
+        0x20A1101032088480ULL, 0x0080100408082800ULL, 0x28100401140401C0ULL, 0x8002102200930012ULL,
+        0x4001040082080200ULL, 0x082200A498081808ULL, 0x000508610080D003ULL, 0x0052020044842402ULL,
+        0x4800A00140C84840ULL, 0x5000000848080820ULL, 0x0101086004240040ULL, 0x0028280808005014ULL
+};
+
+static const Bitboard rookMagicNumbers[64] = {
+        0x008000908064C000ULL, 0x0040200040001000ULL, 0x0180100080A0010AULL, 0x8880041000800800ULL,
+        0x1200100201200804ULL, 0x0200020004011008ULL, 0x2180010000800600ULL, 0x0200005088210204ULL,
+        0x0400800040008021ULL, 0x0400400020005000ULL, 0x8240801000200080ULL, 0x8611001004200900ULL,
+        0x008180800C001800ULL, 0x0100800200800400ULL, 0x0A02000102000408ULL, 0x8020802300104280ULL,
+        0x0080004000402000ULL, 0xE010104000402000ULL, 0x0800808010002000ULL, 0xA280210008100100ULL,
+        0x0001818014000800ULL, 0xA002010100080400ULL, 0x0080240001020870ULL, 0x0001020004048845ULL,
+        0x0081826280004004ULL, 0x2020810900284000ULL, 0x0200100080802000ULL, 0x0200080080100080ULL,
+        0x8083080100100500ULL, 0x4406000901000400ULL, 0x0005020080800100ULL, 0x0090204200008114ULL,
+        0x0010400094800420ULL, 0x0900804000802002ULL, 0x0201001841002000ULL, 0x4100080080801000ULL,
+        0x4540040080800800ULL, 0x0002001004040020ULL, 0x0281195814001002ULL, 0x1240800040800100ULL,
+        0x0880042000524004ULL, 0x02C080410206002CULL, 0x0801200241050010ULL, 0x8400080010008080ULL,
+        0x0008000500090010ULL, 0x0082009084020008ULL, 0x4012000108020004ULL, 0x9000104D08860004ULL,
+        0x2004204114800100ULL, 0x0148802112400300ULL, 0x0202842000100880ULL, 0x001B080080900080ULL,
+        0x001A002008100600ULL, 0x0004008004020080ULL, 0x5181000600040300ULL, 0x0000044401128A00ULL,
+        0x8044110480002441ULL, 0x2008110084402202ULL, 0x90806005090010C1ULL, 0x000420310A004A42ULL,
+        0x0023001004020801ULL, 0x0882001008040102ULL, 0x000230088118020CULL, 0x0000019025040042ULL
+};
+
+static void initMagics(Magic magics[64], const Bitboard magicNumbers[64], Bitboard *table, const int directions[4][2]) {
+    Bitboard *next = table;
+    for(int square = 0; square < 64; square++)
+    {
+        // Blockers on the board edge never change the attacks, so they're left out of the mask
+        Bitboard edges = ((RANK_1 | RANK_8) & ~(rankOf(square) == 0 ? RANK_1 : rankOf(square) == 7 ? RANK_8 : 0)) |
+                         ((FILE_A | FILE_H) & ~(fileOf(square) == 0 ? FILE_A : fileOf(square) == 7 ? FILE_H : 0));
+        Magic &m = magics[square];
+        m.mask = slidingAttacks(square, 0, directions) & ~edges;
+        m.shift = 64 - popCount(m.mask);
+        m.magic = magicNumbers[square];
+        m.attacks = next;
+
+        // Enumerate all subsets of the mask with the carry rippler trick
+        Bitboard subset = 0;
+        do
+        {
+            next[m.index(subset)] = slidingAttacks(square, subset, directions);
+            subset = (subset - m.mask) & m.mask;
+        } while(subset);
+        next += 1ULL << popCount(m.mask);
+    }
+}
+
+void initAttacks() {
+    static bool initialized = false;
+    if(initialized)
+        return;
+    initialized = true;
+
+    const int knightSteps[8][2] = {{1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}};
+    const int kingSteps[8][2] = {{1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1}, {0, -1}, {1, -1}};
+    const int whitePawnSteps[2][2] = {{-1, 1}, {1, 1}};
+    const int blackPawnSteps[2][2] = {{-1, -1}, {1, -1}};
+    for(int square = 0; square < 64; square++)
+    {
+        knightAttackTable[square] = stepAttacks(square, knightSteps, 8);
+        kingAttackTable[square] = stepAttacks(square, kingSteps, 8);
+        pawnAttackTable[WHITE][square] = stepAttacks(square, whitePawnSteps, 2);
+        pawnAttackTable[BLACK][square] = stepAttacks(square, blackPawnSteps, 2);
+    }
+
+    initMagics(bishopMagics, bishopMagicNumbers, bishopTable, bishopDirections);
+    initMagics(rookMagics, rookMagicNumbers, rookTable, rookDirections);
+
+    for(int a = 0; a < 64; a++)
+    {
+        for(int b = 0; b < 64; b++)
+        {
+            betweenTable[a][b] = lineTable[a][b] = 0;
+            if(a == b)
+                continue;
+            Bitboard bb = squareBB(b);
+            if(slidingAttacks(a, 0, bishopDirections) & bb)
+            {
+                betweenTable[a][b] = slidingAttacks(a, bb, bishopDirections) & slidingAttacks(b, squareBB(a), bishopDirections);
+                lineTable[a][b] = (slidingAttacks(a, 0, bishopDirections) & slidingAttacks(b, 0, bishopDirections)) | squareBB(a) | bb;
+            }
+            else if(slidingAttacks(a, 0, rookDirections) & bb)
+            {
+                betweenTable[a][b] = slidingAttacks(a, bb, rookDirections) & slidingAttacks(b, squareBB(a), rookDirections);
+                lineTable[a][b] = (slidingAttacks(a, 0, rookDirections) & slidingAttacks(b, 0, rookDirections)) | squareBB(a) | bb;
+            }
+        }
+    }
+}
+
+static struct AttacksInitializer {
+    AttacksInitializer() {
+        initAttacks();
+    }
+} attacksInitializer;
@@ -0,0 +1,70 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#ifndef RG_3D_SAH_ATTACKS_H
+#define RG_3D_SAH_ATTACKS_H
+
+#include "ChessTypes.h"
+#include "Bitboard.h"
+
+// Sliding attacks are looked up with magic bitboards: the relevant blockers are multiplied by a magic
+// number and the top bits of the product index a table of precomputed attack sets
+struct Magic {
+    Bitboard mask;
+    Bitboard magic;
+    const Bitboard *attacks;
+    unsigned shift;
+
+    unsigned index(Bitboard occupancy) const {
+        return (unsigned)(((occupancy & mask) * magic) >> shift);
+    }
+};
+
+extern Bitboard knightAttackTable[64];
+extern Bitboard kingAttackTable[64];
+extern Bitboard pawnAttackTable[2][64];
+extern Magic bishopMagics[64];
+extern Magic rookMagics[64];
+// Squares strictly between two aligned squares, and the whole line through them
+extern Bitboard betweenTable[64][64];
+extern Bitboard lineTable[64][64];
+
+// The tables are filled in by a static initializer, this only needs to be called from other static initializers
+void initAttacks();
+
+inline Bitboard knightAttacks(int square) {
+    return knightAttackTable[square];
+}
+
+inline Bitboard kingAttacks(int square) {
+    return kingAttackTable[square];
+}
+
+inline Bitboard pawnAttacks(color c, int square) {
+    return pawnAttackTable[c][square];
+}
+
+inline Bitboard bishopAttacks(int square, Bitboard occupancy) {
+    const Magic &m = bishopMagics[square];
+    return m.attacks[m.index(occupancy)];
+}
+
+inline Bitboard rookAttacks(int square, Bitboard occupancy) {
+    const Magic &m = rookMagics[square];
+    return m.attacks[m.index(occupancy)];
+}
+
+inline Bitboard queenAttacks(int square, Bitboard occupancy) {
+    return bishopAttacks(square, occupancy) | rookAttacks(square, occupancy);
+}
+
+inline Bitboard betweenBB(int from, int to) {
+    return betweenTable[from][to];
+}
+
+inline Bitboard lineBB(int from, int to) {
+    return lineTable[from][to];
+}
+
+#endif //RG_3D_SAH_ATTACKS_H
@@ -0,0 +1,195 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+// Registrars in other files may run before anything here is initialized, the list is built on first use
+static std::vector<BenchScenario> &scenarios() {
+    static std::vector<BenchScenario> list;
+    return list;
+}
+
+void benchRegister(const BenchScenario &scenario) {
+    scenarios().push_back(scenario);
+}
+
+std::vector<std::string> benchNames() {
+    std::vector<std::string> names;
+    for(const BenchScenario &scenario : scenarios())
+        names.push_back(scenario.name);
+    return names;
+}
+
+static BenchStats summarize(const BenchScenario &scenario, std::vector<double> samples, uint64_t items) {
+    BenchStats stats;
+    stats.name = scenario.name;
+    stats.unit = scenario.unit;
+    stats.repetitions = (int)samples.size();
+    stats.items = items;
+    std::sort(samples.begin(), samples.end());
+    size_t n = samples.size();
+    stats.median = n % 2 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+    stats.min = samples.front();
+    stats.max = samples.back();
+    for(double s : samples)
+        stats.mean += s;
+    stats.mean /= n;
+    if(n > 1)
+    {
+        double squares = 0;
+        for(double s : samples)
+            squares += (s - stats.mean) * (s - stats.mean);
+        stats.stddev = std::sqrt(squares / (n - 1));
+        stats.ci95 = 1.96 * stats.stddev / std::sqrt((double)n);
+    }
+    if(items && stats.median > 0)
+        stats.rate = items / stats.median;
+    return stats;
+}
+
+static std::string formatSeconds(double seconds) {
+    std::ostringstream out;
+    out << std::fixed;
+    if(seconds >= 1)
+        out << std::setprecision(3) << seconds << " s";
+    else if(seconds >= 1e-3)
+        out << std::setprecision(3) << seconds * 1e3 << " ms";
+    else
+        out << std::setprecision(3) << seconds * 1e6 << " us";
+    return out.str();
+}
+
+std::vector<BenchStats> benchRun(const BenchOptions &options, std::ostream &log) {
+    std::vector<BenchStats> results;
+    std::ios::fmtflags flags = log.flags();
+    std::streamsize precision = log.precision();
+    for(const BenchScenario &scenario : scenarios())
+    {
+        if(!options.filter.empty() && options.filter != "all" && scenario.name.find(options.filter) == std::string::npos)
+            continue;
+        if(scenario.setup && !scenario.setup())
+        {
+            log << std::left << std::setw(32) << scenario.name << std::right << "skipped" << std::endl;
+            continue;
+        }
+        std::vector<double> samples;
+        uint64_t items = 0;
+        for(int r = 0; r < options.warmup + options.repetitions; r++)
+        {
+            if(scenario.before)
+                scenario.before();
+            auto start = std::chrono::steady_clock::now();
+            items = scenario.run();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if(r >= options.warmup)
+                samples.push_back(seconds);
+        }
+        if(scenario.teardown)
+            scenario.teardown();
+        if(samples.empty())
+            continue;
+        BenchStats stats = summarize(scenario, samples, items);
+        log << std::left << std::setw(32) << stats.name << std::right << std::setw(12) << formatSeconds(stats.median)
+            << "  +-" << std::setw(11) << std::left << formatSeconds(stats.ci95) << std::right
+            << "  min " << std::setw(12) << formatSeconds(stats.min);
+        if(stats.rate > 0)
+            log << std::fixed << std::setprecision(2) << std::setw(12) << stats.rate / 1e6 << " M " << stats.unit << "/s";
+        log << std::endl;
+        log.flags(flags);
+        log.precision(precision);
+        results.push_back(stats);
+    }
+    return results;
+}
+
+bool benchWriteJson(const std::string &path, const std::vector<BenchStats> &results) {
+    FILE *out = fopen(path.c_str(), "w");
+    if(out == nullptr)
+        return false;
+    fprintf(out, "{\"hardware_threads\":%u,\"scenarios\":[", std::thread::hardware_concurrency());
+    for(size_t i = 0; i < results.size(); i++)
+    {
+        const BenchStats &s = results[i];
+        // Names and units are identifiers chosen in the code, nothing in them needs escaping
+        fprintf(out, "%s\n{\"name\":\"%s\",\"unit\":\"%s\",\"repetitions\":%d,\"median\":%.9g,\"mean\":%.9g,\"min\":%.9g,"
+                     "\"max\":%.9g,\"stddev\":%.9g,\"ci95\":%.9g,\"items\":%llu,\"rate\":%.9g}",
+                i ? "," : "", s.name.c_str(), s.unit.c_str(), s.repetitions, s.median, s.mean, s.min, s.max, s.stddev,
+                s.ci95, (unsigned long long)s.items, s.rate);
+    }
+    fprintf(out, "\n]}\n");
+    return fclose(out) == 0;
+}
+
+// Reads back what benchWriteJson wrote, every scenario object is on a line of its own
+bool benchReadJson(const std::string &path, std::vector<BenchStats> &results) {
+    std::ifstream in(path);
+    if(!in)
+        return false;
+    std::string line;
+    auto field = [&line](const char *key) -> const char * {
+        std::string quoted = std::string("\"") + key + "\":";
+        size_t at = line.find(quoted);
+        return at == std::string::npos ? nullptr : line.c_str() + at + quoted.size();
+    };
+    while(std::getline(in, line))
+    {
+        const char *name = field("name"), *median = field("median");
+        if(name == nullptr || median == nullptr || *name != '"')
+            continue;
+        BenchStats stats;
+        const char *end = strchr(name + 1, '"');
+        if(end == nullptr)
+            continue;
+        stats.name.assign(name + 1, end);
+        stats.median = strtod(median, nullptr);
+        if(const char *value = field("ci95"))
+            stats.ci95 = strtod(value, nullptr);
+        if(const char *value = field("min"))
+            stats.min = strtod(value, nullptr);
+        if(const char *value = field("rate"))
+            stats.rate = strtod(value, nullptr);
+        results.push_back(stats);
+    }
+    return true;
+}
+
+int benchCompare(const std::vector<BenchStats> &baseline, const std::vector<BenchStats> &current, double thresholdPercent,
+                 std::ostream &out) {
+    int regressions = 0;
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    for(const BenchStats &now : current)
+    {
+        auto before = std::find_if(baseline.begin(), baseline.end(), [&now](const BenchStats &b) {
+            return b.name == now.name;
+        });
+        out << std::left << std::setw(32) << now.name << std::right;
+        if(before == baseline.end() || before->median <= 0)
+        {
+            out << "  not in the baseline" << std::endl;
+            continue;
+        }
+        double change = (now.median / before->median - 1) * 100;
+        bool slower = change > thresholdPercent && now.median - now.ci95 > before->median + before->ci95;
+        bool faster = -change > thresholdPercent && now.median + now.ci95 < before->median - before->ci95;
+        out << std::setw(12) << formatSeconds(before->median) << " -> " << std::setw(12) << formatSeconds(now.median)
+            << std::fixed << std::setprecision(1) << std::showpos << std::setw(8) << change << "%" << std::noshowpos
+            << (slower ? "  REGRESSION" : faster ? "  faster" : "") << std::endl;
+        out.flags(flags);
+        out.precision(precision);
+        regressions += slower;
+    }
+    return regressions;
+}
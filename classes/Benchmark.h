@@ -0,0 +1,70 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#ifndef RG_3D_SAH_BENCHMARK_H
+#define RG_3D_SAH_BENCHMARK_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <functional>
+#include <cstdint>
+
+// One measured piece of work. run() is timed as a whole and returns how many items it processed (nodes,
+// bytes, frames...) for a rate, 0 if that means nothing. setup() runs once before the warmup, returning false
+// skips the scenario, e.g. when an asset is missing. before() runs untimed ahead of every repetition
+struct BenchScenario {
+    std::string name;
+    std::string unit;
+    std::function<uint64_t()> run;
+    std::function<bool()> setup;
+    std::function<void()> before;
+    std::function<void()> teardown;
+};
+
+// Scenarios are named group/what, e.g. search/depth-10, and run in the order they were registered
+void benchRegister(const BenchScenario &scenario);
+
+// Registers a scenario from a namespace scope object, so a file adds its scenarios just by being linked in
+struct BenchRegistrar {
+    explicit BenchRegistrar(const BenchScenario &scenario) {
+        benchRegister(scenario);
+    }
+};
+
+struct BenchOptions {
+    // Substring of the names to run, empty runs everything
+    std::string filter;
+    int warmup = 1;
+    int repetitions = 5;
+};
+
+// Summary over the timed repetitions, in seconds
+struct BenchStats {
+    std::string name;
+    std::string unit;
+    int repetitions = 0;
+    double median = 0;
+    double mean = 0;
+    double min = 0;
+    double max = 0;
+    double stddev = 0;
+    // Half width of the 95% confidence interval of the mean
+    double ci95 = 0;
+    uint64_t items = 0;
+    // Items per second at the median
+    double rate = 0;
+};
+
+std::vector<std::string> benchNames();
+std::vector<BenchStats> benchRun(const BenchOptions &options, std::ostream &log);
+
+bool benchWriteJson(const std::string &path, const std::vector<BenchStats> &results);
+bool benchReadJson(const std::string &path, std::vector<BenchStats> &results);
+// Prints every scenario against the baseline and returns how many got slower by more than thresholdPercent.
+// Only a median that's out even past the noise of both runs counts
+int benchCompare(const std::vector<BenchStats> &baseline, const std::vector<BenchStats> &current, double thresholdPercent,
+                 std::ostream &out);
+
+#endif //RG_3D_SAH_BENCHMARK_H
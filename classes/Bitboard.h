@@ -0,0 +1,38 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#ifndef RG_3D_SAH_BITBOARD_H
+#define RG_3D_SAH_BITBOARD_H
+
+#include "ChessTypes.h"
+
+const Bitboard FILE_A = 0x0101010101010101ULL;
+const Bitboard FILE_H = FILE_A << 7;
+const Bitboard RANK_1 = 0xFFULL;
+const Bitboard RANK_8 = RANK_1 << 56;
+
+inline Bitboard squareBB(int square) {
+    return 1ULL << square;
+}
+
+inline int popCount(Bitboard b) {
+    return __builtin_popcountll(b);
+}
+
+// Index of the least significant set bit, b must not be empty
+inline int lsb(Bitboard b) {
+    return __builtin_ctzll(b);
+}
+
+inline int popLsb(Bitboard &b) {
+    int square = lsb(b);
+    b &= b - 1;
+    return square;
+}
+
+inline bool moreThanOne(Bitboard b) {
+    return (b & (b - 1)) != 0;
+}
+
+#endif //RG_3D_SAH_BITBOARD_H
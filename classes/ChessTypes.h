@@ -0,0 +1,108 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#ifndef RG_3D_SAH_CHESSTYPES_H
+#define RG_3D_SAH_CHESSTYPES_H
+
+#include <cstdint>
+
+enum type {
+    PAWN,
+    KNIGHT,
+    BISHOP,
+    ROOK,
+    QUEEN,
+    KING
+};
+
+enum color {
+    BLACK,
+    WHITE
+};
+
+typedef uint64_t Bitboard;
+
+// Squares are numbered rank by rank starting from a1 = 0, so h8 = 63
+const int NO_SQUARE = 64;
+
+// Pieces are numbered color * 6 + type, black pieces first
+const int NO_PIECE = 12;
+
+inline int makePiece(color c, type t) {
+    return c * 6 + t;
+}
+
+inline type pieceType(int piece) {
+    return (type)(piece % 6);
+}
+
+inline color pieceColor(int piece) {
+    return (color)(piece / 6);
+}
+
+inline int makeSquare(int file, int rank) {
+    return rank * 8 + file;
+}
+
+inline int fileOf(int square) {
+    return square & 7;
+}
+
+inline int rankOf(int square) {
+    return square >> 3;
+}
+
+enum castling {
+    WHITE_OO = 1,
+    WHITE_OOO = 2,
+    BLACK_OO = 4,
+    BLACK_OOO = 8
+};
+
+// A move packs the origin square, the destination square and four flag bits into 16 bits
+typedef uint16_t Move;
+
+const Move NO_MOVE = 0;
+
+enum moveFlag {
+    QUIET = 0,
+    DOUBLE_PAWN_PUSH = 1,
+    KING_CASTLE = 2,
+    QUEEN_CASTLE = 3,
+    CAPTURE = 4,
+    EN_PASSANT = 5,
+    // The two low bits of a promotion select the piece, knight to queen
+    PROMOTION = 8,
+    PROMOTION_CAPTURE = 12
+};
+
+inline Move encodeMove(int from, int to, int flags) {
+    return (Move)(from | (to << 6) | (flags << 12));
+}
+
+inline int moveFrom(Move m) {
+    return m & 63;
+}
+
+inline int moveTo(Move m) {
+    return (m >> 6) & 63;
+}
+
+inline int moveFlags(Move m) {
+    return m >> 12;
+}
+
+inline bool isCapture(Move m) {
+    return (m >> 14) & 1;
+}
+
+inline bool isPromotion(Move m) {
+    return (m >> 15) & 1;
+}
+
+inline type promotionType(Move m) {
+    return (type)(KNIGHT + ((m >> 12) & 3));
+}
+
+#endif //RG_3D_SAH_CHESSTYPES_H
@@ -0,0 +1,196 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#include "Engine.h"
+#include "Profiler.h"
+
+#include <algorithm>
+
+Engine::Engine(size_t hashMegabytes, int threads)
+        : tt{hashMegabytes}, searching{false}, jobPosition{new Position()},
+          jobPending{false}, jobStopped{false}, searchRoot{new Position()}, searchDepth{0}, searchId{0}, activeHelpers{0}, quit{false} {
+    startThreads(threads);
+}
+
+Engine::~Engine() {
+    stopThreads();
+}
+
+void Engine::startThreads(int count) {
+    count = std::max(1, count);
+    searchers.clear();
+    for(int i = 0; i < count; i++)
+        searchers.emplace_back(new Searcher(tt, signals, i));
+    results.assign(count, SearchReport{});
+    quit = false;
+    workers.emplace_back(&Engine::mainLoop, this);
+    for(int i = 1; i < count; i++)
+        workers.emplace_back(&Engine::helperLoop, this, i, searchId);
+}
+
+void Engine::stopThreads() {
+    signals.stop = true;
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        quit = true;
+    }
+    jobReady.notify_all();
+    helpersWake.notify_all();
+    helpersDone.notify_all();
+    for(std::thread &t : workers)
+        t.join();
+    workers.clear();
+}
+
+void Engine::waitUntilIdle() {
+    stop();
+    while(searching)
+        std::this_thread::yield();
+}
+
+void Engine::go(const Position &pos, const SearchLimits &limits) {
+    signals.stop = true;
+    signals.ponder = limits.ponder;
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        *jobPosition = pos;
+        jobLimits = limits;
+        jobPending = true;
+        jobStopped = false;
+        // Counts as searching from now on, so nobody mistakes the gap before the thread wakes up for idleness
+        searching = true;
+    }
+    jobReady.notify_one();
+}
+
+void Engine::stop() {
+    // Under the lock so the main thread can't pick up a pending job between the flag and the mark
+    std::lock_guard<std::mutex> lock(jobMutex);
+    signals.stop = true;
+    if(jobPending)
+        jobStopped = true;
+}
+
+void Engine::ponderhit() {
+    signals.ponder = false;
+}
+
+bool Engine::isSearching() const {
+    return searching;
+}
+
+void Engine::setHashSize(size_t megabytes) {
+    waitUntilIdle();
+    tt.resize(megabytes);
+}
+
+void Engine::setThreads(int threads) {
+    waitUntilIdle();
+    stopThreads();
+    startThreads(threads);
+}
+
+int Engine::getThreads() const {
+    return (int)searchers.size();
+}
+
+void Engine::clearHash() {
+    waitUntilIdle();
+    tt.clear();
+}
+
+bool Engine::poll(SearchReport &report) {
+    return reports.pop(report);
+}
+
+uint64_t Engine::totalNodes() const {
+    uint64_t nodes = 0;
+    for(const std::unique_ptr<Searcher> &s : searchers)
+        nodes += s->getNodes();
+    return nodes;
+}
+
+void Engine::mainLoop() {
+    PROFILE_THREAD("search main");
+    std::unique_ptr<Position> root(new Position());
+    while(true)
+    {
+        SearchLimits limits;
+        {
+            std::unique_lock<std::mutex> lock(jobMutex);
+            jobReady.wait(lock, [this]() { return jobPending || quit; });
+            if(quit)
+                return;
+            *root = *jobPosition;
+            limits = jobLimits;
+            jobPending = false;
+            // A stop issued after go() still counts, the search then only reports what it has
+            signals.stop = jobStopped;
+            jobStopped = false;
+            tt.newSearch();
+            // Helpers read the root outside the lock, it isn't touched again until they're all done
+            *searchRoot = *root;
+            searchDepth = limits.depth;
+            searchId++;
+            activeHelpers = (int)searchers.size() - 1;
+        }
+        helpersWake.notify_all();
+
+        // Iteration reports are only progress, they're dropped when the queue is filling up
+        results[0] = searchers[0]->think(*root, limits, [this](const SearchReport &report) {
+            SearchReport progress = report;
+            progress.nodes = report.nodes + totalNodes() - searchers[0]->getNodes();
+            if(reports.size() < 32)
+                reports.push(progress);
+        });
+
+        signals.stop = true;
+        {
+            std::unique_lock<std::mutex> lock(jobMutex);
+            helpersDone.wait(lock, [this]() { return activeHelpers == 0; });
+        }
+
+        // The deepest completed iteration wins, the main thread's on a tie
+        SearchReport result = results[0];
+        for(size_t i = 1; i < results.size(); i++)
+            if(results[i].depth > result.depth && results[i].pvLength > 0)
+                result = results[i];
+        result.nodes = totalNodes();
+        result.elapsed = results[0].elapsed;
+        result.hashfull = tt.hashfull();
+        result.finished = true;
+        // The final report waits for room unless the engine is shutting down
+        while(!reports.push(result) && !quit)
+            std::this_thread::yield();
+
+        std::lock_guard<std::mutex> lock(jobMutex);
+        if(!jobPending)
+            searching = false;
+    }
+}
+
+void Engine::helperLoop(int index, uint64_t lastSearch) {
+    PROFILE_THREAD("search helper " + std::to_string(index));
+    std::unique_ptr<Position> root(new Position());
+    while(true)
+    {
+        // Helpers have no clock of their own, they run until the main thread stops them
+        SearchLimits limits;
+        {
+            std::unique_lock<std::mutex> lock(jobMutex);
+            helpersWake.wait(lock, [this, lastSearch]() { return searchId != lastSearch || quit; });
+            if(quit)
+                return;
+            lastSearch = searchId;
+            limits.depth = searchDepth;
+        }
+        *root = *searchRoot;
+
+        results[index] = searchers[index]->think(*root, limits, nullptr);
+
+        std::lock_guard<std::mutex> lock(jobMutex);
+        if(--activeHelpers == 0)
+            helpersDone.notify_one();
+    }
+}
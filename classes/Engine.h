@@ -0,0 +1,79 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#ifndef RG_3D_SAH_ENGINE_H
+#define RG_3D_SAH_ENGINE_H
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <vector>
+
+#include "Search.h"
+#include "SpscQueue.h"
+
+// Computer player searching on threads of its own. go() and stop() only flip a flag or hand over a job and
+// return at once, reports come back through a lock-free queue the caller polls, so the caller never waits
+// for the search.
+//
+// With more than one thread the search is Lazy SMP: every thread searches the same root, sharing only the
+// transposition table, with the helpers' depths staggered. The first thread keeps the clock, when it's done
+// the helpers are stopped and the result comes from whichever thread completed the deepest iteration.
+class Engine {
+    TranspositionTable tt;
+    SearchSignals signals;
+    std::atomic<bool> searching;
+    SpscQueue<SearchReport, 64> reports;
+
+    std::vector<std::unique_ptr<Searcher>> searchers;
+    std::vector<SearchReport> results;
+    std::vector<std::thread> workers;
+
+    std::mutex jobMutex;
+    // Wakes the main search thread when a job is handed over
+    std::condition_variable jobReady;
+    // Wakes the helpers when the main thread starts a search, and the main thread when the last helper is done
+    std::condition_variable helpersWake;
+    std::condition_variable helpersDone;
+    std::unique_ptr<Position> jobPosition;
+    SearchLimits jobLimits;
+    bool jobPending;
+    // stop() came while the job was still pending, the search it starts is stopped from the outset
+    bool jobStopped;
+    // The root all threads are searching and a counter telling helpers a new search began
+    std::unique_ptr<Position> searchRoot;
+    int searchDepth;
+    uint64_t searchId;
+    int activeHelpers;
+    bool quit;
+
+    void mainLoop();
+    void helperLoop(int index, uint64_t lastSearch);
+    void startThreads(int count);
+    void stopThreads();
+    uint64_t totalNodes() const;
+public:
+    explicit Engine(size_t hashMegabytes = 16, int threads = 1);
+    ~Engine();
+    // Starts searching the position, a search still running is stopped first
+    void go(const Position &pos, const SearchLimits &limits);
+    void stop();
+    // The opponent played the move the engine was pondering on, the search goes on with the clock running
+    void ponderhit();
+    bool isSearching() const;
+    // Stops the search and waits until no thread reads shared state like the evaluation weights anymore
+    void waitUntilIdle();
+    // Both stop the search and wait for it to wind down before reallocating
+    void setHashSize(size_t megabytes);
+    void setThreads(int threads);
+    int getThreads() const;
+    // Forgets everything learned in earlier searches
+    void clearHash();
+    // Takes the oldest report off the queue, false if there is none
+    bool poll(SearchReport &report);
+};
+
+#endif //RG_3D_SAH_ENGINE_H
@@ -0,0 +1,123 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#include "Evaluation.h"
+#include "Nnue.h"
+
+const int pieceValues[6] = {100, 320, 330, 500, 900, 0};
+
+// Tables are written the way the board looks from white's side, a8 first, so white reads them at square ^ 56
+// and black at square
+static const int pawnTable[64] = {
+          0,   0,   0,   0,   0,   0,   0,   0,
+         50,  50,  50,  50,  50,  50,  50,  50,
+         10,  10,  20,  30,  30,  20,  10,  10,
+          5,   5,  10,  25,  25,  10,   5,   5,
+          0,   0,   0,  20,  20,   0,   0,   0,
+          5,  -5, -10,   0,   0, -10,  -5,   5,
+          5,  10,  10, -20, -20,  10,  10,   5,
+          0,   0,   0,   0,   0,   0,   0,   0
+};
+
+static const int knightTable[64] = {
+        -50, -40, -30, -30, -30, -30, -40, -50,
+        -40, -20,   0,   0,   0,   0, -20, -40,
+        -30,   0,  10,  15,  15,  10,   0, -30,
+        -30,   5,  15,  20,  20,  15,   5, -30,
+        -30,   0,  15,  20,  20,  15,   0, -30,
+        -30,   5,  10,  15,  15,  10,   5, -30,
+        -40, -20,   0,   5,   5,   0, -20, -40,
+        -50, -40, -30, -30, -30, -30, -40, -50
+};
+
+static const int bishopTable[64] = {
+        -20, -10, -10, -10, -10, -10, -10, -20,
+        -10,   0,   0,   0,   0,   0,   0, -10,
+        -10,   0,   5,  10,  10,   5,   0, -10,
+        -10,   5,   5,  10,  10,   5,   5, -10,
+        -10,   0,  10,  10,  10,  10,   0, -10,
+        -10,  10,  10,  10,  10,  10,  10, -10,
+        -10,   5,   0,   0,   0,   0,   5, -10,
+        -20, -10, -10, -10, -10, -10, -10, -20
+};
+
+static const int rookTable[64] = {
+          0,   0,   0,   0,   0,   0,   0,   0,
+          5,  10,  10,  10,  10,  10,  10,   5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+          0,   0,   0,   5,   5,   0,   0,   0
+};
+
+static const int queenTable[64] = {
+        -20, -10, -10,  -5,  -5, -10, -10, -20,
+        -10,   0,   0,   0,   0,   0,   0, -10,
+        -10,   0,   5,   5,   5,   5,   0, -10,
+         -5,   0,   5,   5,   5,   5,   0,  -5,
+          0,   0,   5,   5,   5,   5,   0,  -5,
+        -10,   5,   5,   5,   5,   5,   0, -10,
+        -10,   0,   5,   0,   0,   0,   0, -10,
+        -20, -10, -10,  -5,  -5, -10, -10, -20
+};
+
+// The king hides behind its pawns while queens are around and walks to the center once they're gone
+static const int kingMiddlegameTable[64] = {
+        -30, -40, -40, -50, -50, -40, -40, -30,
+        -30, -40, -40, -50, -50, -40, -40, -30,
+        -30, -40, -40, -50, -50, -40, -40, -30,
+        -30, -40, -40, -50, -50, -40, -40, -30,
+        -20, -30, -30, -40, -40, -30, -30, -20,
+        -10, -20, -20, -20, -20, -20, -20, -10,
+         20,  20,   0,   0,   0,   0,  20,  20,
+         20,  30,  10,   0,   0,  10,  30,  20
+};
+
+static const int kingEndgameTable[64] = {
+        -50, -40, -30, -20, -20, -30, -40, -50,
+        -30, -20, -10,   0,   0, -10, -20, -30,
+        -30, -10,  20,  30,  30,  20, -10, -30,
+        -30, -10,  30,  40,  40,  30, -10, -30,
+        -30, -10,  30,  40,  40,  30, -10, -30,
+        -30, -10,  20,  30,  30,  20, -10, -30,
+        -30, -30,   0,   0,   0,   0, -30, -30,
+        -50, -30, -30, -30, -30, -30, -30, -50
+};
+
+static const int *pieceTables[5] = {pawnTable, knightTable, bishopTable, rookTable, queenTable};
+
+// How much each piece type counts towards the middlegame, 24 with all pieces on the board
+static const int phaseWeights[6] = {0, 1, 1, 2, 4, 0};
+static const int MAX_PHASE = 24;
+
+int evaluate(const Position &pos) {
+    return nnueIsLoaded() ? nnueEvaluate(pos) : classicalEvaluate(pos);
+}
+
+int classicalEvaluate(const Position &pos) {
+    int score = 0, phase = 0;
+    for(int c = BLACK; c <= WHITE; c++)
+    {
+        int sign = c == WHITE ? 1 : -1;
+        int flip = c == WHITE ? 56 : 0;
+        for(int t = PAWN; t < KING; t++)
+        {
+            Bitboard b = pos.getPieces((color)c, (type)t);
+            phase += phaseWeights[t] * popCount(b);
+            while(b)
+                score += sign * (pieceValues[t] + pieceTables[t][popLsb(b) ^ flip]);
+        }
+    }
+    if(phase > MAX_PHASE)
+        phase = MAX_PHASE;
+
+    int whiteKing = pos.kingSquare(WHITE) ^ 56, blackKing = pos.kingSquare(BLACK);
+    int middlegame = kingMiddlegameTable[whiteKing] - kingMiddlegameTable[blackKing];
+    int endgame = kingEndgameTable[whiteKing] - kingEndgameTable[blackKing];
+    score += (middlegame * phase + endgame * (MAX_PHASE - phase)) / MAX_PHASE;
+
+    return pos.getSideToMove() == WHITE ? score : -score;
+}
@@ -0,0 +1,27 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#ifndef RG_3D_SAH_EVALUATION_H
+#define RG_3D_SAH_EVALUATION_H
+
+#include "Position.h"
+
+// Deepest a search can reach, also bounds the per ply tables
+const int MAX_PLY = 128;
+
+// Scores are in centipawns, mates are scored VALUE_MATE minus the distance to them in plies
+const int VALUE_DRAW = 0;
+const int VALUE_MATE = 32000;
+const int VALUE_INFINITE = 32001;
+const int VALUE_MATE_IN_MAX_PLY = VALUE_MATE - MAX_PLY;
+
+// Material value of each piece type, the king's is never traded so it's left at zero
+extern const int pieceValues[6];
+
+// Static score of the position from the side to move's point of view, from the NNUE network when one is loaded
+int evaluate(const Position &pos);
+// Material plus piece-square tables, blended between middlegame and endgame by the material left on the board
+int classicalEvaluate(const Position &pos);
+
+#endif //RG_3D_SAH_EVALUATION_H
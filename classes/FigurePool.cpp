@@ -0,0 +1,159 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "FigurePool.h"
+
+glm::mat4 figureTransform(type figureType, color figureColor, std::pair<int, int> cell, status figureStatus) {
+    glm::mat4 model = glm::mat4(1.0);
+    // Raise the figures a bit along the y axis so they don't cut into the board
+    float elevation = 0;
+    switch(figureType)
+    {
+        case PAWN:
+            elevation = 0.162f;
+            break;
+        case ROOK:
+            elevation = 0.232f;
+            break;
+        case KNIGHT:
+            elevation = 0.312f;
+            break;
+        case BISHOP:
+            elevation = 0.262f;
+            break;
+        case QUEEN:
+            elevation = 0.328f;
+            break;
+        case KING:
+            elevation = 0.33f;
+            break;
+    }
+    if(figureStatus == ACTIVE)
+        elevation += 0.5f;
+    model = glm::translate(model, glm::vec3(cell.first * 0.5, elevation, cell.second * 0.5));
+    // If the color is white, rotate the figures 180 degrees (don't want the knights from both players facing the same direction)
+    if(figureColor == WHITE)
+        model = glm::rotate(model, (float)glm::radians(180.0), glm::vec3(0.0f, 1.0f, 0.0f));
+    model = glm::scale(model, glm::vec3(0.01f, 0.01f, 0.01f));
+    return model;
+}
+
+FigurePool::FigurePool() {
+    clear();
+}
+
+void FigurePool::clear() {
+    count = 0;
+    freeCount = MAX_FIGURES;
+    for(int i = 0; i < MAX_FIGURES; i++)
+    {
+        indices[i] = NO_FIGURE;
+        // Popped from the back, low handles go first
+        freeHandles[i] = MAX_FIGURES - 1 - i;
+    }
+    for(int &h : bySquare)
+        h = NO_FIGURE;
+}
+
+int FigurePool::acquire(int piece, int square) {
+    int handle = freeHandles[--freeCount];
+    int index = count++;
+    indices[handle] = index;
+    handles[index] = handle;
+    types[index] = (uint8_t)pieceType(piece);
+    colors[index] = (uint8_t)pieceColor(piece);
+    squares[index] = (uint8_t)square;
+    // No cell yet, the first place() computes the transform
+    columns[index] = rows[index] = 0xFF;
+    statuses[index] = INACTIVE;
+    bySquare[square] = handle;
+    return index;
+}
+
+void FigurePool::release(int handle) {
+    // The last figure takes the freed place, the arrays stay packed
+    int index = indices[handle], last = count - 1;
+    if(index != last)
+    {
+        types[index] = types[last];
+        colors[index] = colors[last];
+        squares[index] = squares[last];
+        columns[index] = columns[last];
+        rows[index] = rows[last];
+        statuses[index] = statuses[last];
+        transforms[index] = transforms[last];
+        handles[index] = handles[last];
+        indices[handles[index]] = index;
+    }
+    count--;
+    indices[handle] = NO_FIGURE;
+    freeHandles[freeCount++] = handle;
+}
+
+bool FigurePool::place(int index, int column, int row, status figureStatus) {
+    if(columns[index] == column && rows[index] == row && statuses[index] == figureStatus)
+        return false;
+    columns[index] = (uint8_t)column;
+    rows[index] = (uint8_t)row;
+    statuses[index] = figureStatus;
+    transforms[index] = figureTransform((type)types[index], (color)colors[index], std::make_pair(column, row), figureStatus);
+    return true;
+}
+
+bool FigurePool::sync(const Position &pos, int heldSquare, std::pair<int, int> heldCell) {
+    // Figures no longer matching their square have moved, been captured or promoted
+    int departed[MAX_FIGURES];
+    int departedCount = 0;
+    bool changed = false;
+    for(int i = 0; i < count; i++)
+    {
+        if(pos.pieceOn(squares[i]) == makePiece((color)colors[i], (type)types[i]))
+            continue;
+        departed[departedCount++] = handles[i];
+        bySquare[squares[i]] = NO_FIGURE;
+    }
+    // Pieces on squares without their figure take over a departed figure of the same kind, the rest get new
+    // ones. A move pairs up the piece's two squares, castling both the king's and the rook's
+    Bitboard occupied = pos.getOccupancy();
+    while(occupied)
+    {
+        int square = popLsb(occupied);
+        if(bySquare[square] != NO_FIGURE)
+            continue;
+        int piece = pos.pieceOn(square);
+        int match = -1;
+        for(int d = 0; d < departedCount && match < 0; d++)
+        {
+            int index = indices[departed[d]];
+            if(makePiece((color)colors[index], (type)types[index]) == piece)
+                match = d;
+        }
+        changed = true;
+        if(match < 0)
+        {
+            acquire(piece, square);
+            continue;
+        }
+        int handle = departed[match];
+        departed[match] = departed[--departedCount];
+        squares[indices[handle]] = (uint8_t)square;
+        bySquare[square] = handle;
+    }
+    for(int d = 0; d < departedCount; d++)
+    {
+        release(departed[d]);
+        changed = true;
+    }
+
+    for(int i = 0; i < count; i++)
+    {
+        if(squares[i] == heldSquare)
+            changed |= place(i, heldCell.first, heldCell.second, ACTIVE);
+        else
+            changed |= place(i, fileOf(squares[i]), 7 - rankOf(squares[i]), INACTIVE);
+    }
+    return changed;
+}
@@ -0,0 +1,88 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#ifndef RG_3D_SAH_FIGUREPOOL_H
+#define RG_3D_SAH_FIGUREPOOL_H
+
+#include <utility>
+#include <glm/glm.hpp>
+
+#include "ChessTypes.h"
+#include "Position.h"
+
+enum status {
+    INACTIVE,
+    ACTIVE
+};
+
+// A square holds at most one figure, so the pool can never run out
+const int MAX_FIGURES = 64;
+const int NO_FIGURE = -1;
+
+// Drawable figures of the game, kept in parallel arrays packed at the front so the draw loop walks contiguous
+// memory. A figure keeps its handle for as long as it's on the board, moving doesn't change it, and handles
+// of captured figures are reused. Nothing is allocated after construction.
+class FigurePool {
+    // Dense arrays, the first count entries are the figures on the board
+    uint8_t types[MAX_FIGURES];
+    uint8_t colors[MAX_FIGURES];
+    uint8_t squares[MAX_FIGURES];
+    // Board cell the figure is drawn on, [0][0] is top left of the board
+    uint8_t columns[MAX_FIGURES];
+    uint8_t rows[MAX_FIGURES];
+    status statuses[MAX_FIGURES];
+    glm::mat4 transforms[MAX_FIGURES];
+    int handles[MAX_FIGURES];
+    int count;
+
+    // Dense index of every handle, NO_FIGURE for unused ones
+    int indices[MAX_FIGURES];
+    int freeHandles[MAX_FIGURES];
+    int freeCount;
+    // Handle of the figure on every square
+    int bySquare[64];
+
+    int acquire(int piece, int square);
+    void release(int handle);
+    bool place(int index, int column, int row, status figureStatus);
+public:
+    FigurePool();
+
+    // Brings the figures in line with the position. Figures that moved keep their handle, captured ones are
+    // released and promoted ones replaced, only changed transforms are recomputed. The figure on heldSquare
+    // is lifted and drawn over heldCell. Returns whether any figure moved, appeared or disappeared
+    bool sync(const Position &pos, int heldSquare, std::pair<int, int> heldCell);
+    void clear();
+
+    int size() const {
+        return count;
+    }
+    // Handle of the figure on the square, NO_FIGURE if it's empty
+    int find(int square) const {
+        return bySquare[square];
+    }
+    int handle(int index) const {
+        return handles[index];
+    }
+    type figureType(int index) const {
+        return (type)types[index];
+    }
+    color figureColor(int index) const {
+        return (color)colors[index];
+    }
+    int square(int index) const {
+        return squares[index];
+    }
+    status figureStatus(int index) const {
+        return statuses[index];
+    }
+    const glm::mat4 &transform(int index) const {
+        return transforms[index];
+    }
+};
+
+// Model matrix of a figure standing on, or held over, a board cell
+glm::mat4 figureTransform(type figureType, color figureColor, std::pair<int, int> cell, status figureStatus);
+
+#endif //RG_3D_SAH_FIGUREPOOL_H
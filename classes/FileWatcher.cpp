@@ -0,0 +1,111 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#include "FileWatcher.h"
+
+#include <iostream>
+#include <climits>
+#include <cstdlib>
+#include <dirent.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+FileWatcher::FileWatcher(const std::string &rootDirectory) {
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(inotify_fd < 0)
+    {
+        std::cerr << "inotify unavailable, hot reload disabled" << std::endl;
+        return;
+    }
+    addDirectory(canonicalPath(rootDirectory));
+    running = true;
+    thread = std::thread(&FileWatcher::run, this);
+}
+
+FileWatcher::~FileWatcher() {
+    stop();
+}
+
+std::string FileWatcher::canonicalPath(const std::string &path) {
+    char resolved[PATH_MAX];
+    if(realpath(path.c_str(), resolved) == nullptr)
+        return path;
+    return resolved;
+}
+
+void FileWatcher::addDirectory(const std::string &path) {
+    // inotify isn't recursive, every directory in the tree gets its own watch
+    int wd = inotify_add_watch(inotify_fd, path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if(wd < 0)
+        return;
+    watchedDirectories[wd] = path;
+
+    DIR *dir = opendir(path.c_str());
+    if(dir == nullptr)
+        return;
+    while(dirent *entry = readdir(dir))
+    {
+        std::string name = entry->d_name;
+        if(entry->d_type == DT_DIR && name != "." && name != "..")
+            addDirectory(path + '/' + name);
+    }
+    closedir(dir);
+}
+
+void FileWatcher::run() {
+    alignas(inotify_event) char buffer[4096];
+    pollfd pfd = {inotify_fd, POLLIN, 0};
+    while(running)
+    {
+        // Wake up regularly so stop() never has to wait long
+        if(::poll(&pfd, 1, 100) <= 0)
+            continue;
+        ssize_t length;
+        while((length = read(inotify_fd, buffer, sizeof(buffer))) > 0)
+        {
+            for(char *ptr = buffer; ptr < buffer + length; ptr += sizeof(inotify_event) + ((inotify_event *)ptr)->len)
+            {
+                auto *event = (inotify_event *)ptr;
+                auto it = watchedDirectories.find(event->wd);
+                if(it == watchedDirectories.end() || event->len == 0)
+                    continue;
+                std::string path = it->second + '/' + event->name;
+                if(event->mask & IN_ISDIR)
+                {
+                    if(event->mask & (IN_CREATE | IN_MOVED_TO))
+                        addDirectory(path);
+                    continue;
+                }
+                // A file that was only created is still being written, wait for it to be closed
+                if(event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+                {
+                    std::lock_guard<std::mutex> lock(changedMutex);
+                    changedFiles.insert(canonicalPath(path));
+                }
+            }
+        }
+    }
+}
+
+bool FileWatcher::isRunning() const {
+    return running;
+}
+
+void FileWatcher::poll(std::set<std::string> &changed) {
+    std::lock_guard<std::mutex> lock(changedMutex);
+    changed.insert(changedFiles.begin(), changedFiles.end());
+    changedFiles.clear();
+}
+
+void FileWatcher::stop() {
+    running = false;
+    if(thread.joinable())
+        thread.join();
+    if(inotify_fd >= 0)
+    {
+        close(inotify_fd);
+        inotify_fd = -1;
+    }
+}
@@ -0,0 +1,41 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#ifndef RG_3D_SAH_FILEWATCHER_H
+#define RG_3D_SAH_FILEWATCHER_H
+
+#include <string>
+#include <set>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+
+// Watches a directory tree with inotify on its own thread and collects the canonical paths of files that
+// were written or replaced since the last call to poll()
+class FileWatcher {
+    int inotify_fd = -1;
+    std::map<int, std::string> watchedDirectories;
+    std::set<std::string> changedFiles;
+    std::mutex changedMutex;
+    std::thread thread;
+    std::atomic<bool> running{false};
+
+    void addDirectory(const std::string &path);
+    void run();
+public:
+    explicit FileWatcher(const std::string &rootDirectory);
+    ~FileWatcher();
+    FileWatcher(const FileWatcher &) = delete;
+    FileWatcher &operator=(const FileWatcher &) = delete;
+
+    bool isRunning() const;
+    void poll(std::set<std::string> &changed);
+    void stop();
+
+    static std::string canonicalPath(const std::string &path);
+};
+
+
+#endif //RG_3D_SAH_FILEWATCHER_H
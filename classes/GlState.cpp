@@ -0,0 +1,300 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#include "GlState.h"
+
+// Stands for state the cache doesn't know, the next call setting it is always passed on
+static const unsigned UNKNOWN = ~0u;
+static const unsigned TEXTURE_UNITS = 32;
+// 2D textures and cube maps
+static const int TEXTURE_TARGETS = 2;
+// Array, element array, pixel pack, pixel unpack and uniform buffers
+static const int BUFFER_TARGETS = 5;
+static const int ELEMENT_ARRAY = 1;
+// Depth test, blending and face culling
+static const int CAPABILITIES = 3;
+
+struct StateCache {
+    unsigned program;
+    unsigned vertexArray;
+    unsigned activeUnit;
+    unsigned textures[TEXTURE_UNITS][TEXTURE_TARGETS];
+    unsigned buffers[BUFFER_TARGETS];
+    unsigned readFramebuffer;
+    unsigned drawFramebuffer;
+    unsigned capabilities[CAPABILITIES];
+    unsigned depthMask;
+    unsigned depthFunction;
+    unsigned blendSource;
+    unsigned blendDestination;
+
+    StateCache() {
+        reset();
+    }
+
+    void reset() {
+        program = vertexArray = activeUnit = UNKNOWN;
+        for(auto &unit : textures)
+            for(unsigned &texture : unit)
+                texture = UNKNOWN;
+        for(unsigned &buffer : buffers)
+            buffer = UNKNOWN;
+        readFramebuffer = drawFramebuffer = UNKNOWN;
+        for(unsigned &capability : capabilities)
+            capability = UNKNOWN;
+        depthMask = depthFunction = blendSource = blendDestination = UNKNOWN;
+    }
+};
+
+static StateCache cache;
+static bool caching = true;
+static StateCounters current;
+static StateCounters last;
+
+static int textureTarget(GLenum target) {
+    switch(target)
+    {
+        case GL_TEXTURE_2D:
+            return 0;
+        case GL_TEXTURE_CUBE_MAP:
+            return 1;
+        default:
+            return -1;
+    }
+}
+
+static int bufferTarget(GLenum target) {
+    switch(target)
+    {
+        case GL_ARRAY_BUFFER:
+            return 0;
+        case GL_ELEMENT_ARRAY_BUFFER:
+            return ELEMENT_ARRAY;
+        case GL_PIXEL_PACK_BUFFER:
+            return 2;
+        case GL_PIXEL_UNPACK_BUFFER:
+            return 3;
+        case GL_UNIFORM_BUFFER:
+            return 4;
+        default:
+            return -1;
+    }
+}
+
+static int capabilityIndex(GLenum capability) {
+    switch(capability)
+    {
+        case GL_DEPTH_TEST:
+            return 0;
+        case GL_BLEND:
+            return 1;
+        case GL_CULL_FACE:
+            return 2;
+        default:
+            return -1;
+    }
+}
+
+// Counts the call and tells whether it has to reach GL
+static bool changes(stateCallKind kind, bool alreadySet) {
+    if(alreadySet && caching)
+    {
+        current.elided[kind]++;
+        return false;
+    }
+    current.issued[kind]++;
+    return true;
+}
+
+void stateUseProgram(unsigned program) {
+    if(!changes(PROGRAM_CALLS, cache.program == program))
+        return;
+    glUseProgram(program);
+    cache.program = program;
+}
+
+void stateBindVertexArray(unsigned vertexArray) {
+    if(!changes(VERTEX_ARRAY_CALLS, cache.vertexArray == vertexArray))
+        return;
+    glBindVertexArray(vertexArray);
+    cache.vertexArray = vertexArray;
+    // The element array binding belongs to the vertex array
+    cache.buffers[ELEMENT_ARRAY] = UNKNOWN;
+}
+
+void stateActiveTexture(GLenum unit) {
+    if(!changes(TEXTURE_CALLS, cache.activeUnit == unit - GL_TEXTURE0))
+        return;
+    glActiveTexture(unit);
+    cache.activeUnit = unit - GL_TEXTURE0;
+}
+
+void stateBindTexture(GLenum target, unsigned texture) {
+    int t = textureTarget(target);
+    bool tracked = t >= 0 && cache.activeUnit < TEXTURE_UNITS;
+    if(!changes(TEXTURE_CALLS, tracked && cache.textures[cache.activeUnit][t] == texture))
+        return;
+    glBindTexture(target, texture);
+    if(tracked)
+        cache.textures[cache.activeUnit][t] = texture;
+}
+
+void stateBindBuffer(GLenum target, unsigned buffer) {
+    int b = bufferTarget(target);
+    if(!changes(BUFFER_CALLS, b >= 0 && cache.buffers[b] == buffer))
+        return;
+    glBindBuffer(target, buffer);
+    if(b >= 0)
+        cache.buffers[b] = buffer;
+}
+
+void stateBindFramebuffer(GLenum target, unsigned framebuffer) {
+    bool read = target != GL_DRAW_FRAMEBUFFER, draw = target != GL_READ_FRAMEBUFFER;
+    if(!changes(FRAMEBUFFER_CALLS, (!read || cache.readFramebuffer == framebuffer) && (!draw || cache.drawFramebuffer == framebuffer)))
+        return;
+    glBindFramebuffer(target, framebuffer);
+    if(read)
+        cache.readFramebuffer = framebuffer;
+    if(draw)
+        cache.drawFramebuffer = framebuffer;
+}
+
+static void setCapability(GLenum capability, bool enabled) {
+    int c = capabilityIndex(capability);
+    if(!changes(FIXED_FUNCTION_CALLS, c >= 0 && cache.capabilities[c] == (unsigned)enabled))
+        return;
+    if(enabled)
+        glEnable(capability);
+    else
+        glDisable(capability);
+    if(c >= 0)
+        cache.capabilities[c] = enabled;
+}
+
+void stateEnable(GLenum capability) {
+    setCapability(capability, true);
+}
+
+void stateDisable(GLenum capability) {
+    setCapability(capability, false);
+}
+
+void stateDepthMask(GLboolean mask) {
+    if(!changes(FIXED_FUNCTION_CALLS, cache.depthMask == mask))
+        return;
+    glDepthMask(mask);
+    cache.depthMask = mask;
+}
+
+void stateDepthFunc(GLenum function) {
+    if(!changes(FIXED_FUNCTION_CALLS, cache.depthFunction == function))
+        return;
+    glDepthFunc(function);
+    cache.depthFunction = function;
+}
+
+void stateBlendFunc(GLenum source, GLenum destination) {
+    if(!changes(FIXED_FUNCTION_CALLS, cache.blendSource == source && cache.blendDestination == destination))
+        return;
+    glBlendFunc(source, destination);
+    cache.blendSource = source;
+    cache.blendDestination = destination;
+}
+
+void stateDeleteProgram(unsigned program) {
+    glDeleteProgram(program);
+    // A program in use stays in use after deletion, but its name can be handed out again
+    if(cache.program == program)
+        cache.program = UNKNOWN;
+}
+
+void stateDeleteVertexArrays(GLsizei n, const unsigned *vertexArrays) {
+    glDeleteVertexArrays(n, vertexArrays);
+    for(GLsizei i = 0; i < n; i++)
+        if(cache.vertexArray == vertexArrays[i])
+        {
+            cache.vertexArray = UNKNOWN;
+            cache.buffers[ELEMENT_ARRAY] = UNKNOWN;
+        }
+}
+
+void stateDeleteFramebuffers(GLsizei n, const unsigned *framebuffers) {
+    glDeleteFramebuffers(n, framebuffers);
+    for(GLsizei i = 0; i < n; i++)
+    {
+        if(cache.readFramebuffer == framebuffers[i])
+            cache.readFramebuffer = UNKNOWN;
+        if(cache.drawFramebuffer == framebuffers[i])
+            cache.drawFramebuffer = UNKNOWN;
+    }
+}
+
+void stateForgetTextures(GLsizei n, const unsigned *textures) {
+    for(GLsizei i = 0; i < n; i++)
+        for(auto &unit : cache.textures)
+            for(unsigned &texture : unit)
+                if(texture == textures[i])
+                    texture = UNKNOWN;
+}
+
+void stateForgetBuffers(GLsizei n, const unsigned *buffers) {
+    for(GLsizei i = 0; i < n; i++)
+        for(unsigned &buffer : cache.buffers)
+            if(buffer == buffers[i])
+                buffer = UNKNOWN;
+}
+
+void stateInvalidate() {
+    cache.reset();
+}
+
+void stateSetCaching(bool enabled) {
+    caching = enabled;
+}
+
+bool stateCaching() {
+    return caching;
+}
+
+void stateEndFrame() {
+    last = current;
+    current = StateCounters();
+}
+
+const StateCounters &stateLastFrame() {
+    return last;
+}
+
+static const char *kindName(stateCallKind kind) {
+    switch(kind)
+    {
+        case PROGRAM_CALLS:
+            return "programs";
+        case VERTEX_ARRAY_CALLS:
+            return "vertex arrays";
+        case TEXTURE_CALLS:
+            return "textures";
+        case BUFFER_CALLS:
+            return "buffers";
+        case FRAMEBUFFER_CALLS:
+            return "framebuffers";
+        case FIXED_FUNCTION_CALLS:
+            return "fixed function";
+        default:
+            return "";
+    }
+}
+
+void stateReport(std::ostream &out) {
+    unsigned issued = 0, elided = 0;
+    for(int k = 0; k < STATE_CALL_KINDS; k++)
+    {
+        issued += last.issued[k];
+        elided += last.elided[k];
+    }
+    out << "GL state calls last frame " << issued << " issued, " << elided << " skipped" << (caching ? "" : " (caching off)") << ":";
+    for(int k = 0; k < STATE_CALL_KINDS; k++)
+        out << (k ? ", " : " ") << kindName((stateCallKind)k) << " " << last.issued[k] << "/" << last.elided[k];
+    out << std::endl;
+}
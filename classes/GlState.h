@@ -0,0 +1,64 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#ifndef RG_3D_SAH_GLSTATE_H
+#define RG_3D_SAH_GLSTATE_H
+
+#include <ostream>
+#include <glad/glad.h>
+
+// Binds and fixed function state go through these instead of straight to GL. They remember what the context
+// has bound and skip calls that wouldn't change anything, so draw code can set what it needs without knowing
+// what ran before. The cache only holds while nothing else changes the same state, every bind in the app goes
+// through here, and GL objects have to be deleted through the functions below or memoryDelete*, deleting
+// something bound changes the bindings. There's one GL context, used from the main thread.
+
+enum stateCallKind {
+    PROGRAM_CALLS,
+    VERTEX_ARRAY_CALLS,
+    TEXTURE_CALLS,
+    BUFFER_CALLS,
+    FRAMEBUFFER_CALLS,
+    FIXED_FUNCTION_CALLS,
+    STATE_CALL_KINDS
+};
+
+struct StateCounters {
+    // Calls passed on to GL and calls skipped because the state was already set
+    unsigned issued[STATE_CALL_KINDS] = {};
+    unsigned elided[STATE_CALL_KINDS] = {};
+};
+
+void stateUseProgram(unsigned program);
+void stateBindVertexArray(unsigned vertexArray);
+void stateActiveTexture(GLenum unit);
+// Binds to the active unit
+void stateBindTexture(GLenum target, unsigned texture);
+void stateBindBuffer(GLenum target, unsigned buffer);
+void stateBindFramebuffer(GLenum target, unsigned framebuffer);
+void stateEnable(GLenum capability);
+void stateDisable(GLenum capability);
+void stateDepthMask(GLboolean mask);
+void stateDepthFunc(GLenum function);
+void stateBlendFunc(GLenum source, GLenum destination);
+
+void stateDeleteProgram(unsigned program);
+void stateDeleteVertexArrays(GLsizei n, const unsigned *vertexArrays);
+void stateDeleteFramebuffers(GLsizei n, const unsigned *framebuffers);
+// Drops deleted textures and buffers from the cache, memoryDeleteTextures and memoryDeleteBuffers call these
+void stateForgetTextures(GLsizei n, const unsigned *textures);
+void stateForgetBuffers(GLsizei n, const unsigned *buffers);
+// Forgets everything, for after code that changed the state behind the cache's back
+void stateInvalidate();
+
+// With caching off every call is passed on, to measure what the skipped ones cost
+void stateSetCaching(bool enabled);
+bool stateCaching();
+// Closes the frame's counters, call once per frame after the swap
+void stateEndFrame();
+const StateCounters &stateLastFrame();
+// Issued and skipped calls of the last frame by kind
+void stateReport(std::ostream &out);
+
+#endif //RG_3D_SAH_GLSTATE_H
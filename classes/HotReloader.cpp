@@ -0,0 +1,178 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#include "HotReloader.h"
+#include "Profiler.h"
+
+#include <iostream>
+#include <chrono>
+
+template <typename T>
+static bool isReady(const std::future<T> &job) {
+    return job.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+HotReloader::HotReloader(const std::string &resourceDirectory)
+    : watcher{resourceDirectory} { }
+
+HotReloader::~HotReloader() {
+    watcher.stop();
+    // Background jobs own no GL objects, just let them finish and throw the results away
+    for(auto &it : textureJobs)
+    {
+        ImageData image = it.second.get();
+        image.free();
+    }
+    for(auto &it : modelJobs)
+    {
+        std::unique_ptr<ModelData> data = it.second.get();
+        if(data)
+            data->freeImages();
+    }
+}
+
+void HotReloader::watch(Shader *shader, const std::string &vertexShaderPath, const std::string &fragmentShaderPath) {
+    shaders.push_back({shader, FileWatcher::canonicalPath(vertexShaderPath), FileWatcher::canonicalPath(fragmentShaderPath)});
+}
+
+void HotReloader::watch(Texture2D *texture, const std::string &texturePath) {
+    textures.push_back({texture, FileWatcher::canonicalPath(texturePath)});
+}
+
+void HotReloader::watch(Model *model, const std::string &modelPath) {
+    models.push_back({model, FileWatcher::canonicalPath(modelPath)});
+}
+
+void HotReloader::startShader(size_t index) {
+    if(shaderJobs.count(index))
+    {
+        shadersAgain.insert(index);
+        return;
+    }
+    std::string vertexPath = shaders[index].vertexPath, fragmentPath = shaders[index].fragmentPath;
+    shaderJobs[index] = std::async(std::launch::async, [vertexPath, fragmentPath]() {
+        PROFILE_THREAD("hot reload");
+        PROFILE_SCOPE("read shaders");
+        ShaderSources sources;
+        sources.ok = Shader::readSources(vertexPath, fragmentPath, sources.vertexSource, sources.fragmentSource);
+        return sources;
+    });
+}
+
+void HotReloader::startTexture(size_t index) {
+    if(textureJobs.count(index))
+    {
+        texturesAgain.insert(index);
+        return;
+    }
+    std::string path = textures[index].path;
+    textureJobs[index] = std::async(std::launch::async, [path]() {
+        PROFILE_THREAD("hot reload");
+        ImageData image;
+        ImageData::load(path, image);
+        return image;
+    });
+}
+
+void HotReloader::startModel(size_t index) {
+    if(modelJobs.count(index))
+    {
+        modelsAgain.insert(index);
+        return;
+    }
+    std::string path = models[index].path;
+    modelJobs[index] = std::async(std::launch::async, [path]() {
+        PROFILE_THREAD("hot reload");
+        std::unique_ptr<ModelData> data(new ModelData());
+        // Textures are decoded here as well, the GL thread only uploads them
+        if(!ModelData::import(path, *data) || !data->decodeTextures())
+            return std::unique_ptr<ModelData>();
+        return data;
+    });
+}
+
+void HotReloader::finishJobs() {
+    for(auto it = shaderJobs.begin(); it != shaderJobs.end();)
+    {
+        if(!isReady(it->second))
+        {
+            ++it;
+            continue;
+        }
+        ShaderSources sources = it->second.get();
+        const ShaderEntry &entry = shaders[it->first];
+        if(sources.ok && entry.shader->reload(sources.vertexSource, sources.fragmentSource))
+            std::cout << "Reloaded shader " << entry.fragmentPath << std::endl;
+        else
+            std::cerr << "Reloading shader " << entry.fragmentPath << " failed, keeping the old one" << std::endl;
+        it = shaderJobs.erase(it);
+    }
+    for(auto it = textureJobs.begin(); it != textureJobs.end();)
+    {
+        if(!isReady(it->second))
+        {
+            ++it;
+            continue;
+        }
+        ImageData image = it->second.get();
+        const TextureEntry &entry = textures[it->first];
+        if(entry.texture->reload(image))
+            std::cout << "Reloaded texture " << entry.path << std::endl;
+        else
+            std::cerr << "Reloading texture " << entry.path << " failed, keeping the old one" << std::endl;
+        image.free();
+        it = textureJobs.erase(it);
+    }
+    for(auto it = modelJobs.begin(); it != modelJobs.end();)
+    {
+        if(!isReady(it->second))
+        {
+            ++it;
+            continue;
+        }
+        std::unique_ptr<ModelData> data = it->second.get();
+        const ModelEntry &entry = models[it->first];
+        if(data && entry.model->reload(*data))
+            std::cout << "Reloaded model " << entry.path << std::endl;
+        else
+            std::cerr << "Reloading model " << entry.path << " failed, keeping the old one" << std::endl;
+        if(data)
+            data->freeImages();
+        it = modelJobs.erase(it);
+    }
+}
+
+void HotReloader::update() {
+    PROFILE_SCOPE("hot reload");
+    std::set<std::string> changed;
+    watcher.poll(changed);
+    for(const std::string &path : changed)
+    {
+        for(size_t i = 0; i < shaders.size(); i++)
+            if(shaders[i].vertexPath == path || shaders[i].fragmentPath == path)
+                startShader(i);
+        for(size_t i = 0; i < textures.size(); i++)
+            if(textures[i].path == path)
+                startTexture(i);
+        for(size_t i = 0; i < models.size(); i++)
+            if(models[i].path == path)
+                startModel(i);
+    }
+
+    finishJobs();
+
+    // Files that changed during a rebuild get rebuilt once more so the newest version always wins
+    std::set<size_t> again;
+    again.swap(shadersAgain);
+    for(size_t i : again)
+        startShader(i);
+    again.clear();
+    again.swap(texturesAgain);
+    for(size_t i : again)
+        startTexture(i);
+    again.clear();
+    again.swap(modelsAgain);
+    for(size_t i : again)
+        startModel(i);
+}
@@ -0,0 +1,73 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#ifndef RG_3D_SAH_HOTRELOADER_H
+#define RG_3D_SAH_HOTRELOADER_H
+
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <memory>
+#include <future>
+
+#include "FileWatcher.h"
+#include "Shader.h"
+#include "Texture2D.h"
+#include "Model.h"
+
+// Rebuilds shaders, textures and models whose files changed on disk. Reading, decoding and importing happen
+// on background threads, the results are swapped in by update() which is called between frames on the
+// thread owning the GL context. If a rebuild fails the old version stays in use.
+class HotReloader {
+    struct ShaderSources {
+        bool ok = false;
+        std::string vertexSource;
+        std::string fragmentSource;
+    };
+
+    struct ShaderEntry {
+        Shader *shader;
+        std::string vertexPath;
+        std::string fragmentPath;
+    };
+
+    struct TextureEntry {
+        Texture2D *texture;
+        std::string path;
+    };
+
+    struct ModelEntry {
+        Model *model;
+        std::string path;
+    };
+
+    FileWatcher watcher;
+    std::vector<ShaderEntry> shaders;
+    std::vector<TextureEntry> textures;
+    std::vector<ModelEntry> models;
+
+    std::map<size_t, std::future<ShaderSources>> shaderJobs;
+    std::map<size_t, std::future<ImageData>> textureJobs;
+    std::map<size_t, std::future<std::unique_ptr<ModelData>>> modelJobs;
+    // Resources that changed again while their rebuild was still running
+    std::set<size_t> shadersAgain, texturesAgain, modelsAgain;
+
+    void startShader(size_t index);
+    void startTexture(size_t index);
+    void startModel(size_t index);
+    void finishJobs();
+public:
+    explicit HotReloader(const std::string &resourceDirectory);
+    ~HotReloader();
+
+    void watch(Shader *shader, const std::string &vertexShaderPath, const std::string &fragmentShaderPath);
+    void watch(Texture2D *texture, const std::string &texturePath);
+    void watch(Model *model, const std::string &modelPath);
+
+    void update();
+};
+
+
+#endif //RG_3D_SAH_HOTRELOADER_H
@@ -0,0 +1,271 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#include "InputRecorder.h"
+
+#include <cstdio>
+#include <vector>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+enum inputMode {
+    INPUT_OFF,
+    INPUT_RECORDING,
+    INPUT_REPLAYING
+};
+
+enum inputEventType {
+    INPUT_KEY,
+    INPUT_CURSOR,
+    INPUT_SCROLL,
+    INPUT_MOVE
+};
+
+struct InputEvent {
+    inputEventType type;
+    // Index of the frame whose poll delivers the event
+    int frame;
+    int key, scancode, action, mods;
+    double x, y;
+    Move move;
+};
+
+// First line of a recording, a format change bumps the number
+static const char *const INPUT_HEADER = "rg_3d_sah input 1";
+
+static inputMode mode = INPUT_OFF;
+static FILE *recording = nullptr;
+static std::string recordingPath;
+static int framesRecorded = 0;
+
+static std::vector<double> frameTimes;
+static std::vector<InputEvent> events;
+static double replayStep = 0;
+static size_t nextFrame = 0;
+static size_t nextEvent = 0;
+// Wall time of every replayed frame, from its poll to the next
+static std::vector<double> frameSeconds;
+static std::chrono::steady_clock::time_point lastPoll;
+
+static bool keysDown[GLFW_KEY_LAST + 1];
+
+static GLFWkeyfun appKey = nullptr;
+static GLFWcursorposfun appCursor = nullptr;
+static GLFWscrollfun appScroll = nullptr;
+static InputMoveCallback appMove = nullptr;
+
+static void trackKey(int key, int action) {
+    if(key < 0 || key > GLFW_KEY_LAST || action == GLFW_REPEAT)
+        return;
+    keysDown[key] = action == GLFW_PRESS;
+}
+
+static void keyEvent(GLFWwindow *window, int key, int scancode, int action, int mods) {
+    if(mode == INPUT_REPLAYING)
+        return;
+    if(mode == INPUT_RECORDING)
+    {
+        fprintf(recording, "key %d %d %d %d\n", key, scancode, action, mods);
+        trackKey(key, action);
+    }
+    if(appKey)
+        appKey(window, key, scancode, action, mods);
+}
+
+static void cursorEvent(GLFWwindow *window, double x, double y) {
+    if(mode == INPUT_REPLAYING)
+        return;
+    if(mode == INPUT_RECORDING)
+        fprintf(recording, "cursor %.17g %.17g\n", x, y);
+    if(appCursor)
+        appCursor(window, x, y);
+}
+
+static void scrollEvent(GLFWwindow *window, double x, double y) {
+    if(mode == INPUT_REPLAYING)
+        return;
+    if(mode == INPUT_RECORDING)
+        fprintf(recording, "scroll %.17g %.17g\n", x, y);
+    if(appScroll)
+        appScroll(window, x, y);
+}
+
+bool inputRecord(const std::string &path, const std::string &fen) {
+    recording = fopen(path.c_str(), "w");
+    if(recording == nullptr)
+        return false;
+    fprintf(recording, "%s\nfen %s\n", INPUT_HEADER, fen.c_str());
+    recordingPath = path;
+    mode = INPUT_RECORDING;
+    return true;
+}
+
+bool inputReplay(const std::string &path, std::string &fen, double fixedStep) {
+    std::ifstream in(path);
+    std::string line;
+    if(!in || !std::getline(in, line) || line != INPUT_HEADER)
+        return false;
+    frameTimes.clear();
+    events.clear();
+    // Events ahead of the first frame came in before the loop started, they go out with the first poll
+    int frame = 0;
+    while(std::getline(in, line))
+    {
+        std::istringstream fields(line);
+        std::string kind;
+        fields >> kind;
+        InputEvent event = {};
+        event.frame = frame;
+        if(kind == "fen")
+        {
+            std::getline(fields >> std::ws, fen);
+            continue;
+        }
+        else if(kind == "frame")
+        {
+            double time;
+            if(!(fields >> time))
+                return false;
+            if(!frameTimes.empty())
+                frame++;
+            frameTimes.push_back(time);
+            continue;
+        }
+        else if(kind == "key")
+        {
+            event.type = INPUT_KEY;
+            fields >> event.key >> event.scancode >> event.action >> event.mods;
+        }
+        else if(kind == "cursor" || kind == "scroll")
+        {
+            event.type = kind == "cursor" ? INPUT_CURSOR : INPUT_SCROLL;
+            fields >> event.x >> event.y;
+        }
+        else if(kind == "move")
+        {
+            unsigned move;
+            event.type = INPUT_MOVE;
+            fields >> move;
+            event.move = (Move)move;
+        }
+        else if(kind.empty())
+            continue;
+        else
+            return false;
+        if(!fields)
+            return false;
+        events.push_back(event);
+    }
+    replayStep = fixedStep;
+    nextFrame = nextEvent = 0;
+    frameSeconds.clear();
+    frameSeconds.reserve(frameTimes.size());
+    mode = INPUT_REPLAYING;
+    return true;
+}
+
+bool inputReplaying() {
+    return mode == INPUT_REPLAYING;
+}
+
+void inputInstall(GLFWwindow *window, GLFWkeyfun key, GLFWcursorposfun cursor, GLFWscrollfun scroll, InputMoveCallback move) {
+    appKey = key;
+    appCursor = cursor;
+    appScroll = scroll;
+    appMove = move;
+    glfwSetKeyCallback(window, keyEvent);
+    glfwSetCursorPosCallback(window, cursorEvent);
+    glfwSetScrollCallback(window, scrollEvent);
+}
+
+double inputPoll(GLFWwindow *window) {
+    if(mode == INPUT_OFF)
+    {
+        glfwPollEvents();
+        return glfwGetTime();
+    }
+    if(mode == INPUT_RECORDING)
+    {
+        double time = glfwGetTime();
+        fprintf(recording, "frame %.17g\n", time);
+        framesRecorded++;
+        glfwPollEvents();
+        return time;
+    }
+
+    // Keeps the window responsive, what it delivers is dropped
+    glfwPollEvents();
+    auto now = std::chrono::steady_clock::now();
+    if(nextFrame > 0)
+        frameSeconds.push_back(std::chrono::duration<double>(now - lastPoll).count());
+    lastPoll = now;
+    if(nextFrame >= frameTimes.size())
+    {
+        glfwSetWindowShouldClose(window, true);
+        return frameTimes.empty() ? 0 : replayStep > 0 ? replayStep * frameTimes.size() : frameTimes.back();
+    }
+    for(; nextEvent < events.size() && events[nextEvent].frame == (int)nextFrame; nextEvent++)
+    {
+        const InputEvent &event = events[nextEvent];
+        if(event.type == INPUT_KEY)
+        {
+            trackKey(event.key, event.action);
+            if(appKey)
+                appKey(window, event.key, event.scancode, event.action, event.mods);
+        }
+        else if(event.type == INPUT_CURSOR && appCursor)
+            appCursor(window, event.x, event.y);
+        else if(event.type == INPUT_SCROLL && appScroll)
+            appScroll(window, event.x, event.y);
+        else if(event.type == INPUT_MOVE && appMove)
+            appMove(event.move);
+    }
+    nextFrame++;
+    return replayStep > 0 ? replayStep * nextFrame : frameTimes[nextFrame - 1];
+}
+
+bool inputKeyDown(GLFWwindow *window, int key) {
+    if(mode == INPUT_OFF)
+        return glfwGetKey(window, key) == GLFW_PRESS;
+    return key >= 0 && key <= GLFW_KEY_LAST && keysDown[key];
+}
+
+void inputMove(Move move) {
+    if(mode == INPUT_RECORDING)
+        fprintf(recording, "move %u\n", (unsigned)move);
+}
+
+void inputFinish(std::ostream &out) {
+    if(mode == INPUT_RECORDING)
+    {
+        if(fclose(recording) == 0)
+            out << "Recorded " << framesRecorded << " frames to " << recordingPath << std::endl;
+        else
+            out << "Writing the recording to " << recordingPath << " failed" << std::endl;
+        recording = nullptr;
+    }
+    else if(mode == INPUT_REPLAYING && !frameSeconds.empty())
+    {
+        std::vector<double> sorted = frameSeconds;
+        std::sort(sorted.begin(), sorted.end());
+        double total = 0;
+        for(double s : sorted)
+            total += s;
+        auto percentile = [&sorted](double p) {
+            return sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))] * 1e3;
+        };
+        std::ios::fmtflags flags = out.flags();
+        std::streamsize precision = out.precision();
+        out << std::fixed << std::setprecision(3) << "Replayed " << sorted.size() << " of " << frameTimes.size()
+            << " frames in " << total << " s, frame time mean " << total / sorted.size() * 1e3 << " ms, median "
+            << percentile(0.5) << " ms, 95% " << percentile(0.95) << " ms, 99% " << percentile(0.99) << " ms, max "
+            << sorted.back() * 1e3 << " ms" << std::endl;
+        out.flags(flags);
+        out.precision(precision);
+    }
+    mode = INPUT_OFF;
+}
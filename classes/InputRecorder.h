@@ -0,0 +1,43 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#ifndef RG_3D_SAH_INPUTRECORDER_H
+#define RG_3D_SAH_INPUTRECORDER_H
+
+#include <string>
+#include <ostream>
+#include <GLFW/glfw3.h>
+
+#include "ChessTypes.h"
+
+// Records what drives a session of the app, the clock of every frame, the key, cursor and scroll events and
+// the moves the computer played, and plays it back so two runs draw the same frames. Events are grouped by
+// the frame whose poll delivered them. The computer's moves are recorded rather than searched again, the
+// search depends on the clock and the number of cores. Only one recording or replay per process.
+
+typedef void (*InputMoveCallback)(Move move);
+
+// Starts recording to the file, the position is written to it so the replay starts from the same one
+bool inputRecord(const std::string &path, const std::string &fen);
+// Loads a recording, fen gets the position it started from. Frames get the recorded clock, or one that
+// advances by fixedStep seconds every frame when that's above 0
+bool inputReplay(const std::string &path, std::string &fen, double fixedStep);
+bool inputReplaying();
+
+// Takes over the window's input callbacks. While recording events are written and passed on, while replaying
+// the window's own input is dropped and the callbacks only see the recorded events
+void inputInstall(GLFWwindow *window, GLFWkeyfun key, GLFWcursorposfun cursor, GLFWscrollfun scroll, InputMoveCallback move);
+// Polls the window's events and returns the time of the new frame. While replaying it hands out the next
+// recorded frame instead and closes the window after the last one
+double inputPoll(GLFWwindow *window);
+// Key state for polled movement, while recording or replaying it follows the key events, so both runs see
+// the same
+bool inputKeyDown(GLFWwindow *window, int key);
+// Records a move the computer played
+void inputMove(Move move);
+
+// Ends the recording, or prints the frame times of the replay
+void inputFinish(std::ostream &out);
+
+#endif //RG_3D_SAH_INPUTRECORDER_H
@@ -0,0 +1,223 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#include "MemoryTracker.h"
+#include "GlState.h"
+
+#include <map>
+#include <vector>
+#include <mutex>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <unistd.h>
+
+struct Allocation {
+    size_t size;
+    // Internal format of textures, target of buffers
+    GLenum format;
+    memoryCategory category;
+    std::string owner;
+};
+
+static std::mutex memoryMutex;
+static std::map<unsigned, Allocation> buffers;
+// Cube maps have an allocation per face
+static std::map<std::pair<unsigned, GLenum>, Allocation> textures;
+static MemoryStats stats;
+
+static const char *categoryName(memoryCategory category) {
+    switch(category)
+    {
+        case GEOMETRY:
+            return "geometry";
+        case TEXTURES:
+            return "textures";
+        case RENDER_TARGETS:
+            return "render targets";
+        default:
+            return "other";
+    }
+}
+
+static std::string formatName(GLenum format) {
+    switch(format)
+    {
+        case GL_ARRAY_BUFFER:
+            return "vertices";
+        case GL_ELEMENT_ARRAY_BUFFER:
+            return "indices";
+        case GL_PIXEL_PACK_BUFFER:
+            return "readback";
+        case GL_RED:
+            return "R8";
+        case GL_RGB:
+            return "RGB8";
+        case GL_RGBA:
+            return "RGBA8";
+        case GL_R32F:
+            return "R32F";
+        case GL_DEPTH24_STENCIL8:
+            return "D24S8";
+        default:
+            return std::to_string(format);
+    }
+}
+
+static size_t bytesPerTexel(GLint internalFormat) {
+    switch(internalFormat)
+    {
+        case GL_RED:
+        case GL_R8:
+            return 1;
+        case GL_RG:
+        case GL_RG8:
+            return 2;
+        case GL_RGB:
+        case GL_RGB8:
+            return 3;
+        default:
+            // RGBA8, R32F and the depth formats
+            return 4;
+    }
+}
+
+static void addSize(Allocation &allocation, size_t size) {
+    stats.current[allocation.category] += size;
+    stats.currentTotal += size;
+    stats.peak[allocation.category] = std::max(stats.peak[allocation.category], stats.current[allocation.category]);
+    stats.peakTotal = std::max(stats.peakTotal, stats.currentTotal);
+    allocation.size += size;
+}
+
+static void removeSize(Allocation &allocation) {
+    stats.current[allocation.category] -= allocation.size;
+    stats.currentTotal -= allocation.size;
+    allocation.size = 0;
+}
+
+// Replaces whatever the name held before, GL frees the old storage when new storage is specified
+static void record(Allocation &allocation, bool created, size_t size, GLenum format, memoryCategory category, const std::string &owner) {
+    if(created)
+        stats.allocations++;
+    else
+        removeSize(allocation);
+    allocation.format = format;
+    allocation.category = category;
+    if(!owner.empty())
+        allocation.owner = owner;
+    addSize(allocation, size);
+}
+
+void memoryBufferData(GLenum target, unsigned buffer, GLsizeiptr size, const void *data, GLenum usage,
+                      memoryCategory category, const std::string &owner) {
+    glBufferData(target, size, data, usage);
+    std::lock_guard<std::mutex> lock(memoryMutex);
+    auto it = buffers.insert(std::make_pair(buffer, Allocation{0, target, category, owner}));
+    record(it.first->second, it.second, size, target, category, owner);
+}
+
+void memoryTexImage2D(GLenum target, unsigned texture, GLint internalFormat, GLsizei width, GLsizei height, GLenum format,
+                      GLenum type, const void *data, bool mipmaps, memoryCategory category, const std::string &owner) {
+    glTexImage2D(target, 0, internalFormat, width, height, 0, format, type, data);
+    size_t size = 0;
+    for(size_t w = width, h = height;; w = std::max<size_t>(1, w / 2), h = std::max<size_t>(1, h / 2))
+    {
+        size += w * h * bytesPerTexel(internalFormat);
+        if(!mipmaps || (w == 1 && h == 1))
+            break;
+    }
+    std::lock_guard<std::mutex> lock(memoryMutex);
+    auto it = textures.insert(std::make_pair(std::make_pair(texture, target), Allocation{0, (GLenum)internalFormat, category, owner}));
+    record(it.first->second, it.second, size, internalFormat, category, owner);
+}
+
+void memoryDeleteBuffers(GLsizei n, const unsigned *names) {
+    glDeleteBuffers(n, names);
+    stateForgetBuffers(n, names);
+    std::lock_guard<std::mutex> lock(memoryMutex);
+    for(GLsizei i = 0; i < n; i++)
+    {
+        auto it = buffers.find(names[i]);
+        if(it == buffers.end())
+            continue;
+        removeSize(it->second);
+        buffers.erase(it);
+    }
+}
+
+void memoryDeleteTextures(GLsizei n, const unsigned *names) {
+    glDeleteTextures(n, names);
+    stateForgetTextures(n, names);
+    std::lock_guard<std::mutex> lock(memoryMutex);
+    for(GLsizei i = 0; i < n; i++)
+    {
+        auto first = textures.lower_bound(std::make_pair(names[i], (GLenum)0));
+        auto last = textures.lower_bound(std::make_pair(names[i] + 1, (GLenum)0));
+        for(auto it = first; it != last; ++it)
+            removeSize(it->second);
+        textures.erase(first, last);
+    }
+}
+
+size_t memoryResident() {
+    size_t pages = 0, resident = 0;
+    std::ifstream statm("/proc/self/statm");
+    if(!(statm >> pages >> resident))
+        return 0;
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+MemoryStats memoryStats() {
+    MemoryStats result;
+    {
+        std::lock_guard<std::mutex> lock(memoryMutex);
+        result = stats;
+    }
+    result.resident = memoryResident();
+    return result;
+}
+
+static std::string megabytes(size_t bytes) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1) << bytes / (1024.0 * 1024.0) << " MB";
+    return out.str();
+}
+
+void memoryReport(std::ostream &out, bool resources) {
+    MemoryStats current = memoryStats();
+    out << "GPU memory " << megabytes(current.currentTotal) << " (peak " << megabytes(current.peakTotal) << "):";
+    for(int c = 0; c < MEMORY_CATEGORIES; c++)
+        out << (c ? ", " : " ") << categoryName((memoryCategory)c) << " " << megabytes(current.current[c]);
+    out << ", process resident " << megabytes(current.resident) << std::endl;
+    if(!resources)
+        return;
+
+    // Faces of a cube map and buffers of a mesh are listed together under their owner
+    std::map<std::pair<std::string, memoryCategory>, std::pair<size_t, std::string>> owners;
+    {
+        std::lock_guard<std::mutex> lock(memoryMutex);
+        auto collect = [&](const Allocation &allocation) {
+            auto &entry = owners[std::make_pair(allocation.owner, allocation.category)];
+            entry.first += allocation.size;
+            std::string format = formatName(allocation.format);
+            if(entry.second.find(format) == std::string::npos)
+                entry.second += (entry.second.empty() ? "" : " ") + format;
+        };
+        for(auto &it : buffers)
+            collect(it.second);
+        for(auto &it : textures)
+            collect(it.second);
+    }
+    std::vector<std::pair<size_t, std::string>> lines;
+    for(auto &it : owners)
+        lines.push_back(std::make_pair(it.second.first, "  " + megabytes(it.second.first) + "  " + categoryName(it.first.second)
+                                                        + "  " + it.second.second + "  " + it.first.first));
+    std::sort(lines.begin(), lines.end(), [](const std::pair<size_t, std::string> &a, const std::pair<size_t, std::string> &b) {
+        return a.first > b.first;
+    });
+    for(auto &line : lines)
+        out << line.second << std::endl;
+}
@@ -0,0 +1,46 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#ifndef RG_3D_SAH_MEMORYTRACKER_H
+#define RG_3D_SAH_MEMORYTRACKER_H
+
+#include <string>
+#include <ostream>
+#include <glad/glad.h>
+
+enum memoryCategory {
+    GEOMETRY,
+    TEXTURES,
+    RENDER_TARGETS,
+    MEMORY_CATEGORIES
+};
+
+struct MemoryStats {
+    // Bytes of GPU memory allocated through the functions below, now and at the highest point so far
+    size_t current[MEMORY_CATEGORIES] = {};
+    size_t peak[MEMORY_CATEGORIES] = {};
+    size_t currentTotal = 0;
+    size_t peakTotal = 0;
+    size_t allocations = 0;
+    // Resident set size of the process, 0 where /proc isn't available
+    size_t resident = 0;
+};
+
+// Every GL buffer and texture allocation goes through these, they do the GL call and record its size, format
+// and owning asset by GL name. The sizes are what the data takes uncompressed, drivers may pad. An empty owner
+// keeps the one recorded for the name, so re-uploads don't need to know it
+void memoryBufferData(GLenum target, unsigned buffer, GLsizeiptr size, const void *data, GLenum usage,
+                      memoryCategory category, const std::string &owner);
+// Level 0 of a 2D texture or a cube map face, with mipmaps the rest of the chain is counted too
+void memoryTexImage2D(GLenum target, unsigned texture, GLint internalFormat, GLsizei width, GLsizei height, GLenum format,
+                      GLenum type, const void *data, bool mipmaps, memoryCategory category, const std::string &owner);
+void memoryDeleteBuffers(GLsizei n, const unsigned *buffers);
+void memoryDeleteTextures(GLsizei n, const unsigned *textures);
+
+MemoryStats memoryStats();
+size_t memoryResident();
+// One line with the totals, or with resources also every allocation by owner, largest first
+void memoryReport(std::ostream &out, bool resources = false);
+
+#endif //RG_3D_SAH_MEMORYTRACKER_H
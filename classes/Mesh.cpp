@@ -4,9 +4,21 @@
 
 #include "Mesh.h"
 
-Mesh::Mesh(std::vector<Vertex> &vertices, std::vector<unsigned> &indices, std::vector<Texture2D> &textures)
-    : vertices{vertices}, indices{indices}, textures{textures} {
-        setupMesh();
+#include <utility>
+
+#include "MemoryTracker.h"
+#include "GlState.h"
+
+Mesh::Mesh(std::vector<Vertex> &&vertices, std::vector<unsigned> &&indices, std::vector<Texture2D> &&textures,
+           const std::string &owner, bool keepGeometry)
+    : indexCount{(unsigned)indices.size()}, vertices{std::move(vertices)}, indices{std::move(indices)}, textures{std::move(textures)} {
+        setupMesh(owner);
+        // The GPU has its own copy now, clear() would keep the capacity
+        if(!keepGeometry)
+        {
+            std::vector<Vertex>().swap(Mesh::vertices);
+            std::vector<unsigned>().swap(Mesh::indices);
+        }
     }
 
 static std::vector<Vertex> rawToVertices(float *verticesRaw, int numOfVertices) {
@@ -31,7 +43,7 @@ static std::vector<unsigned> rawToIndices(unsigned *indicesRaw, int numOfIndices
 }
 
 Mesh::Mesh(float *vertices, int numOfVertices, unsigned *indices, int numOfIndices, MaterialTexture &material)
-    : vertices{rawToVertices(vertices, numOfVertices)}, indices{rawToIndices(indices, numOfIndices)} {
+    : indexCount{(unsigned)numOfIndices}, vertices{rawToVertices(vertices, numOfVertices)}, indices{rawToIndices(indices, numOfIndices)} {
         Mesh::textures.push_back(material.getDiffuse());
         Mesh::textures.push_back(material.getSpecular());
     }
@@ -63,23 +75,29 @@ void Mesh::draw(Shader &shader) {
         shader.setUniform1i(name, i);
         textures[i].active(GL_TEXTURE0 + i);
     }
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    // Left bound, the next mesh of the same model draws without a bind
+    stateBindVertexArray(VAO);
+    glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+}
+
+void Mesh::del() {
+    stateDeleteVertexArrays(1, &VAO);
+    memoryDeleteBuffers(1, &VBO);
+    memoryDeleteBuffers(1, &EBO);
 }
 
-void Mesh::setupMesh() {
+void Mesh::setupMesh(const std::string &owner) {
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
     glGenBuffers(1, &EBO);
 
-    glBindVertexArray(VAO);
+    stateBindVertexArray(VAO);
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+    stateBindBuffer(GL_ARRAY_BUFFER, VBO);
+    memoryBufferData(GL_ARRAY_BUFFER, VBO, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW, GEOMETRY, owner);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned), &indices[0], GL_STATIC_DRAW);
+    stateBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    memoryBufferData(GL_ELEMENT_ARRAY_BUFFER, EBO, indices.size() * sizeof(unsigned), &indices[0], GL_STATIC_DRAW, GEOMETRY, owner);
 
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)0);
     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, normal));
@@ -93,5 +111,5 @@ void Mesh::setupMesh() {
     glEnableVertexAttribArray(3);
     glEnableVertexAttribArray(4);
 
-    glBindVertexArray(0);
+    stateBindVertexArray(0);
 }
\ No newline at end of file
@@ -22,14 +22,20 @@ struct Vertex {
 
 class Mesh {
     unsigned VBO, EBO, VAO;
-    void setupMesh();
+    unsigned indexCount;
+    void setupMesh(const std::string &owner);
 public:
+    // CPU side copy of the geometry, empty once uploaded unless the mesh was created with keepGeometry
     std::vector<Vertex> vertices;
     std::vector<unsigned> indices;
     std::vector<Texture2D> textures;
-    Mesh(std::vector<Vertex> &vertices, std::vector<unsigned> &indices, std::vector<Texture2D> &textures);
+    // Takes over the vectors, keepGeometry holds on to vertices and indices for code that reads them after upload.
+    // The buffers are accounted to owner
+    Mesh(std::vector<Vertex> &&vertices, std::vector<unsigned> &&indices, std::vector<Texture2D> &&textures,
+         const std::string &owner, bool keepGeometry = false);
     Mesh(float *vertices, int numOfVertices, unsigned *indices, int numOfIndices, MaterialTexture &material);
     void draw(Shader &shader);
+    void del();
 };
 
 
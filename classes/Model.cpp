@@ -4,9 +4,21 @@
 
 #include "Model.h"
 #include "error.h"
+#include "Profiler.h"
 
-Model::Model(const std::string &path) {
-    loadModel(path);
+#include <limits>
+#include <utility>
+
+static void processNode(aiNode *node, const aiScene *scene, ModelData &data);
+static MeshData processMesh(aiMesh *mesh, const aiScene *scene, ModelData &data);
+static void loadMaterialTextures(aiMaterial *mat, aiTextureType type, MeshData &meshData);
+
+Model::Model(const std::string &path, bool keepGeometry) : path{path}, keepGeometry{keepGeometry} {
+    ModelData data;
+    CHECK_ERROR(ModelData::import(path, data), "Model loading failed");
+    CHECK_ERROR(build(data, loadedTextures, meshes), "Model loading failed");
+    boundsMin = data.boundsMin;
+    boundsMax = data.boundsMax;
 }
 
 void Model::draw(Shader &shader) {
@@ -14,30 +26,110 @@ void Model::draw(Shader &shader) {
         mesh.draw(shader);
 }
 
-void Model::loadModel(const std::string &path) {
+bool Model::build(ModelData &data, std::map<std::string, AssetHandle<Texture2D>> &newTextures, std::vector<Mesh> &newMeshes) {
+    PROFILE_SCOPE("upload model");
+    // Textures first, they are the only part that can fail
+    for(MeshData &meshData : data.meshes)
+        for(auto &texture : meshData.textures)
+        {
+            if(newTextures.count(texture.first))
+                continue;
+            std::string texturePath = data.directory + '/' + texture.first;
+            auto image = data.images.find(texture.first);
+            AssetHandle<Texture2D> handle = image == data.images.end() ? assetTexture(texturePath, texture.second)
+                                                                        : assetTexture(texturePath, texture.second, image->second);
+            if(!handle)
+            {
+                newTextures.clear();
+                return false;
+            }
+            newTextures[texture.first] = handle;
+        }
+    for(MeshData &meshData : data.meshes)
+    {
+        std::vector<Texture2D> textures;
+        for(auto &texture : meshData.textures)
+            textures.push_back(*newTextures[texture.first]);
+        // The imported geometry is moved all the way to the upload, never copied
+        newMeshes.push_back(Mesh(std::move(meshData.vertices), std::move(meshData.indices), std::move(textures), path, keepGeometry));
+    }
+    return true;
+}
+
+void Model::del() {
+    for(Mesh &mesh : meshes)
+        mesh.del();
+    meshes.clear();
+    loadedTextures.clear();
+}
+
+bool Model::reload(ModelData &data) {
+    std::map<std::string, AssetHandle<Texture2D>> newTextures;
+    std::vector<Mesh> newMeshes;
+    if(!build(data, newTextures, newMeshes))
+        return false;
+    del();
+    meshes.swap(newMeshes);
+    loadedTextures.swap(newTextures);
+    boundsMin = data.boundsMin;
+    boundsMax = data.boundsMax;
+    return true;
+}
+
+bool ModelData::decodeTextures() {
+    for(MeshData &mesh : meshes)
+        for(auto &texture : mesh.textures)
+        {
+            if(images.count(texture.first))
+                continue;
+            ImageData image;
+            if(!ImageData::load(directory + '/' + texture.first, image))
+            {
+                freeImages();
+                return false;
+            }
+            images[texture.first] = image;
+        }
+    return true;
+}
+
+void ModelData::freeImages() {
+    for(auto &it : images)
+        it.second.free();
+    images.clear();
+}
+
+bool ModelData::import(const std::string &path, ModelData &data) {
+    PROFILE_SCOPE("import model");
     Assimp::Importer importer;
     unsigned flags = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
     const aiScene *scene = importer.ReadFile(path, flags);
     if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
-        CHECK_ERROR(0, "Model loading failed");
-    directory = path.substr(0, path.find_last_of('/'));
-    processNode(scene->mRootNode, scene);
+        return false;
+    data.directory = path.substr(0, path.find_last_of('/'));
+    data.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    data.boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+    processNode(scene->mRootNode, scene, data);
+    return true;
 }
 
-void Model::processNode(aiNode *node, const aiScene *scene) {
+static void processNode(aiNode *node, const aiScene *scene, ModelData &data) {
     for(int i = 0; i < node->mNumMeshes; i++)
     {
         aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
-        meshes.push_back(processMesh(mesh, scene));
+        data.meshes.push_back(processMesh(mesh, scene, data));
     }
     for(int i = 0; i < node->mNumChildren; i++)
-        processNode(node->mChildren[i], scene);
+        processNode(node->mChildren[i], scene, data);
 }
 
-Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene) {
-    std::vector<Vertex> vertices;
-    std::vector<unsigned> indices;
-    std::vector<Texture2D> textures;
+static MeshData processMesh(aiMesh *mesh, const aiScene *scene, ModelData &data) {
+    MeshData meshData;
+    std::vector<Vertex> &vertices = meshData.vertices;
+    std::vector<unsigned> &indices = meshData.indices;
+    vertices.reserve(mesh->mNumVertices);
+    // Triangulated, three indices per face
+    indices.reserve(mesh->mNumFaces * 3);
 
     for(int i = 0; i < mesh->mNumVertices; i++)
     {
@@ -75,6 +167,8 @@ Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene) {
         }
         else
             vertex.texCoords = glm::vec2(0.0, 0.0);
+        data.boundsMin = glm::min(data.boundsMin, vertex.position);
+        data.boundsMax = glm::max(data.boundsMax, vertex.position);
         vertices.push_back(vertex);
     }
 
@@ -86,49 +180,35 @@ Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene) {
     }
 
     aiMaterial *material = scene->mMaterials[mesh->mMaterialIndex];
-    loadMaterialTextures(material, aiTextureType_DIFFUSE, textures);
-    loadMaterialTextures(material, aiTextureType_SPECULAR, textures);
-    loadMaterialTextures(material, aiTextureType_NORMALS, textures);
-    loadMaterialTextures(material, aiTextureType_HEIGHT, textures);
+    loadMaterialTextures(material, aiTextureType_DIFFUSE, meshData);
+    loadMaterialTextures(material, aiTextureType_SPECULAR, meshData);
+    loadMaterialTextures(material, aiTextureType_NORMALS, meshData);
+    loadMaterialTextures(material, aiTextureType_HEIGHT, meshData);
 
-    return Mesh(vertices, indices, textures);
+    return meshData;
 }
 
-void Model::loadMaterialTextures(aiMaterial *mat, aiTextureType type, std::vector<Texture2D> &textures) {
+static void loadMaterialTextures(aiMaterial *mat, aiTextureType type, MeshData &meshData) {
     for(int i = 0; i < mat->GetTextureCount(type); i++)
     {
         aiString str;
         mat->GetTexture(type, i, &str);
-        bool skip = false;
-
-        auto it = loadedTextures.find(str.C_Str());
-        if(it != loadedTextures.end())
+        texType t_type;
+        switch(type)
         {
-            textures.push_back(it->second);
-            skip = true;
-        }
-
-        if(!skip)
-        {
-            texType t_type;
-            switch(type)
-            {
-                case aiTextureType_DIFFUSE:
-                    t_type = DIFFUSE;
-                    break;
-                case aiTextureType_SPECULAR:
-                    t_type = SPECULAR;
-                    break;
-                case aiTextureType_NORMALS:
-                    t_type = NORMAL;
-                    break;
-                case aiTextureType_HEIGHT:
-                    t_type = HEIGHT;
-                    break;
-            }
-            Texture2D tex(directory + '/' + str.C_Str(), t_type, GL_REPEAT, GL_LINEAR);
-            textures.push_back(tex);
-            loadedTextures.insert(std::make_pair(str.C_Str(), tex));
+            case aiTextureType_DIFFUSE:
+                t_type = DIFFUSE;
+                break;
+            case aiTextureType_SPECULAR:
+                t_type = SPECULAR;
+                break;
+            case aiTextureType_NORMALS:
+                t_type = NORMAL;
+                break;
+            case aiTextureType_HEIGHT:
+                t_type = HEIGHT;
+                break;
         }
+        meshData.textures.push_back(std::make_pair(std::string(str.C_Str()), t_type));
     }
 }
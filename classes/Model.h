@@ -8,6 +8,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <utility>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
@@ -15,18 +16,50 @@
 #include "Texture2D.h"
 #include "Shader.h"
 #include "Mesh.h"
+#include "AssetRegistry.h"
 
-class Model {
+// Geometry of one mesh as imported, before anything is uploaded to the GPU
+struct MeshData {
+    std::vector<Vertex> vertices;
+    std::vector<unsigned> indices;
+    std::vector<std::pair<std::string, texType>> textures;
+};
+
+// Everything Assimp produces for a model, can be imported on any thread
+struct ModelData {
     std::string directory;
-    void loadModel(const std::string &path);
-    void processNode(aiNode *node, const aiScene *scene);
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene);
-    void loadMaterialTextures(aiMaterial *mat, aiTextureType type, std::vector<Texture2D> &textures);
+    std::vector<MeshData> meshes;
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+    // Images of the textures by file name, filled by decodeTextures() so the GL thread only has to upload them
+    std::map<std::string, ImageData> images;
+    static bool import(const std::string &path, ModelData &data);
+    // Decodes every texture the meshes refer to, false if any of them can't be read
+    bool decodeTextures();
+    void freeImages();
+};
+
+class Model {
+    std::string path;
+    bool keepGeometry;
+    // Creates the textures and meshes of data without touching the current ones, moves the geometry out of
+    // data. False if a texture couldn't be created, whatever was built is released again
+    bool build(ModelData &data, std::map<std::string, AssetHandle<Texture2D>> &newTextures, std::vector<Mesh> &newMeshes);
 public:
-    std::map<std::string, Texture2D> loadedTextures;
+    // Textures of the meshes by file name, shared through the registry with every other user of the image
+    std::map<std::string, AssetHandle<Texture2D>> loadedTextures;
     std::vector<Mesh> meshes;
-    Model(const std::string &path);
+    // Object space bounding box over all meshes, used for visibility tests
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+    // Meshes drop their CPU side geometry after upload, keepGeometry holds on to it for picking and the like
+    Model(const std::string &path, bool keepGeometry = false);
     void draw(Shader &shader);
+    // Releases the meshes and drops the textures
+    void del();
+    // Replaces the meshes with freshly imported ones, the GL objects of the old meshes are released once the
+    // new ones are all built. On failure the old meshes stay. The geometry is moved out of data
+    bool reload(ModelData &data);
 };
 
 
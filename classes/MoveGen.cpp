@@ -0,0 +1,410 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#include "MoveGen.h"
+
+static void addPromotions(MoveList &list, int from, int to, bool capture, genType gen) {
+    int flags = capture ? PROMOTION_CAPTURE : PROMOTION;
+    list.add(encodeMove(from, to, flags | (QUEEN - KNIGHT)));
+    if(gen == ALL_MOVES)
+    {
+        list.add(encodeMove(from, to, flags | (ROOK - KNIGHT)));
+        list.add(encodeMove(from, to, flags | (BISHOP - KNIGHT)));
+        list.add(encodeMove(from, to, flags | (KNIGHT - KNIGHT)));
+    }
+}
+
+static Bitboard pieceAttacks(type t, int square, Bitboard occupancy) {
+    switch(t)
+    {
+        case KNIGHT:
+            return knightAttacks(square);
+        case BISHOP:
+            return bishopAttacks(square, occupancy);
+        case ROOK:
+            return rookAttacks(square, occupancy);
+        case QUEEN:
+            return queenAttacks(square, occupancy);
+        default:
+            return 0;
+    }
+}
+
+static void generateCastling(const Position &pos, MoveList &list, color us) {
+    int rights = pos.getCastlingRights();
+    Bitboard occupancy = pos.getOccupancy();
+    color them = (color)!us;
+    int king = us == WHITE ? 4 : 60;
+    int rook = makePiece(us, ROOK);
+    int kingSide = us == WHITE ? WHITE_OO : BLACK_OO;
+    int queenSide = us == WHITE ? WHITE_OOO : BLACK_OOO;
+    // Rights from a FEN don't prove the king is still home
+    if(pos.pieceOn(king) != makePiece(us, KING))
+        return;
+
+    if((rights & kingSide) && pos.pieceOn(king + 3) == rook
+       && !(occupancy & (squareBB(king + 1) | squareBB(king + 2)))
+       && !pos.isAttacked(king + 1, them) && !pos.isAttacked(king + 2, them))
+        list.add(encodeMove(king, king + 2, KING_CASTLE));
+    if((rights & queenSide) && pos.pieceOn(king - 4) == rook
+       && !(occupancy & (squareBB(king - 1) | squareBB(king - 2) | squareBB(king - 3)))
+       && !pos.isAttacked(king - 1, them) && !pos.isAttacked(king - 2, them))
+        list.add(encodeMove(king, king - 2, QUEEN_CASTLE));
+}
+
+void generateMoves(const Position &pos, MoveList &list, genType gen) {
+    color us = pos.getSideToMove(), them = (color)!us;
+    Bitboard ours = pos.getOccupancy(us), theirs = pos.getOccupancy(them), occupancy = pos.getOccupancy();
+    int king = pos.kingSquare(us);
+    Bitboard checkers = pos.attackersTo(king, occupancy) & theirs;
+
+    // The king can't step along the line of a slider checking it, so it's taken off the board for the test
+    Bitboard kingTargets = kingAttacks(king) & ~ours & (gen == CAPTURES ? theirs : ~0ULL);
+    Bitboard withoutKing = occupancy ^ squareBB(king);
+    while(kingTargets)
+    {
+        int to = popLsb(kingTargets);
+        if(!(pos.attackersTo(to, withoutKing) & theirs))
+            list.add(encodeMove(king, to, (theirs & squareBB(to)) ? CAPTURE : QUIET));
+    }
+    // Against a double check only the king can move
+    if(moreThanOne(checkers))
+        return;
+
+    // Out of check, every other move has to capture the checker or block it
+    Bitboard targets = checkers ? betweenBB(king, lsb(checkers)) | checkers : ~0ULL;
+    Bitboard captureTargets = theirs & targets;
+    Bitboard quietTargets = ~occupancy & targets;
+    Bitboard moveTargets = gen == CAPTURES ? captureTargets : captureTargets | quietTargets;
+
+    Bitboard pinned = 0;
+    Bitboard snipers = (rookAttacks(king, 0) & (pos.getPieces(them, ROOK) | pos.getPieces(them, QUEEN)))
+                     | (bishopAttacks(king, 0) & (pos.getPieces(them, BISHOP) | pos.getPieces(them, QUEEN)));
+    while(snipers)
+    {
+        Bitboard blockers = betweenBB(king, popLsb(snipers)) & occupancy;
+        if(blockers && !moreThanOne(blockers) && (blockers & ours))
+            pinned |= blockers;
+    }
+
+    for(int t = KNIGHT; t <= QUEEN; t++)
+    {
+        Bitboard figures = pos.getPieces(us, (type)t);
+        // A pinned knight can never move
+        if(t == KNIGHT)
+            figures &= ~pinned;
+        while(figures)
+        {
+            int from = popLsb(figures);
+            Bitboard attacks = pieceAttacks((type)t, from, occupancy) & moveTargets;
+            if(pinned & squareBB(from))
+                attacks &= lineBB(king, from);
+            while(attacks)
+            {
+                int to = popLsb(attacks);
+                list.add(encodeMove(from, to, (theirs & squareBB(to)) ? CAPTURE : QUIET));
+            }
+        }
+    }
+
+    int up = us == WHITE ? 8 : -8;
+    Bitboard lastRank = us == WHITE ? RANK_8 : RANK_1;
+    Bitboard doublePushRank = us == WHITE ? RANK_1 << 16 : RANK_1 << 40;
+    int epSquare = pos.getEpSquare();
+    Bitboard pawns = pos.getPieces(us, PAWN);
+    while(pawns)
+    {
+        int from = popLsb(pawns);
+        Bitboard allowed = (pinned & squareBB(from)) ? lineBB(king, from) : ~0ULL;
+
+        int to = from + up;
+        if(!(occupancy & squareBB(to)))
+        {
+            if(quietTargets & allowed & squareBB(to))
+            {
+                if(lastRank & squareBB(to))
+                    addPromotions(list, from, to, false, gen);
+                else if(gen == ALL_MOVES)
+                    list.add(encodeMove(from, to, QUIET));
+            }
+            int twoUp = to + up;
+            if(gen == ALL_MOVES && (doublePushRank & squareBB(to)) && (quietTargets & allowed & squareBB(twoUp)))
+                list.add(encodeMove(from, twoUp, DOUBLE_PAWN_PUSH));
+        }
+
+        Bitboard captures = pawnAttacks(us, from) & captureTargets & allowed;
+        while(captures)
+        {
+            to = popLsb(captures);
+            if(lastRank & squareBB(to))
+                addPromotions(list, from, to, true, gen);
+            else
+                list.add(encodeMove(from, to, CAPTURE));
+        }
+
+        // En passant removes two pieces from one line, so it's verified on the resulting occupancy
+        if(epSquare != NO_SQUARE && (pawnAttacks(us, from) & squareBB(epSquare)))
+        {
+            int captured = epSquare - up;
+            Bitboard after = (occupancy ^ squareBB(from) ^ squareBB(captured)) | squareBB(epSquare);
+            if(!(pos.attackersTo(king, after) & theirs & ~squareBB(captured)))
+                list.add(encodeMove(from, epSquare, EN_PASSANT));
+        }
+    }
+
+    if(gen == ALL_MOVES && !checkers)
+        generateCastling(pos, list, us);
+}
+
+Move findLegalMove(const Position &pos, int from, int to, type promotion) {
+    MoveList list;
+    generateMoves(pos, list);
+    for(Move m : list)
+        if(moveFrom(m) == from && moveTo(m) == to && (!isPromotion(m) || promotionType(m) == promotion))
+            return m;
+    return NO_MOVE;
+}
+
+std::string moveToString(Move m) {
+    if(m == NO_MOVE)
+        return "0000";
+    std::string text;
+    text += (char)('a' + fileOf(moveFrom(m)));
+    text += (char)('1' + rankOf(moveFrom(m)));
+    text += (char)('a' + fileOf(moveTo(m)));
+    text += (char)('1' + rankOf(moveTo(m)));
+    if(isPromotion(m))
+        text += "nbrq"[promotionType(m) - KNIGHT];
+    return text;
+}
+
+std::string moveToSan(Position &pos, Move m) {
+    int from = moveFrom(m), to = moveTo(m);
+    std::string text;
+    if(moveFlags(m) == KING_CASTLE)
+        text = "O-O";
+    else if(moveFlags(m) == QUEEN_CASTLE)
+        text = "O-O-O";
+    else
+    {
+        int piece = pos.pieceOn(from);
+        if(pieceType(piece) == PAWN)
+        {
+            if(isCapture(m))
+                text += (char)('a' + fileOf(from));
+        }
+        else
+        {
+            text += "PNBRQK"[pieceType(piece)];
+            // Origin file, else rank, else both, when another piece of the kind can go there too
+            MoveList list;
+            generateMoves(pos, list);
+            bool ambiguous = false, sameFile = false, sameRank = false;
+            for(Move other : list)
+            {
+                if(other == m || moveTo(other) != to || pos.pieceOn(moveFrom(other)) != piece)
+                    continue;
+                ambiguous = true;
+                sameFile = sameFile || fileOf(moveFrom(other)) == fileOf(from);
+                sameRank = sameRank || rankOf(moveFrom(other)) == rankOf(from);
+            }
+            if(ambiguous && (!sameFile || sameRank))
+                text += (char)('a' + fileOf(from));
+            if(ambiguous && sameFile)
+                text += (char)('1' + rankOf(from));
+        }
+        if(isCapture(m))
+            text += 'x';
+        text += (char)('a' + fileOf(to));
+        text += (char)('1' + rankOf(to));
+        if(isPromotion(m))
+        {
+            text += '=';
+            text += "NBRQ"[promotionType(m) - KNIGHT];
+        }
+    }
+    pos.makeMove(m);
+    if(pos.inCheck())
+    {
+        MoveList replies;
+        generateMoves(pos, replies);
+        text += replies.size() ? '+' : '#';
+    }
+    pos.unmakeMove();
+    return text;
+}
+
+Move parseMove(const Position &pos, const std::string &text) {
+    if(text.size() < 4 || text[0] < 'a' || text[0] > 'h' || text[1] < '1' || text[1] > '8'
+       || text[2] < 'a' || text[2] > 'h' || text[3] < '1' || text[3] > '8')
+        return NO_MOVE;
+    int from = makeSquare(text[0] - 'a', text[1] - '1');
+    int to = makeSquare(text[2] - 'a', text[3] - '1');
+    type promotion = QUEEN;
+    if(text.size() > 4)
+    {
+        switch(text[4])
+        {
+            case 'n':
+                promotion = KNIGHT;
+                break;
+            case 'b':
+                promotion = BISHOP;
+                break;
+            case 'r':
+                promotion = ROOK;
+                break;
+            default:
+                break;
+        }
+    }
+    return findLegalMove(pos, from, to, promotion);
+}
+
+// Whether a move of a piece other than the king leaves its own king safe, the occupancy after the move covers
+// checks, pins and en passant at once
+static bool keepsKingSafe(const Position &pos, int from, int to, int captured) {
+    color us = pos.getSideToMove();
+    Bitboard after = (pos.getOccupancy() ^ squareBB(from) ^ squareBB(captured)) | squareBB(to);
+    return !(pos.attackersTo(pos.kingSquare(us), after) & pos.getOccupancy((color)!us) & ~squareBB(captured));
+}
+
+Move parseSan(const Position &pos, const char *text, const char *end) {
+    // Check marks and annotations carry nothing the move needs
+    while(end > text && (end[-1] == '+' || end[-1] == '#' || end[-1] == '!' || end[-1] == '?'))
+        end--;
+    color us = pos.getSideToMove();
+    int length = (int)(end - text);
+    if(length >= 3 && (text[0] == 'O' || text[0] == '0'))
+    {
+        bool queenSide = length >= 5;
+        int king = us == WHITE ? 4 : 60;
+        MoveList list;
+        if(!pos.inCheck())
+            generateCastling(pos, list, us);
+        for(Move m : list)
+            if(moveFlags(m) == (queenSide ? QUEEN_CASTLE : KING_CASTLE) && moveFrom(m) == king)
+                return m;
+        return NO_MOVE;
+    }
+
+    type piece = PAWN;
+    switch(length ? text[0] : 0)
+    {
+        case 'N':
+            piece = KNIGHT;
+            break;
+        case 'B':
+            piece = BISHOP;
+            break;
+        case 'R':
+            piece = ROOK;
+            break;
+        case 'Q':
+            piece = QUEEN;
+            break;
+        case 'K':
+            piece = KING;
+            break;
+        default:
+            break;
+    }
+    if(piece != PAWN)
+        text++;
+
+    // A promotion is written e8=Q, some programs leave out the equals sign
+    type promotion = PAWN;
+    if(end - text >= 3 && end[-1] >= 'B' && end[-1] <= 'R')
+    {
+        const char *pieces = "NBRQ";
+        for(int t = 0; t < 4; t++)
+            if(end[-1] == pieces[t])
+                promotion = (type)(KNIGHT + t);
+        if(promotion == PAWN)
+            return NO_MOVE;
+        end -= end[-2] == '=' ? 2 : 1;
+    }
+    if(piece != PAWN && promotion != PAWN)
+        return NO_MOVE;
+    if(end - text < 2 || end[-2] < 'a' || end[-2] > 'h' || end[-1] < '1' || end[-1] > '8')
+        return NO_MOVE;
+    int to = makeSquare(end[-2] - 'a', end[-1] - '1');
+    end -= 2;
+
+    // Whatever is left between the piece and the destination narrows down the origin
+    Bitboard fromMask = ~0ULL;
+    for(; text < end; text++)
+    {
+        if(*text >= 'a' && *text <= 'h')
+            fromMask &= FILE_A << (*text - 'a');
+        else if(*text >= '1' && *text <= '8')
+            fromMask &= RANK_1 << (8 * (*text - '1'));
+        else if(*text != 'x' && *text != ':' && *text != '-')
+            return NO_MOVE;
+    }
+
+    Bitboard occupancy = pos.getOccupancy(), theirs = pos.getOccupancy((color)!us);
+    if(pos.getOccupancy(us) & squareBB(to))
+        return NO_MOVE;
+    bool capture = (theirs & squareBB(to)) != 0;
+    int flags = capture ? CAPTURE : QUIET;
+    int captured = to;
+    Bitboard candidates;
+    if(piece == PAWN)
+    {
+        int up = us == WHITE ? 8 : -8;
+        bool lastRank = rankOf(to) == (us == WHITE ? 7 : 0);
+        // No pawn move ends on the mover's first rank, and the square behind it would be off the board
+        if(rankOf(to) == (us == WHITE ? 0 : 7))
+            return NO_MOVE;
+        if(lastRank != (promotion != PAWN))
+            return NO_MOVE;
+        if(lastRank)
+            flags = (capture ? PROMOTION_CAPTURE : PROMOTION) | (promotion - KNIGHT);
+        // Pawn captures always name the file they come from, pushes never do
+        if(fromMask != ~0ULL)
+        {
+            candidates = pawnAttacks((color)!us, to);
+            if(!capture && to == pos.getEpSquare())
+            {
+                flags = EN_PASSANT;
+                captured = to - up;
+            }
+            else if(!capture)
+                return NO_MOVE;
+        }
+        else if(capture)
+            return NO_MOVE;
+        else
+        {
+            // A push comes from straight behind, from two squares behind only on the fourth rank
+            candidates = squareBB(to - up);
+            if(!(occupancy & squareBB(to - up)) && rankOf(to) == (us == WHITE ? 3 : 4))
+            {
+                candidates = squareBB(to - 2 * up);
+                flags = DOUBLE_PAWN_PUSH;
+            }
+        }
+    }
+    else if(piece == KING)
+        candidates = kingAttacks(to);
+    else
+        candidates = pieceAttacks(piece, to, occupancy);
+    candidates &= pos.getPieces(us, piece) & fromMask;
+
+    Move move = NO_MOVE;
+    while(candidates)
+    {
+        int from = popLsb(candidates);
+        bool legal = piece == KING ? !(pos.attackersTo(to, occupancy ^ squareBB(from)) & theirs)
+                                   : keepsKingSafe(pos, from, to, captured);
+        if(!legal)
+            continue;
+        // Two legal candidates left means the notation is ambiguous
+        if(move != NO_MOVE)
+            return NO_MOVE;
+        move = encodeMove(from, to, flags);
+    }
+    return move;
+}
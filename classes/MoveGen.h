@@ -0,0 +1,71 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#ifndef RG_3D_SAH_MOVEGEN_H
+#define RG_3D_SAH_MOVEGEN_H
+
+#include <string>
+
+#include "ChessTypes.h"
+#include "Position.h"
+
+// No legal chess position has more moves than this
+const int MAX_MOVES = 256;
+
+// Fixed capacity list filled in by the generator, lives on the caller's stack
+struct MoveList {
+    Move moves[MAX_MOVES];
+    int count = 0;
+
+    void add(Move m) {
+        moves[count++] = m;
+    }
+    int size() const {
+        return count;
+    }
+    Move *begin() {
+        return moves;
+    }
+    Move *end() {
+        return moves + count;
+    }
+    const Move *begin() const {
+        return moves;
+    }
+    const Move *end() const {
+        return moves + count;
+    }
+    bool contains(Move m) const {
+        for(int i = 0; i < count; i++)
+            if(moves[i] == m)
+                return true;
+        return false;
+    }
+};
+
+enum genType {
+    ALL_MOVES,
+    // Captures and promotions only, for quiescence search
+    CAPTURES
+};
+
+// Appends all legal moves of the side to move, pins and checks are resolved during generation so nothing
+// has to be made and tested afterwards
+void generateMoves(const Position &pos, MoveList &list, genType gen = ALL_MOVES);
+
+// Legal move from origin to destination, promotions default to the given piece, NO_MOVE if there is none
+Move findLegalMove(const Position &pos, int from, int to, type promotion = QUEEN);
+
+// Long algebraic notation as used by UCI, e.g. e2e4 or e7e8q
+std::string moveToString(Move m);
+// Standard algebraic notation of a legal move, the move is made and unmade to see whether it checks or mates
+std::string moveToSan(Position &pos, Move m);
+// Legal move written in long algebraic notation, NO_MOVE if it isn't one
+Move parseMove(const Position &pos, const std::string &text);
+// Legal move written in standard algebraic notation, e.g. Nbd7, exd6, e8=Q+ or O-O, read from text up to end.
+// Only the candidates for the destination are tested instead of generating every move. NO_MOVE if it isn't
+// a legal move or doesn't tell the candidates apart
+Move parseSan(const Position &pos, const char *text, const char *end);
+
+#endif //RG_3D_SAH_MOVEGEN_H
@@ -0,0 +1,457 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#include "Nnue.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <immintrin.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+const uint32_t NNUE_VERSION = 0x7AF32F16;
+const int L1_INPUTS = 2 * NNUE_HALF_DIMENSIONS;
+const int L1_OUTPUTS = 32;
+const int L2_OUTPUTS = 32;
+// Hidden layers shift their sums down by this many bits, the output is divided by OUTPUT_SCALE
+const int WEIGHT_SCALE_BITS = 6;
+const int OUTPUT_SCALE = 16;
+// The networks were trained with an endgame pawn worth 208 internal units
+const int NETWORK_PAWN_VALUE = 208;
+
+// Most features a single accumulator update may touch before building from scratch is cheaper
+const int MAX_UPDATE_FEATURES = 32;
+// Pieces other than the kings, setFen refuses more than 16 a side
+const int MAX_ACTIVE_FEATURES = 30;
+
+static bool loaded = false;
+static int16_t *ftBiases = nullptr;
+static int16_t *ftWeights = nullptr;
+alignas(64) static int32_t l1Biases[L1_OUTPUTS];
+alignas(64) static int8_t l1Weights[L1_OUTPUTS * L1_INPUTS];
+alignas(64) static int32_t l2Biases[L2_OUTPUTS];
+alignas(64) static int8_t l2Weights[L2_OUTPUTS * L1_OUTPUTS];
+static int32_t outputBias;
+alignas(64) static int8_t outputWeights[L2_OUTPUTS];
+
+// Kernels, picked once for the CPU the program runs on
+
+static void addFeaturesScalar(int16_t *dst, const int16_t *src, const int *added, int addedCount, const int *removed, int removedCount) {
+    for(int i = 0; i < NNUE_HALF_DIMENSIONS; i++)
+    {
+        int v = src[i];
+        for(int r = 0; r < removedCount; r++)
+            v -= ftWeights[removed[r] * NNUE_HALF_DIMENSIONS + i];
+        for(int a = 0; a < addedCount; a++)
+            v += ftWeights[added[a] * NNUE_HALF_DIMENSIONS + i];
+        dst[i] = (int16_t)v;
+    }
+}
+
+static void transformScalar(const int16_t *us, const int16_t *them, uint8_t *out) {
+    for(int i = 0; i < NNUE_HALF_DIMENSIONS; i++)
+    {
+        out[i] = (uint8_t)std::min(127, std::max(0, (int)us[i]));
+        out[NNUE_HALF_DIMENSIONS + i] = (uint8_t)std::min(127, std::max(0, (int)them[i]));
+    }
+}
+
+static void affineScalar(const uint8_t *in, int inputs, const int8_t *weights, const int32_t *biases, int32_t *out, int outputs) {
+    for(int o = 0; o < outputs; o++)
+    {
+        int32_t sum = biases[o];
+        const int8_t *row = weights + o * inputs;
+        for(int i = 0; i < inputs; i++)
+            sum += in[i] * row[i];
+        out[o] = sum;
+    }
+}
+
+// 256 int16 lanes are 16 AVX2 registers, the whole accumulator stays in registers while the columns are applied
+__attribute__((target("avx2")))
+static void addFeaturesAvx2(int16_t *dst, const int16_t *src, const int *added, int addedCount, const int *removed, int removedCount) {
+    __m256i acc[NNUE_HALF_DIMENSIONS / 16];
+    for(int j = 0; j < NNUE_HALF_DIMENSIONS / 16; j++)
+        acc[j] = _mm256_load_si256((const __m256i *)src + j);
+    for(int r = 0; r < removedCount; r++)
+    {
+        const __m256i *column = (const __m256i *)(ftWeights + removed[r] * NNUE_HALF_DIMENSIONS);
+        for(int j = 0; j < NNUE_HALF_DIMENSIONS / 16; j++)
+            acc[j] = _mm256_sub_epi16(acc[j], _mm256_load_si256(column + j));
+    }
+    for(int a = 0; a < addedCount; a++)
+    {
+        const __m256i *column = (const __m256i *)(ftWeights + added[a] * NNUE_HALF_DIMENSIONS);
+        for(int j = 0; j < NNUE_HALF_DIMENSIONS / 16; j++)
+            acc[j] = _mm256_add_epi16(acc[j], _mm256_load_si256(column + j));
+    }
+    for(int j = 0; j < NNUE_HALF_DIMENSIONS / 16; j++)
+        _mm256_store_si256((__m256i *)dst + j, acc[j]);
+}
+
+__attribute__((target("avx2")))
+static void transformAvx2(const int16_t *us, const int16_t *them, uint8_t *out) {
+    const __m256i zero = _mm256_setzero_si256(), limit = _mm256_set1_epi16(127);
+    const int16_t *halves[2] = {us, them};
+    for(int h = 0; h < 2; h++)
+        for(int j = 0; j < NNUE_HALF_DIMENSIONS / 32; j++)
+        {
+            __m256i a = _mm256_load_si256((const __m256i *)halves[h] + 2 * j);
+            __m256i b = _mm256_load_si256((const __m256i *)halves[h] + 2 * j + 1);
+            a = _mm256_min_epi16(_mm256_max_epi16(a, zero), limit);
+            b = _mm256_min_epi16(_mm256_max_epi16(b, zero), limit);
+            // Packing works within 128 bit lanes, the permute puts the quarters back in order
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+            _mm256_storeu_si256((__m256i *)(out + h * NNUE_HALF_DIMENSIONS) + j, packed);
+        }
+}
+
+__attribute__((target("avx2")))
+static inline int32_t horizontalSum(__m256i sum) {
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+    return _mm_cvtsi128_si32(s);
+}
+
+__attribute__((target("avx2")))
+static void affineAvx2(const uint8_t *in, int inputs, const int8_t *weights, const int32_t *biases, int32_t *out, int outputs) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    int o = 0;
+    // Four rows at a time share every load of the input
+    for(; o + 4 <= outputs; o += 4)
+    {
+        const int8_t *row = weights + o * inputs;
+        __m256i sum0 = _mm256_setzero_si256(), sum1 = sum0, sum2 = sum0, sum3 = sum0;
+        for(int i = 0; i < inputs; i += 32)
+        {
+            // u8 x i8 pairs summed to i16, then pairs of those to i32. Inputs are at most 127, so nothing saturates
+            __m256i x = _mm256_loadu_si256((const __m256i *)(in + i));
+            sum0 = _mm256_add_epi32(sum0, _mm256_madd_epi16(_mm256_maddubs_epi16(x, _mm256_load_si256((const __m256i *)(row + i))), ones));
+            sum1 = _mm256_add_epi32(sum1, _mm256_madd_epi16(_mm256_maddubs_epi16(x, _mm256_load_si256((const __m256i *)(row + inputs + i))), ones));
+            sum2 = _mm256_add_epi32(sum2, _mm256_madd_epi16(_mm256_maddubs_epi16(x, _mm256_load_si256((const __m256i *)(row + 2 * inputs + i))), ones));
+            sum3 = _mm256_add_epi32(sum3, _mm256_madd_epi16(_mm256_maddubs_epi16(x, _mm256_load_si256((const __m256i *)(row + 3 * inputs + i))), ones));
+        }
+        out[o] = biases[o] + horizontalSum(sum0);
+        out[o + 1] = biases[o + 1] + horizontalSum(sum1);
+        out[o + 2] = biases[o + 2] + horizontalSum(sum2);
+        out[o + 3] = biases[o + 3] + horizontalSum(sum3);
+    }
+    for(; o < outputs; o++)
+    {
+        const int8_t *row = weights + o * inputs;
+        __m256i sum = _mm256_setzero_si256();
+        for(int i = 0; i < inputs; i += 32)
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(_mm256_loadu_si256((const __m256i *)(in + i)),
+                                                                               _mm256_load_si256((const __m256i *)(row + i))), ones));
+        out[o] = biases[o] + horizontalSum(sum);
+    }
+}
+
+__attribute__((target("sse4.1")))
+static void addFeaturesSse41(int16_t *dst, const int16_t *src, const int *added, int addedCount, const int *removed, int removedCount) {
+    // Half the accumulator at a time, 16 registers of 8 lanes each
+    for(int half = 0; half < 2; half++)
+    {
+        const int offset = half * NNUE_HALF_DIMENSIONS / 2;
+        __m128i acc[NNUE_HALF_DIMENSIONS / 16];
+        for(int j = 0; j < NNUE_HALF_DIMENSIONS / 16; j++)
+            acc[j] = _mm_load_si128((const __m128i *)(src + offset) + j);
+        for(int r = 0; r < removedCount; r++)
+        {
+            const __m128i *column = (const __m128i *)(ftWeights + removed[r] * NNUE_HALF_DIMENSIONS + offset);
+            for(int j = 0; j < NNUE_HALF_DIMENSIONS / 16; j++)
+                acc[j] = _mm_sub_epi16(acc[j], _mm_load_si128(column + j));
+        }
+        for(int a = 0; a < addedCount; a++)
+        {
+            const __m128i *column = (const __m128i *)(ftWeights + added[a] * NNUE_HALF_DIMENSIONS + offset);
+            for(int j = 0; j < NNUE_HALF_DIMENSIONS / 16; j++)
+                acc[j] = _mm_add_epi16(acc[j], _mm_load_si128(column + j));
+        }
+        for(int j = 0; j < NNUE_HALF_DIMENSIONS / 16; j++)
+            _mm_store_si128((__m128i *)(dst + offset) + j, acc[j]);
+    }
+}
+
+__attribute__((target("sse4.1")))
+static void transformSse41(const int16_t *us, const int16_t *them, uint8_t *out) {
+    const __m128i zero = _mm_setzero_si128(), limit = _mm_set1_epi16(127);
+    const int16_t *halves[2] = {us, them};
+    for(int h = 0; h < 2; h++)
+        for(int j = 0; j < NNUE_HALF_DIMENSIONS / 16; j++)
+        {
+            __m128i a = _mm_load_si128((const __m128i *)halves[h] + 2 * j);
+            __m128i b = _mm_load_si128((const __m128i *)halves[h] + 2 * j + 1);
+            a = _mm_min_epi16(_mm_max_epi16(a, zero), limit);
+            b = _mm_min_epi16(_mm_max_epi16(b, zero), limit);
+            _mm_storeu_si128((__m128i *)(out + h * NNUE_HALF_DIMENSIONS) + j, _mm_packus_epi16(a, b));
+        }
+}
+
+__attribute__((target("sse4.1")))
+static void affineSse41(const uint8_t *in, int inputs, const int8_t *weights, const int32_t *biases, int32_t *out, int outputs) {
+    const __m128i ones = _mm_set1_epi16(1);
+    for(int o = 0; o < outputs; o++)
+    {
+        const int8_t *row = weights + o * inputs;
+        __m128i sum = _mm_setzero_si128();
+        for(int i = 0; i < inputs; i += 16)
+        {
+            __m128i products = _mm_maddubs_epi16(_mm_loadu_si128((const __m128i *)(in + i)),
+                                                 _mm_load_si128((const __m128i *)(row + i)));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(products, ones));
+        }
+        sum = _mm_hadd_epi32(sum, sum);
+        sum = _mm_hadd_epi32(sum, sum);
+        out[o] = biases[o] + _mm_cvtsi128_si32(sum);
+    }
+}
+
+static void (*addFeatures)(int16_t *, const int16_t *, const int *, int, const int *, int) = addFeaturesScalar;
+static void (*transform)(const int16_t *, const int16_t *, uint8_t *) = transformScalar;
+static void (*affine)(const uint8_t *, int, const int8_t *, const int32_t *, int32_t *, int) = affineScalar;
+static const char *kernelName = "scalar";
+
+static void selectKernels() {
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+    {
+        addFeatures = addFeaturesAvx2;
+        transform = transformAvx2;
+        affine = affineAvx2;
+        kernelName = "avx2";
+    }
+    else if(__builtin_cpu_supports("sse4.1"))
+    {
+        addFeatures = addFeaturesSse41;
+        transform = transformSse41;
+        affine = affineSse41;
+        kernelName = "sse4.1";
+    }
+}
+
+static void allocateFeatureTransformer() {
+    if(!ftWeights)
+    {
+        void *memory = nullptr;
+        if(posix_memalign(&memory, 64, (size_t)NNUE_FEATURES * NNUE_HALF_DIMENSIONS * sizeof(int16_t)) == 0)
+            ftWeights = (int16_t *)memory;
+        if(posix_memalign(&memory, 64, NNUE_HALF_DIMENSIONS * sizeof(int16_t)) == 0)
+            ftBiases = (int16_t *)memory;
+    }
+}
+
+// Reads little endian values out of the mapped file, failing once the end is passed
+struct Reader {
+    const uint8_t *ptr;
+    const uint8_t *end;
+
+    bool read(void *dst, size_t bytes) {
+        if((size_t)(end - ptr) < bytes)
+            return false;
+        std::memcpy(dst, ptr, bytes);
+        ptr += bytes;
+        return true;
+    }
+    bool readUint32(uint32_t &value) {
+        return read(&value, sizeof(value));
+    }
+    bool skip(size_t bytes) {
+        if((size_t)(end - ptr) < bytes)
+            return false;
+        ptr += bytes;
+        return true;
+    }
+};
+
+bool nnueLoad(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return false;
+    struct stat info;
+    if(fstat(fd, &info) != 0 || info.st_size <= 0)
+    {
+        close(fd);
+        return false;
+    }
+    void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapping == MAP_FAILED)
+        return false;
+    madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+
+    // The description is of any length, so nothing after it is aligned and the weights are copied out.
+    // The structure hashes aren't checked, the exact file size already rules out any other architecture
+    Reader reader = {(const uint8_t *)mapping, (const uint8_t *)mapping + info.st_size};
+    uint32_t version, hash, descriptionLength;
+    bool ok = reader.readUint32(version) && version == NNUE_VERSION && reader.readUint32(hash)
+              && reader.readUint32(descriptionLength) && reader.skip(descriptionLength);
+    allocateFeatureTransformer();
+    ok = ok && ftWeights && ftBiases && reader.readUint32(hash)
+         && reader.read(ftBiases, NNUE_HALF_DIMENSIONS * sizeof(int16_t))
+         && reader.read(ftWeights, (size_t)NNUE_FEATURES * NNUE_HALF_DIMENSIONS * sizeof(int16_t))
+         && reader.readUint32(hash)
+         && reader.read(l1Biases, sizeof(l1Biases)) && reader.read(l1Weights, sizeof(l1Weights))
+         && reader.read(l2Biases, sizeof(l2Biases)) && reader.read(l2Weights, sizeof(l2Weights))
+         && reader.read(&outputBias, sizeof(outputBias)) && reader.read(outputWeights, sizeof(outputWeights))
+         && reader.ptr == reader.end;
+    munmap(mapping, info.st_size);
+
+    loaded = ok;
+    if(ok)
+        selectKernels();
+    return ok;
+}
+
+void nnueInitRandom(uint64_t seed) {
+    allocateFeatureTransformer();
+    uint64_t state = seed;
+    auto next = [&state]() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545F4914F6CDD1DULL;
+    };
+    for(int i = 0; i < NNUE_HALF_DIMENSIONS; i++)
+        ftBiases[i] = (int16_t)(next() % 64);
+    for(size_t i = 0; i < (size_t)NNUE_FEATURES * NNUE_HALF_DIMENSIONS; i++)
+        ftWeights[i] = (int16_t)((int)(next() % 33) - 16);
+    for(int i = 0; i < L1_OUTPUTS; i++)
+        l1Biases[i] = (int32_t)(next() % 1024);
+    for(int8_t &w : l1Weights)
+        w = (int8_t)((int)(next() % 33) - 16);
+    for(int i = 0; i < L2_OUTPUTS; i++)
+        l2Biases[i] = (int32_t)(next() % 1024);
+    for(int8_t &w : l2Weights)
+        w = (int8_t)((int)(next() % 33) - 16);
+    outputBias = 0;
+    for(int8_t &w : outputWeights)
+        w = (int8_t)((int)(next() % 33) - 16);
+    loaded = true;
+    selectKernels();
+}
+
+bool nnueIsLoaded() {
+    return loaded;
+}
+
+const char *nnueKernels() {
+    return kernelName;
+}
+
+Accumulator *nnueAllocateAccumulators() {
+    void *memory = nullptr;
+    if(posix_memalign(&memory, 64, (MAX_GAME_PLY + 1) * sizeof(Accumulator)) != 0)
+        return nullptr;
+    return (Accumulator *)memory;
+}
+
+void nnueFreeAccumulators(Accumulator *stack) {
+    std::free(stack);
+}
+
+// Black sees the board rotated, so both perspectives look at it from their own side
+static int featureIndex(color perspective, int kingSquare, int piece, int square) {
+    int flip = perspective == WHITE ? 0 : 63;
+    // Own and enemy pieces alternate per type: own pawns at 1, enemy pawns at 65, own knights at 129 ...
+    int slot = 1 + (pieceType(piece) * 2 + (pieceColor(piece) == perspective ? 0 : 1)) * 64;
+    return (kingSquare ^ flip) * 641 + slot + (square ^ flip);
+}
+
+static void refreshAccumulator(const Position &pos, color perspective, int16_t *values) {
+    int features[MAX_ACTIVE_FEATURES];
+    int count = 0;
+    int kingSquare = pos.kingSquare(perspective);
+    Bitboard pieces = pos.getOccupancy() & ~(pos.getPieces(WHITE, KING) | pos.getPieces(BLACK, KING));
+    while(pieces && count < MAX_ACTIVE_FEATURES)
+    {
+        int square = popLsb(pieces);
+        features[count++] = featureIndex(perspective, kingSquare, pos.pieceOn(square), square);
+    }
+    addFeatures(values, ftBiases, features, count, nullptr, 0);
+}
+
+// Brings the perspective's accumulator at the current ply up to date from the nearest computed ply before it.
+// A move of that side's king changes every feature, the walk stops there and the accumulator is rebuilt
+static void updateAccumulator(const Position &pos, color perspective) {
+    Accumulator *stack = pos.getAccumulators();
+    int ply = pos.getGamePly();
+    int kingPiece = makePiece(perspective, KING);
+    int base = ply;
+    int changes = 0;
+    while(!stack[base].computed[perspective])
+    {
+        if(base == 0)
+            break;
+        const DirtyPieces &dirty = pos.dirtyPieces(base);
+        changes += dirty.count * 2;
+        if(dirty.piece[0] == kingPiece || changes > MAX_UPDATE_FEATURES)
+            break;
+        base--;
+    }
+
+    int16_t *values = stack[ply].values[perspective];
+    if(!stack[base].computed[perspective])
+        refreshAccumulator(pos, perspective, values);
+    else if(base < ply)
+    {
+        int added[MAX_UPDATE_FEATURES], removed[MAX_UPDATE_FEATURES];
+        int addedCount = 0, removedCount = 0;
+        int kingSquare = pos.kingSquare(perspective);
+        for(int p = base + 1; p <= ply; p++)
+        {
+            const DirtyPieces &dirty = pos.dirtyPieces(p);
+            for(int i = 0; i < dirty.count; i++)
+            {
+                if(pieceType(dirty.piece[i]) == KING)
+                    continue;
+                if(dirty.from[i] != NO_SQUARE)
+                    removed[removedCount++] = featureIndex(perspective, kingSquare, dirty.piece[i], dirty.from[i]);
+                if(dirty.to[i] != NO_SQUARE)
+                    added[addedCount++] = featureIndex(perspective, kingSquare, dirty.piece[i], dirty.to[i]);
+            }
+        }
+        addFeatures(values, stack[base].values[perspective], added, addedCount, removed, removedCount);
+    }
+    stack[ply].computed[perspective] = true;
+}
+
+int nnueEvaluate(const Position &pos) {
+    Accumulator local;
+    const Accumulator *accumulator;
+    if(pos.getAccumulators())
+    {
+        for(int c = BLACK; c <= WHITE; c++)
+            if(!pos.getAccumulators()[pos.getGamePly()].computed[c])
+                updateAccumulator(pos, (color)c);
+        accumulator = pos.getAccumulators() + pos.getGamePly();
+    }
+    else
+    {
+        refreshAccumulator(pos, BLACK, local.values[BLACK]);
+        refreshAccumulator(pos, WHITE, local.values[WHITE]);
+        accumulator = &local;
+    }
+
+    color us = pos.getSideToMove();
+    alignas(64) uint8_t input[L1_INPUTS];
+    alignas(64) int32_t hidden[L1_OUTPUTS];
+    alignas(64) uint8_t clipped[L1_OUTPUTS];
+    transform(accumulator->values[us], accumulator->values[!us], input);
+
+    affine(input, L1_INPUTS, l1Weights, l1Biases, hidden, L1_OUTPUTS);
+    for(int i = 0; i < L1_OUTPUTS; i++)
+        clipped[i] = (uint8_t)std::min(127, std::max(0, hidden[i] >> WEIGHT_SCALE_BITS));
+    affine(clipped, L1_OUTPUTS, l2Weights, l2Biases, hidden, L2_OUTPUTS);
+    for(int i = 0; i < L2_OUTPUTS; i++)
+        clipped[i] = (uint8_t)std::min(127, std::max(0, hidden[i] >> WEIGHT_SCALE_BITS));
+    int32_t output;
+    affine(clipped, L2_OUTPUTS, outputWeights, &outputBias, &output, 1);
+
+    return output / OUTPUT_SCALE * 100 / NETWORK_PAWN_VALUE;
+}
@@ -0,0 +1,39 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#ifndef RG_3D_SAH_NNUE_H
+#define RG_3D_SAH_NNUE_H
+
+#include "Position.h"
+
+// Efficiently updatable neural network evaluation in the HalfKP 256x2-32-32-1 layout of the first NNUE
+// networks. Every non-king piece is a feature paired with the square of the perspective's own king, 64 king
+// squares times 641 piece-square slots (slot 0 unused). Its first layer output for each side, the
+// accumulator, is only ever changed by the few features a move touches.
+const int NNUE_HALF_DIMENSIONS = 256;
+const int NNUE_FEATURES = 64 * 641;
+
+struct Accumulator {
+    alignas(64) int16_t values[2][NNUE_HALF_DIMENSIONS];
+    bool computed[2];
+};
+
+// Maps the network file and copies the weights into aligned buffers, false if the file is missing or isn't
+// a HalfKP network of this shape. Not safe while a search is evaluating
+bool nnueLoad(const char *path);
+// Fills the network with random weights, only good for measuring speed
+void nnueInitRandom(uint64_t seed);
+bool nnueIsLoaded();
+// Instruction set the kernels were picked for at load time: "avx2", "sse4.1" or "scalar"
+const char *nnueKernels();
+
+// Accumulator stack for Position::setAccumulators(), 64 byte aligned
+Accumulator *nnueAllocateAccumulators();
+void nnueFreeAccumulators(Accumulator *stack);
+
+// Network output in centipawns from the side to move's point of view. With an accumulator stack attached only
+// the features changed since the last computed ply are applied, otherwise both sides are built from scratch
+int nnueEvaluate(const Position &pos);
+
+#endif //RG_3D_SAH_NNUE_H
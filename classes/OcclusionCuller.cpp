@@ -0,0 +1,328 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#include "OcclusionCuller.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "error.h"
+#include "MemoryTracker.h"
+#include "GlState.h"
+#include "Profiler.h"
+
+// The GPU reduces the depth buffer until the level fits into this many texels on its longer side
+static const int READBACK_SIZE = 160;
+// Objects found visible are kept for this many frames even if the test says otherwise, to avoid popping
+static const unsigned VISIBLE_FRAMES = 4;
+// If the camera moved more than this since the pyramid was captured the pyramid isn't trusted
+static const float CAMERA_TOLERANCE = 0.05f;
+
+OcclusionCuller::OcclusionCuller(const std::string &vertexShaderPath, const std::string &fragmentShaderPath)
+    : downsampleShader{vertexShaderPath, fragmentShaderPath} {
+        glGenVertexArrays(1, &emptyVAO);
+        glGenBuffers(1, &PBO);
+        downsampleShader.use();
+        downsampleShader.setUniform1i("sourceTexture", 0);
+    }
+
+void OcclusionCuller::createTargets(int width, int height) {
+    destroyTargets();
+    OcclusionCuller::width = width;
+    OcclusionCuller::height = height;
+
+    glGenTextures(1, &depthTex);
+    stateBindTexture(GL_TEXTURE_2D, depthTex);
+    memoryTexImage2D(GL_TEXTURE_2D, depthTex, GL_DEPTH24_STENCIL8, width, height, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, nullptr, false,
+                     RENDER_TARGETS, "occlusion culling");
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+    glGenFramebuffers(1, &depthFBO);
+    stateBindFramebuffer(GL_FRAMEBUFFER, depthFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depthTex, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    CHECK_ERROR(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE, "Depth copy framebuffer incomplete");
+
+    int w = width, h = height;
+    while(std::max(w, h) > READBACK_SIZE)
+    {
+        w = std::max(1, (w + 1) / 2);
+        h = std::max(1, (h + 1) / 2);
+        unsigned tex, fbo;
+        glGenTextures(1, &tex);
+        stateBindTexture(GL_TEXTURE_2D, tex);
+        memoryTexImage2D(GL_TEXTURE_2D, tex, GL_R32F, w, h, GL_RED, GL_FLOAT, nullptr, false, RENDER_TARGETS, "occlusion culling");
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glGenFramebuffers(1, &fbo);
+        stateBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex, 0);
+        CHECK_ERROR(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE, "Depth pyramid framebuffer incomplete");
+        levelTexs.push_back(tex);
+        levelFBOs.push_back(fbo);
+        levelSizes.push_back(std::make_pair(w, h));
+    }
+    stateBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    stateBindBuffer(GL_PIXEL_PACK_BUFFER, PBO);
+    memoryBufferData(GL_PIXEL_PACK_BUFFER, PBO, w * h * sizeof(float), nullptr, GL_STREAM_READ, RENDER_TARGETS, "occlusion culling");
+    stateBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void OcclusionCuller::destroyTargets() {
+    if(fence != nullptr)
+    {
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+    if(depthFBO != 0)
+    {
+        stateDeleteFramebuffers(1, &depthFBO);
+        memoryDeleteTextures(1, &depthTex);
+        depthFBO = depthTex = 0;
+    }
+    if(!levelFBOs.empty())
+    {
+        stateDeleteFramebuffers(levelFBOs.size(), levelFBOs.data());
+        memoryDeleteTextures(levelTexs.size(), levelTexs.data());
+    }
+    levelFBOs.clear();
+    levelTexs.clear();
+    levelSizes.clear();
+    hasPyramid = false;
+}
+
+void OcclusionCuller::beginFrame(const glm::mat4 &viewProjection) {
+    PROFILE_SCOPE("occlusion readback");
+    frame++;
+    tested = culled = 0;
+    currentViewProjection = viewProjection;
+
+    // Pick up the readback started in an earlier frame, but never wait for it
+    if(fence != nullptr)
+    {
+        GLenum result = glClientWaitSync(fence, 0, 0);
+        if(result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED)
+        {
+            glDeleteSync(fence);
+            fence = nullptr;
+            stateBindBuffer(GL_PIXEL_PACK_BUFFER, PBO);
+            auto *data = (const float *)glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+            if(data != nullptr)
+            {
+                buildPyramid(data);
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+                pyramidViewProjection = pendingViewProjection;
+                hasPyramid = true;
+            }
+            stateBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+    }
+
+    cameraSettled = false;
+    if(hasPyramid)
+    {
+        float difference = 0.0f;
+        for(int i = 0; i < 4; i++)
+            for(int j = 0; j < 4; j++)
+                difference = std::max(difference, std::fabs(viewProjection[i][j] - pyramidViewProjection[i][j]));
+        cameraSettled = difference < CAMERA_TOLERANCE;
+    }
+}
+
+void OcclusionCuller::buildPyramid(const float *data) {
+    int w = levelSizes.empty() ? width : levelSizes.back().first;
+    int h = levelSizes.empty() ? height : levelSizes.back().second;
+    pyramid.resize(1);
+    pyramidSizes.assign(1, std::make_pair(w, h));
+    pyramid[0].assign(data, data + w * h);
+    while(w > 1 || h > 1)
+    {
+        int nw = std::max(1, (w + 1) / 2);
+        int nh = std::max(1, (h + 1) / 2);
+        const std::vector<float> &src = pyramid.back();
+        std::vector<float> dst(nw * nh);
+        for(int y = 0; y < nh; y++)
+        {
+            int y0 = 2 * y, y1 = std::min(2 * y + 1, h - 1);
+            for(int x = 0; x < nw; x++)
+            {
+                int x0 = 2 * x, x1 = std::min(2 * x + 1, w - 1);
+                dst[y * nw + x] = std::max(std::max(src[y0 * w + x0], src[y0 * w + x1]),
+                                           std::max(src[y1 * w + x0], src[y1 * w + x1]));
+            }
+        }
+        pyramid.push_back(std::move(dst));
+        pyramidSizes.push_back(std::make_pair(nw, nh));
+        w = nw;
+        h = nh;
+    }
+}
+
+bool OcclusionCuller::testBounds(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, const glm::mat4 &transform) const {
+    glm::mat4 mvp = pyramidViewProjection * transform;
+    float minX = 1.0f, minY = 1.0f, maxX = -1.0f, maxY = -1.0f, minZ = 1.0f;
+    for(int i = 0; i < 8; i++)
+    {
+        glm::vec4 corner((i & 1) ? boundsMax.x : boundsMin.x,
+                         (i & 2) ? boundsMax.y : boundsMin.y,
+                         (i & 4) ? boundsMax.z : boundsMin.z, 1.0f);
+        glm::vec4 clip = mvp * corner;
+        // Bounds crossing the near plane can't be projected reliably
+        if(clip.w <= 1e-4f)
+            return true;
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        minX = std::min(minX, ndc.x);
+        minY = std::min(minY, ndc.y);
+        maxX = std::max(maxX, ndc.x);
+        maxY = std::max(maxY, ndc.y);
+        minZ = std::min(minZ, ndc.z);
+    }
+    // Outside of the captured view, nothing is known about what covers the object
+    if(maxX < -1.0f || maxY < -1.0f || minX > 1.0f || minY > 1.0f)
+        return true;
+    minX = std::max(minX, -1.0f);
+    minY = std::max(minY, -1.0f);
+    maxX = std::min(maxX, 1.0f);
+    maxY = std::min(maxY, 1.0f);
+    float nearestDepth = minZ * 0.5f + 0.5f;
+
+    // Level 0 of the CPU pyramid is the GPU level that was read back, each of its texels covering
+    // 2^n full resolution pixels in both directions
+    float scale = 1.0f / (float)(1 << levelSizes.size());
+    float x0 = (minX * 0.5f + 0.5f) * width * scale, x1 = (maxX * 0.5f + 0.5f) * width * scale;
+    float y0 = (minY * 0.5f + 0.5f) * height * scale, y1 = (maxY * 0.5f + 0.5f) * height * scale;
+
+    // Go up the pyramid until the rectangle spans at most 2x2 texels
+    int level = 0;
+    int tx0 = (int)x0, tx1 = (int)x1, ty0 = (int)y0, ty1 = (int)y1;
+    while(level + 1 < (int)pyramid.size() && (tx1 - tx0 > 1 || ty1 - ty0 > 1))
+    {
+        level++;
+        tx0 >>= 1;
+        tx1 >>= 1;
+        ty0 >>= 1;
+        ty1 >>= 1;
+    }
+    int w = pyramidSizes[level].first, h = pyramidSizes[level].second;
+    tx0 = std::min(tx0, w - 1);
+    tx1 = std::min(tx1, w - 1);
+    ty0 = std::min(ty0, h - 1);
+    ty1 = std::min(ty1, h - 1);
+
+    float farthestDepth = 0.0f;
+    for(int y = ty0; y <= ty1; y++)
+        for(int x = tx0; x <= tx1; x++)
+            farthestDepth = std::max(farthestDepth, pyramid[level][y * w + x]);
+    return nearestDepth <= farthestDepth;
+}
+
+bool OcclusionCuller::isVisible(unsigned objectId, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, const glm::mat4 &transform) {
+    if(objectId >= lastVisibleFrame.size())
+        lastVisibleFrame.resize(objectId + 1, 0);
+    // Unknown objects are treated as visible the first time they're seen
+    if(lastVisibleFrame[objectId] == 0)
+        lastVisibleFrame[objectId] = frame;
+    if(!enabled || !hasPyramid || !cameraSettled)
+    {
+        lastVisibleFrame[objectId] = frame;
+        return true;
+    }
+
+    tested++;
+    if(testBounds(boundsMin, boundsMax, transform))
+    {
+        lastVisibleFrame[objectId] = frame;
+        return true;
+    }
+    if(frame - lastVisibleFrame[objectId] < VISIBLE_FRAMES)
+        return true;
+    culled++;
+    return false;
+}
+
+void OcclusionCuller::captureDepth(int framebufferWidth, int framebufferHeight) {
+    PROFILE_SCOPE("occlusion pyramid");
+    if(!enabled || framebufferWidth <= 0 || framebufferHeight <= 0)
+        return;
+    if(framebufferWidth != width || framebufferHeight != height)
+        createTargets(framebufferWidth, framebufferHeight);
+
+    stateBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    stateBindFramebuffer(GL_DRAW_FRAMEBUFFER, depthFBO);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+    stateDisable(GL_DEPTH_TEST);
+    downsampleShader.use();
+    stateBindVertexArray(emptyVAO);
+    stateActiveTexture(GL_TEXTURE0);
+    unsigned source = depthTex;
+    int sourceWidth = width, sourceHeight = height;
+    for(int i = 0; i < levelFBOs.size(); i++)
+    {
+        stateBindFramebuffer(GL_FRAMEBUFFER, levelFBOs[i]);
+        glViewport(0, 0, levelSizes[i].first, levelSizes[i].second);
+        stateBindTexture(GL_TEXTURE_2D, source);
+        downsampleShader.setUniform2i("sourceSize", sourceWidth, sourceHeight);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        source = levelTexs[i];
+        sourceWidth = levelSizes[i].first;
+        sourceHeight = levelSizes[i].second;
+    }
+    stateBindVertexArray(0);
+
+    // Only one readback is in flight at a time, the previous one is still used until it lands
+    if(fence == nullptr)
+    {
+        stateBindFramebuffer(GL_READ_FRAMEBUFFER, levelFBOs.empty() ? depthFBO : levelFBOs.back());
+        stateBindBuffer(GL_PIXEL_PACK_BUFFER, PBO);
+        if(levelFBOs.empty())
+            glReadPixels(0, 0, width, height, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+        else
+            glReadPixels(0, 0, sourceWidth, sourceHeight, GL_RED, GL_FLOAT, nullptr);
+        stateBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        pendingViewProjection = currentViewProjection;
+    }
+
+    stateBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, width, height);
+    stateEnable(GL_DEPTH_TEST);
+}
+
+void OcclusionCuller::invalidate() {
+    if(fence != nullptr)
+    {
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+    hasPyramid = false;
+}
+
+void OcclusionCuller::del() {
+    destroyTargets();
+    memoryDeleteBuffers(1, &PBO);
+    stateDeleteVertexArrays(1, &emptyVAO);
+    downsampleShader.del();
+}
+
+bool OcclusionCuller::isEnabled() const {
+    return enabled;
+}
+
+void OcclusionCuller::setEnabled(bool enabled) {
+    OcclusionCuller::enabled = enabled;
+    if(!enabled)
+        hasPyramid = false;
+}
+
+unsigned OcclusionCuller::getTestedCount() const {
+    return tested;
+}
+
+unsigned OcclusionCuller::getCulledCount() const {
+    return culled;
+}
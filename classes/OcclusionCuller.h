@@ -0,0 +1,65 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#ifndef RG_3D_SAH_OCCLUSIONCULLER_H
+#define RG_3D_SAH_OCCLUSIONCULLER_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Shader.h"
+
+// Hierarchical-Z occlusion culling. After the opaque pass the depth buffer is copied and max-reduced on the GPU
+// down to a small level which is read back asynchronously, the rest of the pyramid is built on the CPU and the
+// bounds of every object are tested against it before the object gets submitted in one of the next frames.
+class OcclusionCuller {
+    Shader downsampleShader;
+    unsigned depthFBO = 0, depthTex = 0;
+    std::vector<unsigned> levelFBOs;
+    std::vector<unsigned> levelTexs;
+    std::vector<std::pair<int, int>> levelSizes;
+    unsigned emptyVAO = 0;
+    unsigned PBO = 0;
+    GLsync fence = nullptr;
+    int width = 0, height = 0;
+
+    std::vector<std::vector<float>> pyramid;
+    std::vector<std::pair<int, int>> pyramidSizes;
+    glm::mat4 currentViewProjection;
+    glm::mat4 pendingViewProjection;
+    glm::mat4 pyramidViewProjection;
+    bool hasPyramid = false;
+    bool cameraSettled = false;
+    bool enabled = true;
+
+    // Frame in which every object id was last found visible, objects stay drawn for a few frames after that
+    std::vector<unsigned> lastVisibleFrame;
+    unsigned frame = 0;
+    unsigned tested = 0, culled = 0;
+
+    void createTargets(int width, int height);
+    void destroyTargets();
+    void buildPyramid(const float *data);
+    bool testBounds(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, const glm::mat4 &transform) const;
+public:
+    OcclusionCuller(const std::string &vertexShaderPath, const std::string &fragmentShaderPath);
+    void beginFrame(const glm::mat4 &viewProjection);
+    bool isVisible(unsigned objectId, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, const glm::mat4 &transform);
+    void captureDepth(int framebufferWidth, int framebufferHeight);
+    // Drops the pyramid and the readback in flight, both show the scene from before objects moved. Everything
+    // is drawn until a capture taken after the call lands
+    void invalidate();
+    void del();
+
+    bool isEnabled() const;
+    void setEnabled(bool enabled);
+    unsigned getTestedCount() const;
+    unsigned getCulledCount() const;
+};
+
+
+#endif //RG_3D_SAH_OCCLUSIONCULLER_H
@@ -0,0 +1,307 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#include "PgnReader.h"
+
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "MoveGen.h"
+
+// Work is handed out in pieces of about this size, big enough to amortize the hand out and small enough to
+// balance the threads
+const size_t PGN_CHUNK_SIZE = 4 << 20;
+
+PgnView PgnGame::tag(const char *name) const {
+    for(int i = 0; i < tagCount; i++)
+        if(tags[i].name.equals(name))
+            return tags[i].value;
+    return PgnView();
+}
+
+static bool isSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+// Characters that end a movetext token on their own
+static bool isDelimiter(char c) {
+    return isSpace(c) || c == '{' || c == '}' || c == '(' || c == ')' || c == '[' || c == ']' || c == ';' || c == '$';
+}
+
+static const char *skipLine(const char *ptr, const char *end) {
+    const char *newline = (const char *)memchr(ptr, '\n', end - ptr);
+    return newline ? newline + 1 : end;
+}
+
+static bool isResult(const char *begin, const char *end) {
+    PgnView token;
+    token.begin = begin;
+    token.end = end;
+    return token.equals("1-0") || token.equals("0-1") || token.equals("1/2-1/2") || token.equals("*");
+}
+
+static const char *parseTag(const char *ptr, const char *end, PgnGame &game) {
+    PgnTag tag;
+    ptr++;
+    while(ptr < end && *ptr == ' ')
+        ptr++;
+    tag.name.begin = ptr;
+    while(ptr < end && !isSpace(*ptr) && *ptr != '"' && *ptr != ']')
+        ptr++;
+    tag.name.end = ptr;
+    while(ptr < end && *ptr == ' ')
+        ptr++;
+    if(ptr < end && *ptr == '"')
+    {
+        tag.value.begin = ++ptr;
+        while(ptr < end && *ptr != '"' && *ptr != '\n')
+        {
+            if(*ptr == '\\' && ptr + 1 < end)
+                ptr++;
+            ptr++;
+        }
+        tag.value.end = ptr;
+    }
+    while(ptr < end && *ptr != ']' && *ptr != '\n')
+        ptr++;
+    if(ptr < end && *ptr == ']')
+        ptr++;
+    if(game.tagCount < MAX_PGN_TAGS && tag.name.size())
+        game.tags[game.tagCount++] = tag;
+    return ptr;
+}
+
+const char *parsePgnGame(const char *text, const char *end, PgnGame &game, Position &pos) {
+    game.tagCount = 0;
+    game.moveCount = 0;
+    game.result = PgnView();
+    game.error = PGN_OK;
+    game.errorToken = PgnView();
+
+    const char *ptr = text;
+    // Tag pairs, escape lines starting with % may come before or between them
+    for(;;)
+    {
+        while(ptr < end && isSpace(*ptr))
+            ptr++;
+        if(ptr < end && *ptr == '%')
+            ptr = skipLine(ptr, end);
+        else if(ptr < end && *ptr == '[')
+        {
+            if(!game.tagCount)
+                game.text.begin = ptr;
+            ptr = parseTag(ptr, end, game);
+        }
+        else
+            break;
+    }
+    if(!game.tagCount)
+        game.text.begin = ptr;
+
+    PgnView fen = game.tag("FEN");
+    if(fen.size())
+    {
+        char buffer[MAX_FEN_LENGTH];
+        size_t length = std::min(fen.size(), (size_t)MAX_FEN_LENGTH - 1);
+        memcpy(buffer, fen.begin, length);
+        buffer[length] = '\0';
+        if(!pos.setFen(buffer))
+        {
+            game.error = BAD_FEN;
+            game.errorToken = fen;
+        }
+    }
+    else
+        pos.setStartPosition();
+
+    // Movetext up to the termination marker, or up to the next game's tags if it's missing
+    int variationDepth = 0;
+    while(ptr < end)
+    {
+        char c = *ptr;
+        if(isSpace(c))
+            ptr++;
+        else if(c == '{')
+        {
+            const char *close = (const char *)memchr(ptr, '}', end - ptr);
+            ptr = close ? close + 1 : end;
+        }
+        else if(c == ';' || c == '%')
+            ptr = skipLine(ptr, end);
+        else if(c == '(')
+        {
+            variationDepth++;
+            ptr++;
+        }
+        else if(c == ')')
+        {
+            if(variationDepth > 0)
+                variationDepth--;
+            ptr++;
+        }
+        else if(c == '[' && !variationDepth)
+            break;
+        else if(c == '$' || isDelimiter(c))
+        {
+            ptr++;
+            while(ptr < end && c == '$' && *ptr >= '0' && *ptr <= '9')
+                ptr++;
+        }
+        else
+        {
+            const char *token = ptr;
+            while(ptr < end && !isDelimiter(*ptr))
+                ptr++;
+            if(variationDepth)
+                continue;
+            if(isResult(token, ptr))
+            {
+                game.result.begin = token;
+                game.result.end = ptr;
+                break;
+            }
+            // Move numbers may be glued to the move that follows them, 12.e4 or 12...e5
+            const char *san = token;
+            while(san < ptr && *san >= '0' && *san <= '9')
+                san++;
+            if(san < ptr && *san == '.')
+                while(san < ptr && *san == '.')
+                    san++;
+            else
+                san = token;
+            if(san == ptr || game.error != PGN_OK || *san == '!' || *san == '?' || (ptr - san == 4 && !memcmp(san, "e.p.", 4)))
+                continue;
+
+            Move move = parseSan(pos, san, ptr);
+            if(move == NO_MOVE || game.moveCount == MAX_GAME_PLY)
+            {
+                game.error = move == NO_MOVE ? ILLEGAL_MOVE : GAME_TOO_LONG;
+                game.errorToken.begin = san;
+                game.errorToken.end = ptr;
+                continue;
+            }
+            pos.makeMove(move);
+            game.moves[game.moveCount++] = move;
+        }
+    }
+    game.text.end = ptr;
+    return ptr;
+}
+
+// Start of the first game after ptr: a tag at the start of a line that doesn't follow another tag
+static const char *nextGameStart(const char *ptr, const char *begin, const char *end) {
+    for(;;)
+    {
+        const char *newline = (const char *)memchr(ptr, '\n', end - ptr);
+        if(!newline)
+            return end;
+        const char *line = newline + 1;
+        if(line < end && *line == '[')
+        {
+            const char *previous = newline;
+            while(previous > begin && previous[-1] != '\n')
+                previous--;
+            if(*previous != '[')
+                return line;
+        }
+        ptr = line;
+    }
+}
+
+PgnReader::PgnReader() : data{nullptr}, size{0} {
+}
+
+PgnReader::~PgnReader() {
+    close();
+}
+
+bool PgnReader::open(const char *path) {
+    close();
+    int fd = ::open(path, O_RDONLY);
+    if(fd < 0)
+        return false;
+    struct stat info;
+    if(fstat(fd, &info) != 0 || info.st_size <= 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(mapping == MAP_FAILED)
+        return false;
+    // Every thread walks its chunks front to back
+    madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+    data = (const char *)mapping;
+    size = info.st_size;
+    return true;
+}
+
+void PgnReader::close() {
+    if(data)
+        munmap((void *)data, size);
+    data = nullptr;
+    size = 0;
+}
+
+PgnStats PgnReader::read(const std::function<void(const PgnGame &, const Position &)> &callback, int threads) {
+    PgnStats stats = {0, 0, 0};
+    if(!data)
+        return stats;
+
+    // A game longer than a chunk swallows the chunk starts inside it
+    std::vector<const char *> chunks(1, data);
+    for(size_t offset = PGN_CHUNK_SIZE; offset < size; offset += PGN_CHUNK_SIZE)
+    {
+        const char *start = nextGameStart(data + offset, data, end());
+        if(start > chunks.back() && start < end())
+            chunks.push_back(start);
+    }
+    chunks.push_back(end());
+
+    std::atomic<int> nextChunk(0);
+    std::atomic<uint64_t> games(0), plies(0), errors(0);
+    auto worker = [&]() {
+        std::unique_ptr<Position> pos(new Position());
+        std::unique_ptr<PgnGame> game(new PgnGame());
+        PgnStats local = {0, 0, 0};
+        int i;
+        while((i = nextChunk++) < (int)chunks.size() - 1)
+        {
+            const char *ptr = chunks[i];
+            while(ptr < chunks[i + 1])
+            {
+                ptr = parsePgnGame(ptr, chunks[i + 1], *game, *pos);
+                // Whitespace or comments after the last game
+                if(!game->tagCount && !game->moveCount && !game->result.size() && game->error == PGN_OK)
+                    continue;
+                local.games++;
+                local.plies += game->moveCount;
+                local.errors += game->error != PGN_OK;
+                callback(*game, *pos);
+            }
+        }
+        games += local.games;
+        plies += local.plies;
+        errors += local.errors;
+    };
+    std::vector<std::thread> pool;
+    for(int t = 1; t < std::min(threads, (int)chunks.size() - 1); t++)
+        pool.emplace_back(worker);
+    worker();
+    for(std::thread &t : pool)
+        t.join();
+
+    stats.games = games;
+    stats.plies = plies;
+    stats.errors = errors;
+    return stats;
+}
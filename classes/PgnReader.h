@@ -0,0 +1,105 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#ifndef RG_3D_SAH_PGNREADER_H
+#define RG_3D_SAH_PGNREADER_H
+
+#include <string>
+#include <cstring>
+#include <functional>
+
+#include "ChessTypes.h"
+#include "Position.h"
+
+// Piece of the mapped file, the PGN text is never copied
+struct PgnView {
+    const char *begin = nullptr;
+    const char *end = nullptr;
+
+    size_t size() const {
+        return end - begin;
+    }
+    bool equals(const char *text) const {
+        return strlen(text) == size() && memcmp(begin, text, size()) == 0;
+    }
+    std::string str() const {
+        return std::string(begin, end);
+    }
+};
+
+struct PgnTag {
+    PgnView name;
+    // Between the quotes, escaped quotes and backslashes are left as they are in the file
+    PgnView value;
+};
+
+enum pgnError {
+    PGN_OK,
+    BAD_FEN,
+    ILLEGAL_MOVE,
+    GAME_TOO_LONG
+};
+
+// Tags beyond this many are skipped
+const int MAX_PGN_TAGS = 32;
+
+// One game of the file. Only the main line is kept, variations and comments are skipped
+struct PgnGame {
+    PgnTag tags[MAX_PGN_TAGS];
+    int tagCount;
+    Move moves[MAX_GAME_PLY];
+    int moveCount;
+    // Termination marker after the moves, empty if the game has none
+    PgnView result;
+    // The whole game, tags included
+    PgnView text;
+    // On an error the moves stop before the offending one, which the token points at
+    pgnError error;
+    PgnView errorToken;
+
+    // Value of the tag, empty if the game doesn't have it
+    PgnView tag(const char *name) const;
+};
+
+// Parses the game starting at or after text and returns where the next one begins. Position is left after the
+// last move, it starts from the FEN tag if there is one. Returns end with no tags and moves if only whitespace
+// and comments were left
+const char *parsePgnGame(const char *text, const char *end, PgnGame &game, Position &pos);
+
+struct PgnStats {
+    uint64_t games;
+    uint64_t plies;
+    uint64_t errors;
+};
+
+// Maps a PGN file and parses its games on a pool of threads. The file is cut into chunks that start at a game,
+// every thread parses whole chunks on its own position, so nothing is shared but the chunk counter
+class PgnReader {
+    const char *data;
+    size_t size;
+public:
+    PgnReader();
+    ~PgnReader();
+    PgnReader(const PgnReader &) = delete;
+    PgnReader &operator=(const PgnReader &) = delete;
+
+    bool open(const char *path);
+    void close();
+    const char *begin() const {
+        return data;
+    }
+    const char *end() const {
+        return data + size;
+    }
+    size_t getSize() const {
+        return size;
+    }
+    // Calls back for every game, from all the threads at once and in no particular order, or in file order with
+    // one thread. The views point into the mapping and stay valid until the file is closed, the game and
+    // position only during the call
+    PgnStats read(const std::function<void(const PgnGame &, const Position &)> &callback, int threads);
+};
+
+
+#endif //RG_3D_SAH_PGNREADER_H
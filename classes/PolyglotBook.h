@@ -0,0 +1,62 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#ifndef RG_3D_SAH_POLYGLOTBOOK_H
+#define RG_3D_SAH_POLYGLOTBOOK_H
+
+#include <cstddef>
+
+#include "ChessTypes.h"
+#include "Position.h"
+
+// Entries of a Polyglot .bin book are 16 big endian bytes sorted by key
+const int POLYGLOT_ENTRY_SIZE = 16;
+// Polyglot key layout: 64 squares for each of 12 pieces, then castling, en passant files and side to move
+const int POLYGLOT_RANDOM_COUNT = 781;
+// Key of the initial position, checked against the built in table when it compiles
+const uint64_t POLYGLOT_START_KEY = 0x463B96181691FC9CULL;
+
+// Polyglot hash of the position, the same as in books written by other programs
+uint64_t polyglotKey(const Position &pos);
+
+// Book moves are from and to squares and the promotion piece, castling is written as the king taking its rook
+uint16_t toPolyglotMove(Move m);
+// NO_MOVE if the book move isn't legal in the position
+Move fromPolyglotMove(const Position &pos, uint16_t bookMove);
+
+struct BookMove {
+    Move move;
+    uint16_t weight;
+};
+
+// Book file mapped into memory and searched in place, opening even a big one costs nothing
+class PolyglotBook {
+    const uint8_t *data;
+    size_t entries;
+
+    uint64_t keyAt(size_t index) const;
+public:
+    PolyglotBook();
+    ~PolyglotBook();
+    PolyglotBook(const PolyglotBook &) = delete;
+    PolyglotBook &operator=(const PolyglotBook &) = delete;
+
+    bool open(const char *path);
+    void close();
+    bool isOpen() const {
+        return data != nullptr;
+    }
+    size_t size() const {
+        return entries;
+    }
+    // Legal book moves of the position by falling weight, returns how many were written
+    int probe(const Position &pos, BookMove *moves, int maxMoves) const;
+    // Move with the highest weight, NO_MOVE out of book
+    Move bestMove(const Position &pos) const;
+    // Move picked with probability proportional to its weight, random is any uniformly distributed number
+    Move weightedMove(const Position &pos, uint64_t random) const;
+};
+
+
+#endif //RG_3D_SAH_POLYGLOTBOOK_H
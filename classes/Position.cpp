@@ -0,0 +1,545 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#include "Position.h"
+
+#include <cstdlib>
+
+#include "error.h"
+#include "Zobrist.h"
+#include "Nnue.h"
+
+// Castling rights that survive a move touching the square
+static int castlingMask(int square) {
+    switch(square)
+    {
+        case 0:
+            return ~WHITE_OOO & 15;
+        case 4:
+            return ~(WHITE_OO | WHITE_OOO) & 15;
+        case 7:
+            return ~WHITE_OO & 15;
+        case 56:
+            return ~BLACK_OOO & 15;
+        case 60:
+            return ~(BLACK_OO | BLACK_OOO) & 15;
+        case 63:
+            return ~BLACK_OO & 15;
+        default:
+            return 15;
+    }
+}
+
+Position::Position() : accumulators{nullptr} {
+    setStartPosition();
+}
+
+void Position::clear() {
+    for(Bitboard &b : pieces)
+        b = 0;
+    colorOccupancy[BLACK] = colorOccupancy[WHITE] = 0;
+    occupancy = 0;
+    for(uint8_t &piece : board)
+        piece = NO_PIECE;
+    sideToMove = WHITE;
+    castlingRights = 0;
+    epSquare = NO_SQUARE;
+    halfmoveClock = 0;
+    fullmoveNumber = 1;
+    gamePly = 0;
+    key = zobrist.side ^ zobrist.castling[0];
+    pawnKey = 0;
+    invalidateAccumulator();
+    checkKeys();
+}
+
+void Position::setStartPosition() {
+    clear();
+    const type backRank[8] = {ROOK, KNIGHT, BISHOP, QUEEN, KING, BISHOP, KNIGHT, ROOK};
+    for(int file = 0; file < 8; file++)
+    {
+        putPiece(makePiece(WHITE, backRank[file]), makeSquare(file, 0));
+        putPiece(makePiece(WHITE, PAWN), makeSquare(file, 1));
+        putPiece(makePiece(BLACK, PAWN), makeSquare(file, 6));
+        putPiece(makePiece(BLACK, backRank[file]), makeSquare(file, 7));
+    }
+    setCastlingRights(WHITE_OO | WHITE_OOO | BLACK_OO | BLACK_OOO);
+    setSideToMove(WHITE);
+}
+
+void Position::setPiece(int piece, int square) {
+    if(board[square] != NO_PIECE)
+        removePiece(square);
+    if(piece != NO_PIECE)
+        putPiece(piece, square);
+    invalidateAccumulator();
+    checkKeys();
+}
+
+void Position::setAccumulators(Accumulator *stack) {
+    accumulators = stack;
+    // Entries below the current ply are left over from whatever game used the stack before, updates must
+    // never build on them
+    if(accumulators)
+        for(int ply = 0; ply <= gamePly; ply++)
+            accumulators[ply].computed[BLACK] = accumulators[ply].computed[WHITE] = false;
+}
+
+void Position::invalidateAccumulator() {
+    if(accumulators)
+        accumulators[gamePly].computed[BLACK] = accumulators[gamePly].computed[WHITE] = false;
+}
+
+void Position::setSideToMove(color side) {
+    if(side != sideToMove)
+        key ^= zobrist.side;
+    sideToMove = side;
+    checkKeys();
+}
+
+void Position::setCastlingRights(int rights) {
+    key ^= zobrist.castling[castlingRights] ^ zobrist.castling[rights];
+    castlingRights = rights;
+    checkKeys();
+}
+
+void Position::setEpSquare(int square) {
+    if(epSquare != NO_SQUARE)
+        key ^= zobrist.enPassant[fileOf(epSquare)];
+    epSquare = square;
+    if(epSquare != NO_SQUARE)
+        key ^= zobrist.enPassant[fileOf(epSquare)];
+    checkKeys();
+}
+
+void Position::setMoveCounters(int halfmoveClock, int fullmoveNumber) {
+    Position::halfmoveClock = halfmoveClock;
+    Position::fullmoveNumber = fullmoveNumber;
+}
+
+// A FEN ends at the end of the string or of its line, so lines of a bigger buffer can be read in place
+static bool fenEnd(char c) {
+    return c == '\0' || c == '\n' || c == '\r';
+}
+
+// Reads a non-negative number and advances the pointer past it
+static bool parseNumber(const char *&ptr, int &value) {
+    if(*ptr < '0' || *ptr > '9')
+        return false;
+    value = 0;
+    while(*ptr >= '0' && *ptr <= '9')
+        value = value * 10 + (*ptr++ - '0');
+    return true;
+}
+
+bool Position::setFen(const char *fen) {
+    static const char pieceChars[] = "pnbrqkPNBRQK";
+    clear();
+    const char *ptr = fen;
+    while(*ptr == ' ')
+        ptr++;
+
+    int file = 0, rank = 7;
+    for(; !fenEnd(*ptr) && *ptr != ' '; ptr++)
+    {
+        char c = *ptr;
+        if(c == '/')
+        {
+            if(file != 8 || rank == 0)
+                break;
+            file = 0;
+            rank--;
+        }
+        else if(c >= '1' && c <= '8')
+            file += c - '0';
+        else
+        {
+            int piece = 0;
+            while(pieceChars[piece] && pieceChars[piece] != c)
+                piece++;
+            if(!pieceChars[piece] || file > 7)
+                break;
+            putPiece(piece, makeSquare(file++, rank));
+        }
+        if(file > 8)
+            break;
+    }
+    // Move generation and NNUE feature lists rely on at most 16 pieces, one king a side and no pawn on a back rank
+    bool legal = popCount(pieces[makePiece(WHITE, KING)]) == 1 && popCount(pieces[makePiece(BLACK, KING)]) == 1
+                 && popCount(colorOccupancy[WHITE]) <= 16 && popCount(colorOccupancy[BLACK]) <= 16
+                 && !((pieces[makePiece(WHITE, PAWN)] | pieces[makePiece(BLACK, PAWN)]) & (RANK_1 | RANK_8));
+    if(*ptr != ' ' || rank != 0 || file != 8 || !legal)
+    {
+        clear();
+        return false;
+    }
+
+    ptr++;
+    if(*ptr == 'w')
+        setSideToMove(WHITE);
+    else if(*ptr == 'b')
+        setSideToMove(BLACK);
+    else
+    {
+        clear();
+        return false;
+    }
+    // The side that just moved can't have left its king in check, the search would go on to capture it
+    if(isAttacked(kingSquare((color)!sideToMove), sideToMove))
+    {
+        clear();
+        return false;
+    }
+    ptr++;
+
+    // Castling rights, en passant square and the counters are optional, EPD lines often stop early
+    while(*ptr == ' ')
+        ptr++;
+    int rights = 0;
+    for(; !fenEnd(*ptr) && *ptr != ' '; ptr++)
+    {
+        switch(*ptr)
+        {
+            case 'K':
+                rights |= WHITE_OO;
+                break;
+            case 'Q':
+                rights |= WHITE_OOO;
+                break;
+            case 'k':
+                rights |= BLACK_OO;
+                break;
+            case 'q':
+                rights |= BLACK_OOO;
+                break;
+            default:
+                break;
+        }
+    }
+    // A right whose king or rook has left its square can't be used, keeping it would only change the key
+    for(int square : {0, 7, 56, 63})
+        if(pieceOn(square) != makePiece(square < 8 ? WHITE : BLACK, ROOK))
+            rights &= castlingMask(square);
+    if(pieceOn(4) != makePiece(WHITE, KING))
+        rights &= castlingMask(4);
+    if(pieceOn(60) != makePiece(BLACK, KING))
+        rights &= castlingMask(60);
+    setCastlingRights(rights);
+    while(*ptr == ' ')
+        ptr++;
+    // A square no pawn can capture on is dropped, so the key matches the same position reached by moves
+    if(ptr[0] >= 'a' && ptr[0] <= 'h' && (ptr[1] == '3' || ptr[1] == '6'))
+    {
+        int square = makeSquare(ptr[0] - 'a', ptr[1] - '1');
+        if(epCapturable(square, sideToMove))
+            setEpSquare(square);
+        ptr += 2;
+    }
+    while(!fenEnd(*ptr) && *ptr != ' ')
+        ptr++;
+    while(*ptr == ' ')
+        ptr++;
+    int halfmove, fullmove;
+    if(parseNumber(ptr, halfmove))
+    {
+        halfmoveClock = halfmove;
+        while(*ptr == ' ')
+            ptr++;
+        if(parseNumber(ptr, fullmove) && fullmove > 0)
+            fullmoveNumber = fullmove;
+    }
+    return true;
+}
+
+// Writes the digits of a non-negative number and returns the position after them
+static char *writeNumber(char *ptr, int value) {
+    char digits[10];
+    int count = 0;
+    do
+    {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while(value);
+    while(count)
+        *ptr++ = digits[--count];
+    return ptr;
+}
+
+int Position::getFen(char *buffer) const {
+    static const char pieceChars[] = "pnbrqkPNBRQK";
+    char *ptr = buffer;
+    for(int rank = 7; rank >= 0; rank--)
+    {
+        int empty = 0;
+        for(int file = 0; file < 8; file++)
+        {
+            int piece = board[makeSquare(file, rank)];
+            if(piece == NO_PIECE)
+                empty++;
+            else
+            {
+                if(empty)
+                    *ptr++ = (char)('0' + empty);
+                empty = 0;
+                *ptr++ = pieceChars[piece];
+            }
+        }
+        if(empty)
+            *ptr++ = (char)('0' + empty);
+        if(rank > 0)
+            *ptr++ = '/';
+    }
+    *ptr++ = ' ';
+    *ptr++ = sideToMove == WHITE ? 'w' : 'b';
+    *ptr++ = ' ';
+    if(castlingRights & WHITE_OO)
+        *ptr++ = 'K';
+    if(castlingRights & WHITE_OOO)
+        *ptr++ = 'Q';
+    if(castlingRights & BLACK_OO)
+        *ptr++ = 'k';
+    if(castlingRights & BLACK_OOO)
+        *ptr++ = 'q';
+    if(!castlingRights)
+        *ptr++ = '-';
+    *ptr++ = ' ';
+    if(epSquare != NO_SQUARE)
+    {
+        *ptr++ = (char)('a' + fileOf(epSquare));
+        *ptr++ = (char)('1' + rankOf(epSquare));
+    }
+    else
+        *ptr++ = '-';
+    *ptr++ = ' ';
+    ptr = writeNumber(ptr, halfmoveClock);
+    *ptr++ = ' ';
+    ptr = writeNumber(ptr, fullmoveNumber);
+    *ptr = '\0';
+    return (int)(ptr - buffer);
+}
+
+uint64_t Position::computeKey() const {
+    uint64_t key = 0;
+    for(int piece = 0; piece < NO_PIECE; piece++)
+    {
+        Bitboard b = pieces[piece];
+        while(b)
+            key ^= zobrist.pieces[piece][popLsb(b)];
+    }
+    if(sideToMove == WHITE)
+        key ^= zobrist.side;
+    key ^= zobrist.castling[castlingRights];
+    if(epSquare != NO_SQUARE)
+        key ^= zobrist.enPassant[fileOf(epSquare)];
+    return key;
+}
+
+uint64_t Position::computePawnKey() const {
+    uint64_t key = 0;
+    for(int piece : {makePiece(BLACK, PAWN), makePiece(WHITE, PAWN)})
+    {
+        Bitboard b = pieces[piece];
+        while(b)
+            key ^= zobrist.pieces[piece][popLsb(b)];
+    }
+    return key;
+}
+
+uint64_t Position::keyAfter(Move m) const {
+    int from = moveFrom(m), to = moveTo(m), piece = board[from];
+    uint64_t k = key ^ zobrist.side ^ zobrist.pieces[piece][from] ^ zobrist.pieces[piece][to];
+    if(board[to] != NO_PIECE)
+        k ^= zobrist.pieces[board[to]][to];
+    if(epSquare != NO_SQUARE)
+        k ^= zobrist.enPassant[fileOf(epSquare)];
+    return k;
+}
+
+// Whether a pawn of the given side stands ready to take en passant on the square
+bool Position::epCapturable(int square, color by) const {
+    return (pawnAttacks((color)!by, square) & pieces[makePiece(by, PAWN)]) != 0;
+}
+
+// Compares the incremental keys with a recomputation, compiled in only for debug builds
+void Position::checkKeys() const {
+#ifdef RG_3D_SAH_CHECK_KEYS
+    CHECK_ERROR(key == computeKey() && pawnKey == computePawnKey(), "Incremental Zobrist key out of sync");
+#endif
+}
+
+void Position::putPiece(int piece, int square) {
+    Bitboard b = squareBB(square);
+    pieces[piece] |= b;
+    colorOccupancy[pieceColor(piece)] |= b;
+    occupancy |= b;
+    board[square] = piece;
+    key ^= zobrist.pieces[piece][square];
+    if(pieceType(piece) == PAWN)
+        pawnKey ^= zobrist.pieces[piece][square];
+}
+
+void Position::removePiece(int square) {
+    int piece = board[square];
+    Bitboard b = squareBB(square);
+    pieces[piece] ^= b;
+    colorOccupancy[pieceColor(piece)] ^= b;
+    occupancy ^= b;
+    board[square] = NO_PIECE;
+    key ^= zobrist.pieces[piece][square];
+    if(pieceType(piece) == PAWN)
+        pawnKey ^= zobrist.pieces[piece][square];
+}
+
+void Position::movePiece(int from, int to) {
+    int piece = board[from];
+    Bitboard b = squareBB(from) | squareBB(to);
+    pieces[piece] ^= b;
+    colorOccupancy[pieceColor(piece)] ^= b;
+    occupancy ^= b;
+    board[from] = NO_PIECE;
+    board[to] = piece;
+    uint64_t change = zobrist.pieces[piece][from] ^ zobrist.pieces[piece][to];
+    key ^= change;
+    if(pieceType(piece) == PAWN)
+        pawnKey ^= change;
+}
+
+Move Position::moveFromSquares(int from, int to, type promotion) const {
+    int piece = board[from];
+    int flags = QUIET;
+    if(pieceType(piece) == PAWN)
+    {
+        if(std::abs(to - from) == 16)
+            flags = DOUBLE_PAWN_PUSH;
+        else if(to == epSquare && fileOf(to) != fileOf(from))
+            flags = EN_PASSANT;
+        if(rankOf(to) == 0 || rankOf(to) == 7)
+            flags = PROMOTION | (promotion - KNIGHT);
+    }
+    else if(pieceType(piece) == KING && std::abs(to - from) == 2)
+        flags = to > from ? KING_CASTLE : QUEEN_CASTLE;
+    if(board[to] != NO_PIECE)
+        flags |= CAPTURE;
+    return encodeMove(from, to, flags);
+}
+
+void Position::makeMove(Move m) {
+    CHECK_ERROR(gamePly < MAX_GAME_PLY, "Game too long for the move stack");
+    StateInfo &st = history[gamePly++];
+    st.move = m;
+    st.captured = NO_PIECE;
+    st.castlingRights = castlingRights;
+    st.epSquare = epSquare;
+    st.halfmoveClock = halfmoveClock;
+    st.key = key;
+    st.pawnKey = pawnKey;
+    st.dirty.count = 0;
+
+    color us = sideToMove;
+    int from = moveFrom(m), to = moveTo(m), flags = moveFlags(m);
+    int piece = board[from];
+    st.dirty.add(piece, from, to);
+
+    halfmoveClock++;
+    if(epSquare != NO_SQUARE)
+    {
+        key ^= zobrist.enPassant[fileOf(epSquare)];
+        epSquare = NO_SQUARE;
+    }
+    if(flags == EN_PASSANT)
+    {
+        int captureSquare = us == WHITE ? to - 8 : to + 8;
+        st.captured = board[captureSquare];
+        st.dirty.add(st.captured, captureSquare, NO_SQUARE);
+        removePiece(captureSquare);
+    }
+    else if(isCapture(m))
+    {
+        st.captured = board[to];
+        st.dirty.add(st.captured, to, NO_SQUARE);
+        removePiece(to);
+    }
+    if(pieceType(piece) == PAWN || st.captured != NO_PIECE)
+        halfmoveClock = 0;
+
+    movePiece(from, to);
+    if(isPromotion(m))
+    {
+        removePiece(to);
+        putPiece(makePiece(us, promotionType(m)), to);
+        st.dirty.to[0] = NO_SQUARE;
+        st.dirty.add(makePiece(us, promotionType(m)), NO_SQUARE, to);
+    }
+    else if(flags == DOUBLE_PAWN_PUSH && epCapturable((from + to) / 2, (color)!us))
+    {
+        epSquare = (from + to) / 2;
+        key ^= zobrist.enPassant[fileOf(epSquare)];
+    }
+    else if(flags == KING_CASTLE)
+    {
+        st.dirty.add(board[to + 1], to + 1, to - 1);
+        movePiece(to + 1, to - 1);
+    }
+    else if(flags == QUEEN_CASTLE)
+    {
+        st.dirty.add(board[to - 2], to - 2, to + 1);
+        movePiece(to - 2, to + 1);
+    }
+
+    int rights = castlingRights & castlingMask(from) & castlingMask(to);
+    key ^= zobrist.castling[castlingRights] ^ zobrist.castling[rights] ^ zobrist.side;
+    castlingRights = rights;
+    if(us == BLACK)
+        fullmoveNumber++;
+    sideToMove = (color)!us;
+    invalidateAccumulator();
+    checkKeys();
+}
+
+void Position::unmakeMove() {
+    const StateInfo &st = history[--gamePly];
+    sideToMove = (color)!sideToMove;
+    color us = sideToMove;
+    Move m = st.move;
+    int from = moveFrom(m), to = moveTo(m), flags = moveFlags(m);
+
+    if(isPromotion(m))
+    {
+        removePiece(to);
+        putPiece(makePiece(us, PAWN), to);
+    }
+    else if(flags == KING_CASTLE)
+        movePiece(to - 1, to + 1);
+    else if(flags == QUEEN_CASTLE)
+        movePiece(to + 1, to - 2);
+    movePiece(to, from);
+    if(st.captured != NO_PIECE)
+        putPiece(st.captured, flags == EN_PASSANT ? (us == WHITE ? to - 8 : to + 8) : to);
+
+    castlingRights = st.castlingRights;
+    epSquare = st.epSquare;
+    halfmoveClock = st.halfmoveClock;
+    // The piece moves above already walked the keys back, restoring them also covers side, castling and en passant
+    key = st.key;
+    pawnKey = st.pawnKey;
+    if(us == BLACK)
+        fullmoveNumber--;
+    checkKeys();
+}
+
+bool Position::isDraw() const {
+    if(halfmoveClock >= 100)
+        return true;
+    for(int ply = gamePly - 2; ply >= 0 && ply >= gamePly - halfmoveClock; ply -= 2)
+        if(history[ply].key == key)
+            return true;
+    return false;
+}
+
+int Position::repetitions() const {
+    int count = 0;
+    for(int ply = gamePly - 2; ply >= 0 && ply >= gamePly - halfmoveClock; ply -= 2)
+        count += history[ply].key == key;
+    return count;
+}
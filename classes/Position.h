@@ -0,0 +1,182 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#ifndef RG_3D_SAH_POSITION_H
+#define RG_3D_SAH_POSITION_H
+
+#include "ChessTypes.h"
+#include "Bitboard.h"
+#include "Attacks.h"
+
+// Longest game the make/unmake stack can hold
+const int MAX_GAME_PLY = 1024;
+// Room for the longest FEN getFen() can write, terminator included
+const int MAX_FEN_LENGTH = 128;
+
+struct Accumulator;
+
+// Pieces a move put down or picked up, for evaluators that follow the board incrementally. The moving piece
+// comes first, a square of NO_SQUARE means the piece appeared or vanished there
+struct DirtyPieces {
+    uint8_t count;
+    uint8_t piece[3];
+    uint8_t from[3];
+    uint8_t to[3];
+
+    void add(int p, int f, int t) {
+        piece[count] = (uint8_t)p;
+        from[count] = (uint8_t)f;
+        to[count] = (uint8_t)t;
+        count++;
+    }
+};
+
+// What a move destroys and unmakeMove() needs to restore
+struct StateInfo {
+    Move move;
+    uint8_t captured;
+    uint8_t castlingRights;
+    uint8_t epSquare;
+    uint16_t halfmoveClock;
+    uint64_t key;
+    uint64_t pawnKey;
+    DirtyPieces dirty;
+};
+
+// Complete game state: one bitboard per piece plus occupancy, side to move, castling rights, en passant square
+// and move counters. Moves are made and unmade on a fixed size stack, nothing is ever allocated.
+class Position {
+    Bitboard pieces[12];
+    Bitboard colorOccupancy[2];
+    Bitboard occupancy;
+    uint8_t board[64];
+    color sideToMove;
+    int castlingRights;
+    int epSquare;
+    int halfmoveClock;
+    int fullmoveNumber;
+    StateInfo history[MAX_GAME_PLY];
+    int gamePly;
+    // Zobrist hashes of the whole position and of the pawns alone, kept up to date by every change
+    uint64_t key;
+    uint64_t pawnKey;
+    // Optional stack of NNUE accumulators, one per game ply, a move leaves the new ply's entry to be computed
+    Accumulator *accumulators;
+
+    void putPiece(int piece, int square);
+    void removePiece(int square);
+    void movePiece(int from, int to);
+    bool epCapturable(int square, color by) const;
+    void checkKeys() const;
+    void invalidateAccumulator();
+public:
+    Position();
+    void clear();
+    void setStartPosition();
+    void setPiece(int piece, int square);
+    void setSideToMove(color side);
+    void setCastlingRights(int rights);
+    void setEpSquare(int square);
+    void setMoveCounters(int halfmoveClock, int fullmoveNumber);
+    // Reads a position in Forsyth-Edwards notation, on failure the position is left empty and false is returned.
+    // The FEN ends at the end of the string or of the line, so a file's lines can be parsed where they are
+    bool setFen(const char *fen);
+    // Writes the position as a terminated FEN into a buffer of MAX_FEN_LENGTH chars and returns its length.
+    // An en passant square no pawn can capture on isn't kept, so it isn't written either
+    int getFen(char *buffer) const;
+    // Hashes of the position and its pawn structure computed from scratch
+    uint64_t computeKey() const;
+    uint64_t computePawnKey() const;
+    // Key after the move without making it, castling changes are left out so it's only good for prefetching
+    uint64_t keyAfter(Move m) const;
+
+    // Builds the move from origin and destination alone, working out the flags from the pieces involved
+    Move moveFromSquares(int from, int to, type promotion = QUEEN) const;
+    void makeMove(Move m);
+    void unmakeMove();
+    // The stack must hold MAX_GAME_PLY + 1 accumulators, nullptr detaches it
+    void setAccumulators(Accumulator *stack);
+    Accumulator *getAccumulators() const {
+        return accumulators;
+    }
+    // Changes made by the move that led to the given ply
+    const DirtyPieces &dirtyPieces(int ply) const {
+        return history[ply - 1].dirty;
+    }
+
+    // Fifty move rule or a repetition since the last irreversible move, inside a search one repetition is enough
+    bool isDraw() const;
+    // Earlier occurrences of the position since the last irreversible move, two make a threefold repetition
+    int repetitions() const;
+
+    Bitboard getPieces(int piece) const {
+        return pieces[piece];
+    }
+    Bitboard getPieces(color c, type t) const {
+        return pieces[makePiece(c, t)];
+    }
+    Bitboard getOccupancy(color c) const {
+        return colorOccupancy[c];
+    }
+    Bitboard getOccupancy() const {
+        return occupancy;
+    }
+    int pieceOn(int square) const {
+        return board[square];
+    }
+    color getSideToMove() const {
+        return sideToMove;
+    }
+    int getCastlingRights() const {
+        return castlingRights;
+    }
+    int getEpSquare() const {
+        return epSquare;
+    }
+    int getHalfmoveClock() const {
+        return halfmoveClock;
+    }
+    int getFullmoveNumber() const {
+        return fullmoveNumber;
+    }
+    int getGamePly() const {
+        return gamePly;
+    }
+    uint64_t getKey() const {
+        return key;
+    }
+    uint64_t getPawnKey() const {
+        return pawnKey;
+    }
+    Move lastMove() const {
+        return gamePly > 0 ? history[gamePly - 1].move : NO_MOVE;
+    }
+
+    int kingSquare(color c) const {
+        return lsb(pieces[makePiece(c, KING)]);
+    }
+    // Pieces of both colors attacking the square, sliders see through the given occupancy
+    Bitboard attackersTo(int square, Bitboard occupied) const {
+        return (pawnAttacks(BLACK, square) & pieces[makePiece(WHITE, PAWN)])
+             | (pawnAttacks(WHITE, square) & pieces[makePiece(BLACK, PAWN)])
+             | (knightAttacks(square) & (pieces[makePiece(WHITE, KNIGHT)] | pieces[makePiece(BLACK, KNIGHT)]))
+             | (kingAttacks(square) & (pieces[makePiece(WHITE, KING)] | pieces[makePiece(BLACK, KING)]))
+             | (bishopAttacks(square, occupied) & (pieces[makePiece(WHITE, BISHOP)] | pieces[makePiece(BLACK, BISHOP)]
+                                                   | pieces[makePiece(WHITE, QUEEN)] | pieces[makePiece(BLACK, QUEEN)]))
+             | (rookAttacks(square, occupied) & (pieces[makePiece(WHITE, ROOK)] | pieces[makePiece(BLACK, ROOK)]
+                                                 | pieces[makePiece(WHITE, QUEEN)] | pieces[makePiece(BLACK, QUEEN)]));
+    }
+    bool isAttacked(int square, color by) const {
+        return (attackersTo(square, occupancy) & colorOccupancy[by]) != 0;
+    }
+    Bitboard checkers() const {
+        return attackersTo(kingSquare(sideToMove), occupancy) & colorOccupancy[!sideToMove];
+    }
+    bool inCheck() const {
+        return checkers() != 0;
+    }
+};
+
+
+#endif //RG_3D_SAH_POSITION_H
@@ -0,0 +1,149 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#include "Profiler.h"
+
+#include <cstdio>
+
+#ifdef RG_3D_SAH_PROFILE
+
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include <unistd.h>
+
+thread_local ProfileBuffer *profileThreadBuffer = nullptr;
+
+static std::mutex registryMutex;
+static std::vector<ProfileBuffer *> buffers;
+// Buffers of threads that exited, the next new thread takes one over instead of allocating
+static std::vector<ProfileBuffer *> retired;
+
+// Ticks and wall time when the program started, the dump scales ticks by comparing against them again
+static const uint64_t startTicks = profileTicks();
+static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+struct ProfileRetire {
+    ~ProfileRetire() {
+        if(profileThreadBuffer == nullptr)
+            return;
+        std::lock_guard<std::mutex> lock(registryMutex);
+        retired.push_back(profileThreadBuffer);
+    }
+};
+static thread_local ProfileRetire profileRetire;
+
+ProfileBuffer *profileRegisterThread() {
+    // Constructs the thread's retire hook
+    (void)&profileRetire;
+    std::lock_guard<std::mutex> lock(registryMutex);
+    if(!retired.empty())
+    {
+        profileThreadBuffer = retired.back();
+        retired.pop_back();
+        return profileThreadBuffer;
+    }
+    auto *buffer = new ProfileBuffer();
+    buffer->id = (int)buffers.size() + 1;
+    buffer->name = "thread " + std::to_string(buffer->id);
+    buffers.push_back(buffer);
+    profileThreadBuffer = buffer;
+    return buffer;
+}
+
+void profileThreadName(const std::string &name) {
+    ProfileBuffer *buffer = profileThreadBuffer;
+    if(buffer == nullptr)
+        buffer = profileRegisterThread();
+    std::lock_guard<std::mutex> lock(registryMutex);
+    buffer->name = name;
+}
+
+bool profileEnabled() {
+    return true;
+}
+
+static void writeString(FILE *out, const char *s) {
+    fputc('"', out);
+    for(; *s; s++)
+    {
+        if(*s == '"' || *s == '\\')
+            fputc('\\', out);
+        if((unsigned char)*s >= 0x20)
+            fputc(*s, out);
+    }
+    fputc('"', out);
+}
+
+bool profileWriteTrace(const std::string &path) {
+    FILE *out = fopen(path.c_str(), "w");
+    if(out == nullptr)
+        return false;
+    double nanosecondsPerTick = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - startTime).count()
+                                / std::max<uint64_t>(1, profileTicks() - startTicks);
+    int pid = getpid();
+
+    std::vector<ProfileBuffer *> threads;
+    std::vector<std::string> names;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        threads = buffers;
+        for(ProfileBuffer *buffer : threads)
+            names.push_back(buffer->name);
+    }
+
+    fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    bool first = true;
+    std::vector<ProfileEvent> events;
+    for(size_t t = 0; t < threads.size(); t++)
+    {
+        ProfileBuffer *buffer = threads[t];
+        fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":", first ? "" : ",\n", pid, buffer->id);
+        writeString(out, names[t].c_str());
+        fprintf(out, "}}");
+        first = false;
+
+        uint64_t end = buffer->head.load(std::memory_order_acquire);
+        uint64_t begin = end > PROFILE_EVENTS ? end - PROFILE_EVENTS : 0;
+        events.clear();
+        for(uint64_t i = begin; i < end; i++)
+            events.push_back(buffer->events[i & (PROFILE_EVENTS - 1)]);
+        // The thread may have lapped the copy meanwhile, what it wrote over is dropped, and so is the slot it
+        // may be writing right now without having moved the head yet
+        uint64_t after = buffer->head.load(std::memory_order_acquire);
+        size_t skip = after + 1 > begin + PROFILE_EVENTS ? std::min<uint64_t>(after + 1 - begin - PROFILE_EVENTS, events.size()) : 0;
+
+        // Zones that began before the oldest kept event have lost their start, their ends are dropped
+        int depth = 0;
+        for(size_t i = skip; i < events.size(); i++)
+        {
+            if(events[i].name == nullptr && depth == 0)
+                continue;
+            depth += events[i].name != nullptr ? 1 : -1;
+            double microseconds = (int64_t)(events[i].ticks - startTicks) * nanosecondsPerTick / 1000.0;
+            fprintf(out, ",\n{\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d", events[i].name ? 'B' : 'E', microseconds, pid, buffer->id);
+            if(events[i].name != nullptr)
+            {
+                fprintf(out, ",\"name\":");
+                writeString(out, events[i].name);
+            }
+            fputc('}', out);
+        }
+    }
+    fprintf(out, "\n]}\n");
+    return fclose(out) == 0;
+}
+
+#else
+
+bool profileEnabled() {
+    return false;
+}
+
+bool profileWriteTrace(const std::string &path) {
+    (void)path;
+    return false;
+}
+
+#endif
@@ -0,0 +1,91 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#ifndef RG_3D_SAH_PROFILER_H
+#define RG_3D_SAH_PROFILER_H
+
+#include <string>
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Scoped zones recorded per thread and written out in the Chrome trace format, which chrome://tracing and
+// Perfetto open. PROFILE_SCOPE("name") marks the rest of the enclosing block, PROFILE_THREAD("name") labels
+// the calling thread. Both compile to nothing unless the build defines RG_3D_SAH_PROFILE, names must be
+// string literals.
+
+#ifdef RG_3D_SAH_PROFILE
+
+// An end event has no name
+struct ProfileEvent {
+    uint64_t ticks;
+    const char *name;
+};
+
+// Events kept per thread, older ones are overwritten
+const uint64_t PROFILE_EVENTS = 1 << 16;
+
+// Written only by its thread, the head is published after the event so the writer never waits on a reader
+struct ProfileBuffer {
+    ProfileEvent events[PROFILE_EVENTS];
+    std::atomic<uint64_t> head{0};
+    int id;
+    std::string name;
+};
+
+extern thread_local ProfileBuffer *profileThreadBuffer;
+ProfileBuffer *profileRegisterThread();
+void profileThreadName(const std::string &name);
+
+inline uint64_t profileTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+inline void profileEvent(const char *name) {
+    ProfileBuffer *buffer = profileThreadBuffer;
+    if(buffer == nullptr)
+        buffer = profileRegisterThread();
+    uint64_t head = buffer->head.load(std::memory_order_relaxed);
+    ProfileEvent &event = buffer->events[head & (PROFILE_EVENTS - 1)];
+    event.ticks = profileTicks();
+    event.name = name;
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+class ProfileScope {
+public:
+    explicit ProfileScope(const char *name) {
+        profileEvent(name);
+    }
+    ~ProfileScope() {
+        profileEvent(nullptr);
+    }
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_THREAD(name) profileThreadName(name)
+
+#else
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_THREAD(name)
+
+#endif
+
+// Whether the build records zones at all
+bool profileEnabled();
+// Writes the events every thread still holds as Chrome trace JSON, false if profiling is compiled out or the
+// file can't be written. Threads keep recording meanwhile
+bool profileWriteTrace(const std::string &path);
+
+#endif //RG_3D_SAH_PROFILER_H
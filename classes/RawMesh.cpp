@@ -3,20 +3,22 @@
 //
 
 #include "RawMesh.h"
+#include "MemoryTracker.h"
+#include "GlState.h"
 
 RawMesh::RawMesh(float *vertices, int numOfVertices, int sizeOfVertices, unsigned *indices, int numOfIndices, MaterialTexture &material)
     : vertices{vertices}, numOfVertices{numOfVertices}, sizeOfVertices{sizeOfVertices}, indices{indices}, numOfIndices{numOfIndices}, material{material} {
         glGenVertexArrays(1, &VAO);
-        glBindVertexArray(VAO);
+        stateBindVertexArray(VAO);
 
         glGenBuffers(1, &VBO);
         glGenBuffers(1, &EBO);
 
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeOfVertices, vertices, GL_STATIC_DRAW);
+        stateBindBuffer(GL_ARRAY_BUFFER, VBO);
+        memoryBufferData(GL_ARRAY_BUFFER, VBO, sizeOfVertices, vertices, GL_STATIC_DRAW, GEOMETRY, "raw meshes");
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, numOfIndices * sizeof(unsigned), indices, GL_STATIC_DRAW);
+        stateBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        memoryBufferData(GL_ELEMENT_ARRAY_BUFFER, EBO, numOfIndices * sizeof(unsigned), indices, GL_STATIC_DRAW, GEOMETRY, "raw meshes");
 
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)0);
         glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(3 * sizeof(float)));
@@ -26,23 +28,23 @@ RawMesh::RawMesh(float *vertices, int numOfVertices, int sizeOfVertices, unsigne
         glEnableVertexAttribArray(1);
         glEnableVertexAttribArray(2);
 
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
+        stateBindBuffer(GL_ARRAY_BUFFER, 0);
+        stateBindVertexArray(0);
     }
 
 RawMesh::RawMesh(float *vertices, int numOfVertices, int sizeOfVertices, unsigned *indices, int numOfIndices, MaterialColor &material)
     : vertices{vertices}, numOfVertices{numOfVertices}, sizeOfVertices{sizeOfVertices}, indices{indices}, numOfIndices{numOfIndices}, material{material} {
         glGenVertexArrays(1, &VAO);
-        glBindVertexArray(VAO);
+        stateBindVertexArray(VAO);
 
         glGenBuffers(1, &VBO);
         glGenBuffers(1, &EBO);
 
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeOfVertices, vertices, GL_STATIC_DRAW);
+        stateBindBuffer(GL_ARRAY_BUFFER, VBO);
+        memoryBufferData(GL_ARRAY_BUFFER, VBO, sizeOfVertices, vertices, GL_STATIC_DRAW, GEOMETRY, "raw meshes");
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, numOfIndices * sizeof(unsigned), indices, GL_STATIC_DRAW);
+        stateBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        memoryBufferData(GL_ELEMENT_ARRAY_BUFFER, EBO, numOfIndices * sizeof(unsigned), indices, GL_STATIC_DRAW, GEOMETRY, "raw meshes");
 
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)0);
         glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)(3 * sizeof(float)));
@@ -50,19 +52,19 @@ RawMesh::RawMesh(float *vertices, int numOfVertices, int sizeOfVertices, unsigne
         glEnableVertexAttribArray(0);
         glEnableVertexAttribArray(1);
 
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
+        stateBindBuffer(GL_ARRAY_BUFFER, 0);
+        stateBindVertexArray(0);
     }
 
 RawMesh::RawMesh(float *vertices, int numOfVertices, int sizeOfVertices, MaterialTexture &material)
     : vertices{vertices}, numOfVertices{numOfVertices}, sizeOfVertices{sizeOfVertices}, indices{nullptr}, numOfIndices{0}, material{material} {
         glGenVertexArrays(1, &VAO);
-        glBindVertexArray(VAO);
+        stateBindVertexArray(VAO);
 
         glGenBuffers(1, &VBO);
 
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeOfVertices, vertices, GL_STATIC_DRAW);
+        stateBindBuffer(GL_ARRAY_BUFFER, VBO);
+        memoryBufferData(GL_ARRAY_BUFFER, VBO, sizeOfVertices, vertices, GL_STATIC_DRAW, GEOMETRY, "raw meshes");
 
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)0);
         glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(3 * sizeof(float)));
@@ -72,19 +74,19 @@ RawMesh::RawMesh(float *vertices, int numOfVertices, int sizeOfVertices, Materia
         glEnableVertexAttribArray(1);
         glEnableVertexAttribArray(2);
 
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
+        stateBindBuffer(GL_ARRAY_BUFFER, 0);
+        stateBindVertexArray(0);
     }
 
 RawMesh::RawMesh(float *vertices, int numOfVertices, int sizeOfVertices, MaterialColor &material)
     : vertices{vertices}, numOfVertices{numOfVertices}, sizeOfVertices{sizeOfVertices}, indices{nullptr}, numOfIndices{0}, material{material} {
         glGenVertexArrays(1, &VAO);
-        glBindVertexArray(VAO);
+        stateBindVertexArray(VAO);
 
         glGenBuffers(1, &VBO);
 
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeOfVertices, vertices, GL_STATIC_DRAW);
+        stateBindBuffer(GL_ARRAY_BUFFER, VBO);
+        memoryBufferData(GL_ARRAY_BUFFER, VBO, sizeOfVertices, vertices, GL_STATIC_DRAW, GEOMETRY, "raw meshes");
 
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)0);
         glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)(3 * sizeof(float)));
@@ -92,15 +94,22 @@ RawMesh::RawMesh(float *vertices, int numOfVertices, int sizeOfVertices, Materia
         glEnableVertexAttribArray(0);
         glEnableVertexAttribArray(1);
 
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
+        stateBindBuffer(GL_ARRAY_BUFFER, 0);
+        stateBindVertexArray(0);
     }
 
 void RawMesh::draw(Shader &shader) {
     material.activate(shader, "material");
-    glBindVertexArray(VAO);
+    stateBindVertexArray(VAO);
     if(numOfIndices != 0)
         glDrawElements(GL_TRIANGLES, numOfIndices, GL_UNSIGNED_INT, 0);
     else
         glDrawArrays(GL_TRIANGLES, 0, numOfVertices);
-}
\ No newline at end of file
+}
+
+void RawMesh::del() {
+    stateDeleteVertexArrays(1, &VAO);
+    memoryDeleteBuffers(1, &VBO);
+    if(numOfIndices != 0)
+        memoryDeleteBuffers(1, &EBO);
+}
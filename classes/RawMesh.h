@@ -21,6 +21,7 @@ public:
     RawMesh(float *vertices, int numOfVertices, int sizeOfVertices, MaterialTexture &material);
     RawMesh(float *vertices, int numOfVertices, int sizeOfVertices, MaterialColor &material);
     void draw(Shader &shader);
+    void del();
 };
 
 
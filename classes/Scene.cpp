@@ -3,6 +3,7 @@
 //
 
 #include "Scene.h"
+#include "Profiler.h"
 
 Scene::Scene(Camera &camera)
     : camera{camera} { }
@@ -16,6 +17,7 @@ void Scene::addRawMesh(RawMesh *mesh, Shader *shader, glm::mat4 *transformation)
 }
 
 void Scene::render() {
+    PROFILE_SCOPE("render scene");
     for(auto it : lights)
     {
         it.first->use();
@@ -0,0 +1,367 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#include "Search.h"
+#include "Nnue.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstring>
+
+// Mate scores are stored relative to the node rather than the root, so they stay right wherever the
+// position comes up again
+static int scoreToTT(int score, int ply) {
+    if(score >= VALUE_MATE_IN_MAX_PLY)
+        return score + ply;
+    if(score <= -VALUE_MATE_IN_MAX_PLY)
+        return score - ply;
+    return score;
+}
+
+static int scoreFromTT(int score, int ply) {
+    if(score >= VALUE_MATE_IN_MAX_PLY)
+        return score - ply;
+    if(score <= -VALUE_MATE_IN_MAX_PLY)
+        return score + ply;
+    return score;
+}
+
+// Moves the best scored remaining move to index i and returns it
+static Move pickMove(MoveList &list, int *scores, int i) {
+    int best = i;
+    for(int j = i + 1; j < list.size(); j++)
+        if(scores[j] > scores[best])
+            best = j;
+    std::swap(list.moves[i], list.moves[best]);
+    std::swap(scores[i], scores[best]);
+    return list.moves[i];
+}
+
+const int HASH_MOVE_SCORE = 1 << 30;
+const int CAPTURE_SCORE = 1 << 20;
+const int KILLER_SCORE = 1 << 19;
+// History scores stay below the killers
+const int HISTORY_MAX = 1 << 18;
+
+// Lazy SMP depth staggering: helper i skips the depths where (depth + phase) / size is odd, so at any time
+// the helpers are spread over the current iteration and the next ones
+static const int skipSize[20] = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+static const int skipPhase[20] = {0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7};
+
+Searcher::Searcher(TranspositionTable &tt, const SearchSignals &signals, int threadIndex)
+        : tt{tt}, signals{signals}, threadIndex{threadIndex}, pondering{false}, nodes{0}, publishedNodes{0}, stopped{false},
+          accumulators{nnueAllocateAccumulators()} {
+    std::memset(killers, 0, sizeof(killers));
+    std::memset(history, 0, sizeof(history));
+    std::memset(pvLength, 0, sizeof(pvLength));
+}
+
+Searcher::~Searcher() {
+    nnueFreeAccumulators(accumulators);
+}
+
+int64_t Searcher::elapsed() const {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+SearchReport Searcher::think(const Position &root, const SearchLimits &limits, const std::function<void(const SearchReport &)> &report) {
+    PROFILE_SCOPE("search");
+    pos = root;
+    pos.setAccumulators(accumulators);
+    Searcher::limits = limits;
+    startTime = std::chrono::steady_clock::now();
+    pondering = false;
+    nodes = 0;
+    publishedNodes.store(0, std::memory_order_relaxed);
+    stopped = false;
+    std::memset(killers, 0, sizeof(killers));
+    // Old history still hints at good moves, but shouldn't outweigh what this search finds
+    for(auto &piece : history)
+        for(int &h : piece)
+            h /= 8;
+
+    SearchReport result = {};
+    result.rootKey = root.getKey();
+    MoveList rootMoves;
+    generateMoves(pos, rootMoves);
+    // Something to play even if the first iteration doesn't finish
+    if(rootMoves.size() > 0)
+    {
+        result.pv[0] = rootMoves.moves[0];
+        result.pvLength = 1;
+    }
+    // Without moves the game is already over, mated or stalemated
+    else
+        result.score = pos.inCheck() ? -VALUE_MATE : VALUE_DRAW;
+
+    int score = 0;
+    // A game at the end of the move stack can't be searched, the first move is all there is
+    bool searchable = rootMoves.size() > 0 && pos.getGamePly() < MAX_GAME_PLY - 1;
+    for(int depth = 1; depth <= limits.depth && searchable; depth++)
+    {
+        if(threadIndex > 0)
+        {
+            int i = (threadIndex - 1) % 20;
+            if(((depth + skipPhase[i]) / skipSize[i]) % 2)
+                continue;
+        }
+        PROFILE_SCOPE("iteration");
+        // Start with a narrow window around the last score and widen it on the side the search fell out of
+        int delta = 25;
+        int alpha = -VALUE_INFINITE, beta = VALUE_INFINITE;
+        if(depth >= 5)
+        {
+            alpha = std::max(score - delta, -VALUE_INFINITE);
+            beta = std::min(score + delta, VALUE_INFINITE);
+        }
+        while(true)
+        {
+            int value = search(alpha, beta, depth, 0);
+            if(stopped)
+                break;
+            if(value <= alpha)
+            {
+                beta = (alpha + beta) / 2;
+                alpha = std::max(value - delta, -VALUE_INFINITE);
+            }
+            else if(value >= beta)
+                beta = std::min(value + delta, VALUE_INFINITE);
+            else
+            {
+                score = value;
+                break;
+            }
+            delta += delta;
+        }
+        if(stopped)
+            break;
+
+        result.depth = depth;
+        result.score = score;
+        result.pvLength = pvLength[0];
+        std::copy(pv[0], pv[0] + pvLength[0], result.pv);
+        result.nodes = nodes;
+        result.elapsed = elapsed();
+        result.hashfull = tt.hashfull();
+        if(report)
+            report(result);
+
+        // Another iteration takes longer than all before it, don't start one that can't finish
+        checkPonder();
+        if(limits.moveTime && !pondering && elapsed() * 2 > limits.moveTime)
+            break;
+        if(std::abs(score) >= VALUE_MATE_IN_MAX_PLY && depth > VALUE_MATE - std::abs(score))
+            break;
+    }
+    publishedNodes.store(nodes, std::memory_order_relaxed);
+    result.nodes = nodes;
+    result.elapsed = elapsed();
+    result.finished = true;
+    return result;
+}
+
+void Searcher::checkLimits() {
+    publishedNodes.store(nodes, std::memory_order_relaxed);
+    checkPonder();
+    if((limits.moveTime && !pondering && elapsed() >= limits.moveTime) || (limits.nodes && nodes >= limits.nodes))
+        stopped = true;
+}
+
+void Searcher::checkPonder() {
+    bool ponder = signals.ponder.load(std::memory_order_relaxed);
+    // The ponderhit is when the opponent actually played the move, the time for ours starts then
+    if(pondering && !ponder)
+        startTime = std::chrono::steady_clock::now();
+    pondering = ponder;
+}
+
+void Searcher::updatePv(Move m, int ply) {
+    pv[ply][ply] = m;
+    for(int i = ply + 1; i < pvLength[ply + 1]; i++)
+        pv[ply][i] = pv[ply + 1][i];
+    pvLength[ply] = std::max(pvLength[ply + 1], ply + 1);
+}
+
+void Searcher::scoreMoves(const MoveList &list, int *scores, Move hashMove, int ply) const {
+    for(int i = 0; i < list.size(); i++)
+    {
+        Move m = list.moves[i];
+        int piece = pos.pieceOn(moveFrom(m));
+        if(m == hashMove)
+            scores[i] = HASH_MOVE_SCORE;
+        else if(isCapture(m) || isPromotion(m))
+        {
+            // Most valuable victim first, taken by the least valuable attacker
+            int victim = moveFlags(m) == EN_PASSANT ? PAWN : isCapture(m) ? pieceType(pos.pieceOn(moveTo(m))) : PAWN;
+            scores[i] = CAPTURE_SCORE + (isCapture(m) ? pieceValues[victim] * 16 : 0) - pieceType(piece)
+                        + (isPromotion(m) ? pieceValues[promotionType(m)] * 16 : 0);
+        }
+        else if(m == killers[ply][0])
+            scores[i] = KILLER_SCORE;
+        else if(m == killers[ply][1])
+            scores[i] = KILLER_SCORE - 1;
+        else
+            scores[i] = history[piece][moveTo(m)];
+    }
+}
+
+int Searcher::search(int alpha, int beta, int depth, int ply) {
+    if(depth <= 0)
+        return quiescence(alpha, beta, ply);
+
+    pvLength[ply] = ply;
+    bool pvNode = beta - alpha > 1;
+    if((++nodes & 1023) == 0)
+        checkLimits();
+    if(stopped || signals.stop.load(std::memory_order_relaxed))
+    {
+        stopped = true;
+        return 0;
+    }
+
+    if(ply > 0)
+    {
+        if(pos.isDraw())
+            return VALUE_DRAW;
+        // The position's move stack is full, a move more would overflow it
+        if(ply >= MAX_PLY - 1 || pos.getGamePly() >= MAX_GAME_PLY - 1)
+            return evaluate(pos);
+        // No line from here can beat a mate already found closer to the root
+        alpha = std::max(alpha, -VALUE_MATE + ply);
+        beta = std::min(beta, VALUE_MATE - ply - 1);
+        if(alpha >= beta)
+            return alpha;
+    }
+
+    TTEntry entry;
+    Move hashMove = NO_MOVE;
+    if(tt.probe(pos.getKey(), entry))
+    {
+        hashMove = entry.move;
+        int ttScore = scoreFromTT(entry.score, ply);
+        if(!pvNode && entry.depth >= depth
+           && (entry.bound == BOUND_EXACT
+               || (entry.bound == BOUND_LOWER && ttScore >= beta)
+               || (entry.bound == BOUND_UPPER && ttScore <= alpha)))
+            return ttScore;
+    }
+
+    bool inCheck = pos.inCheck();
+    // Don't let a check push the reply past the horizon
+    if(inCheck)
+        depth++;
+
+    MoveList list;
+    generateMoves(pos, list);
+    if(list.size() == 0)
+        return inCheck ? -VALUE_MATE + ply : VALUE_DRAW;
+    int scores[MAX_MOVES];
+    scoreMoves(list, scores, hashMove, ply);
+
+    int bestScore = -VALUE_INFINITE;
+    Move bestMove = NO_MOVE;
+    for(int i = 0; i < list.size(); i++)
+    {
+        Move m = pickMove(list, scores, i);
+        int piece = pos.pieceOn(moveFrom(m));
+        tt.prefetch(pos.keyAfter(m));
+        pos.makeMove(m);
+        int score;
+        // The first move is expected to be best, the rest only have to be proven worse with a null window
+        if(i == 0)
+            score = -search(-beta, -alpha, depth - 1, ply + 1);
+        else
+        {
+            score = -search(-alpha - 1, -alpha, depth - 1, ply + 1);
+            if(score > alpha && score < beta)
+                score = -search(-beta, -alpha, depth - 1, ply + 1);
+        }
+        pos.unmakeMove();
+        if(stopped)
+            return 0;
+
+        if(score > bestScore)
+        {
+            bestScore = score;
+            if(score > alpha)
+            {
+                bestMove = m;
+                alpha = score;
+                updatePv(m, ply);
+                if(alpha >= beta)
+                {
+                    if(!isCapture(m) && !isPromotion(m))
+                    {
+                        if(killers[ply][0] != m)
+                        {
+                            killers[ply][1] = killers[ply][0];
+                            killers[ply][0] = m;
+                        }
+                        int &h = history[piece][moveTo(m)];
+                        h += depth * depth;
+                        if(h > HISTORY_MAX)
+                            for(auto &p : history)
+                                for(int &v : p)
+                                    v /= 2;
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    int b = bestScore >= beta ? BOUND_LOWER : bestMove != NO_MOVE ? BOUND_EXACT : BOUND_UPPER;
+    tt.store(pos.getKey(), bestMove, scoreToTT(bestScore, ply), depth, b);
+    return bestScore;
+}
+
+int Searcher::quiescence(int alpha, int beta, int ply) {
+    pvLength[ply] = ply;
+    if((++nodes & 1023) == 0)
+        checkLimits();
+    if(stopped || signals.stop.load(std::memory_order_relaxed))
+    {
+        stopped = true;
+        return 0;
+    }
+    if(ply >= MAX_PLY - 1 || pos.getGamePly() >= MAX_GAME_PLY - 1)
+        return evaluate(pos);
+
+    // Out of check the side to move can stand pat, in check every evasion has to be looked at
+    bool inCheck = pos.inCheck();
+    int bestScore = -VALUE_MATE + ply;
+    if(!inCheck)
+    {
+        bestScore = evaluate(pos);
+        if(bestScore >= beta)
+            return bestScore;
+        alpha = std::max(alpha, bestScore);
+    }
+
+    MoveList list;
+    generateMoves(pos, list, inCheck ? ALL_MOVES : CAPTURES);
+    int scores[MAX_MOVES];
+    scoreMoves(list, scores, NO_MOVE, ply);
+    for(int i = 0; i < list.size(); i++)
+    {
+        Move m = pickMove(list, scores, i);
+        pos.makeMove(m);
+        int score = -quiescence(-beta, -alpha, ply + 1);
+        pos.unmakeMove();
+        if(stopped)
+            return 0;
+        if(score > bestScore)
+        {
+            bestScore = score;
+            if(score > alpha)
+            {
+                alpha = score;
+                updatePv(m, ply);
+                if(alpha >= beta)
+                    break;
+            }
+        }
+    }
+    return bestScore;
+}
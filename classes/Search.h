@@ -0,0 +1,95 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#ifndef RG_3D_SAH_SEARCH_H
+#define RG_3D_SAH_SEARCH_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+
+#include "Position.h"
+#include "MoveGen.h"
+#include "Evaluation.h"
+#include "TranspositionTable.h"
+
+// When a search has to finish, zero means no limit
+struct SearchLimits {
+    int depth = MAX_PLY - 1;
+    // Milliseconds
+    int64_t moveTime = 0;
+    uint64_t nodes = 0;
+    // Search the position the opponent is expected to reach, the clock waits for a ponderhit
+    bool ponder = false;
+};
+
+// Flags the controlling thread flips while a search runs, read by every search thread
+struct SearchSignals {
+    std::atomic<bool> stop{false};
+    // Time limits don't count while pondering, the clock starts over once it ends
+    std::atomic<bool> ponder{false};
+};
+
+// Progress of a search, sent after every completed iteration and once more when it's over
+struct SearchReport {
+    // Key of the position searched, so a result that arrives after the game moved on can be told apart
+    uint64_t rootKey;
+    int depth;
+    int score;
+    uint64_t nodes;
+    int64_t elapsed;
+    // Permille of the transposition table in use
+    int hashfull;
+    Move pv[MAX_PLY];
+    int pvLength;
+    bool finished;
+
+    Move bestMove() const {
+        return pvLength > 0 ? pv[0] : NO_MOVE;
+    }
+};
+
+// Iterative deepening alpha-beta on one thread: principal variation search inside aspiration windows, quiescence
+// search at the leaves, moves ordered by hash move, MVV-LVA, killers and history
+class Searcher {
+    Position pos;
+    TranspositionTable &tt;
+    const SearchSignals &signals;
+    // Zero for the thread that owns the clock, helpers skip some depths so the threads spread over the tree
+    int threadIndex;
+    SearchLimits limits;
+    std::chrono::steady_clock::time_point startTime;
+    bool pondering;
+    uint64_t nodes;
+    // Copy of nodes other threads can read, refreshed every few thousand nodes
+    std::atomic<uint64_t> publishedNodes;
+    bool stopped;
+
+    Move killers[MAX_PLY][2];
+    int history[12][64];
+    Move pv[MAX_PLY][MAX_PLY];
+    int pvLength[MAX_PLY];
+    // Incrementally updated NNUE accumulators for pos
+    Accumulator *accumulators;
+
+    int search(int alpha, int beta, int depth, int ply);
+    int quiescence(int alpha, int beta, int ply);
+    void scoreMoves(const MoveList &list, int *scores, Move hashMove, int ply) const;
+    void updatePv(Move m, int ply);
+    void checkLimits();
+    void checkPonder();
+public:
+    Searcher(TranspositionTable &tt, const SearchSignals &signals, int threadIndex = 0);
+    ~Searcher();
+    Searcher(const Searcher &) = delete;
+    Searcher &operator=(const Searcher &) = delete;
+    // Searches until a limit is hit or a stop is requested, report is called after every completed iteration
+    SearchReport think(const Position &root, const SearchLimits &limits, const std::function<void(const SearchReport &)> &report);
+    int64_t elapsed() const;
+    uint64_t getNodes() const {
+        return publishedNodes.load(std::memory_order_relaxed);
+    }
+};
+
+#endif //RG_3D_SAH_SEARCH_H
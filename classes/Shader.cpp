@@ -12,6 +12,8 @@
 #include <sstream>
 
 #include "error.h"
+#include "Profiler.h"
+#include "GlState.h"
 
 static std::string readFile(const std::string &path) {
     std::ifstream in(path);
@@ -20,58 +22,99 @@ static std::string readFile(const std::string &path) {
     return buffer.str();
 }
 
-Shader::Shader(const std::string &vertexShaderPath, const std::string &fragmentShaderPath) {
+static unsigned compileShader(GLenum type, const std::string &source, std::string &errors) {
     int success = 0;
     char errLog[512];
-
-    std::string vs = readFile(vertexShaderPath);
-    const char *vertexShaderSource = vs.c_str();
-    unsigned vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, nullptr);
-    glCompileShader(vertexShader);
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
+    const char *shaderSource = source.c_str();
+    unsigned shader = glCreateShader(type);
+    glShaderSource(shader, 1, &shaderSource, nullptr);
+    glCompileShader(shader);
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
     if(!success)
     {
-        glGetShaderInfoLog(vertexShader, 512, nullptr, errLog);
-        std::cerr << errLog << std::endl;
-        CHECK_ERROR(0, "Vertex shader compilation failed");
+        glGetShaderInfoLog(shader, 512, nullptr, errLog);
+        errors = errLog;
+        glDeleteShader(shader);
+        return 0;
     }
+    return shader;
+}
 
-    std::string fs = readFile(fragmentShaderPath);
-    const char *fragmentShaderSource = fs.c_str();
-    unsigned fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, nullptr);
-    glCompileShader(fragmentShader);
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if(!success)
+unsigned Shader::compileProgram(const std::string &vertexShaderSource, const std::string &fragmentShaderSource, std::string &errors) {
+    PROFILE_SCOPE("compile shader");
+    int success = 0;
+    char errLog[512];
+
+    unsigned vertexShader = compileShader(GL_VERTEX_SHADER, vertexShaderSource, errors);
+    if(vertexShader == 0)
     {
-        glGetShaderInfoLog(fragmentShader, 512, nullptr, errLog);
-        std::cerr << errLog << std::endl;
-        CHECK_ERROR(0, "Fragment shader compilation failed");
+        errors = "Vertex shader compilation failed\n" + errors;
+        return 0;
     }
-
-    sp_id = glCreateProgram();
-    glAttachShader(sp_id, vertexShader);
-    glAttachShader(sp_id, fragmentShader);
-    glLinkProgram(sp_id);
-    glGetProgramiv(sp_id, GL_LINK_STATUS, &success);
-    if(!success)
+    unsigned fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentShaderSource, errors);
+    if(fragmentShader == 0)
     {
-        glGetProgramInfoLog(sp_id, 512, nullptr, errLog);
-        std::cerr << errLog << std::endl;
-        CHECK_ERROR(0, "Shader program linkage failed");
+        glDeleteShader(vertexShader);
+        errors = "Fragment shader compilation failed\n" + errors;
+        return 0;
     }
 
+    unsigned program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glLinkProgram(program);
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if(!success)
+    {
+        glGetProgramInfoLog(program, 512, nullptr, errLog);
+        errors = std::string("Shader program linkage failed\n") + errLog;
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+bool Shader::readSources(const std::string &vertexShaderPath, const std::string &fragmentShaderPath,
+                         std::string &vertexShaderSource, std::string &fragmentShaderSource) {
+    std::ifstream vertexIn(vertexShaderPath), fragmentIn(fragmentShaderPath);
+    if(!vertexIn || !fragmentIn)
+        return false;
+    vertexShaderSource = readFile(vertexShaderPath);
+    fragmentShaderSource = readFile(fragmentShaderPath);
+    return true;
+}
+
+Shader::Shader(const std::string &vertexShaderPath, const std::string &fragmentShaderPath) {
+    std::string errors;
+    sp_id = compileProgram(readFile(vertexShaderPath), readFile(fragmentShaderPath), errors);
+    if(sp_id == 0)
+    {
+        std::cerr << errors << std::endl;
+        CHECK_ERROR(0, "Shader program creation failed");
+    }
+}
+
+bool Shader::reload(const std::string &vertexShaderSource, const std::string &fragmentShaderSource) {
+    std::string errors;
+    unsigned program = compileProgram(vertexShaderSource, fragmentShaderSource, errors);
+    if(program == 0)
+    {
+        std::cerr << errors << std::endl;
+        return false;
+    }
+    stateDeleteProgram(sp_id);
+    sp_id = program;
+    return true;
 }
 
 void Shader::use() const {
-    glUseProgram(sp_id);
+    stateUseProgram(sp_id);
 }
 
 void Shader::del() {
-    glDeleteProgram(sp_id);
+    stateDeleteProgram(sp_id);
     sp_id = -1;
 }
 
@@ -11,10 +11,15 @@
 
 class Shader {
     unsigned sp_id;
+    static unsigned compileProgram(const std::string &vertexShaderSource, const std::string &fragmentShaderSource, std::string &errors);
 public:
     Shader(const std::string &vertexShaderPath, const std::string &fragmentShaderPath);
     void use() const;
     void del();
+    // Swaps in a program built from the given sources, the current program is kept if they don't compile or link
+    bool reload(const std::string &vertexShaderSource, const std::string &fragmentShaderSource);
+    static bool readSources(const std::string &vertexShaderPath, const std::string &fragmentShaderPath,
+                            std::string &vertexShaderSource, std::string &fragmentShaderSource);
 
     void setUniform1f(const std::string &uniformName, float x) const;
     void setUniform2f(const std::string &uniformName, float x, float y) const;
@@ -8,10 +8,15 @@
 #include <iostream>
 
 #include "error.h"
+#include "MemoryTracker.h"
+#include "GlState.h"
+#include "Profiler.h"
 
 Skybox::Skybox(const std::vector<std::string> &facePaths) {
+    PROFILE_SCOPE("load skybox");
+    std::string owner = facePaths.empty() ? "skybox" : facePaths[0].substr(0, facePaths[0].find_last_of('/'));
     glGenTextures(1, &tex_id);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, tex_id);
+    stateBindTexture(GL_TEXTURE_CUBE_MAP, tex_id);
 
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
@@ -28,7 +33,7 @@ Skybox::Skybox(const std::vector<std::string> &facePaths) {
     {
         data = stbi_load(facePaths[i].c_str(), &width, &height, &nChannels, 0);
         CHECK_ERROR(data != nullptr, "Failed to load image from file");
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+        memoryTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, tex_id, GL_RGB, width, height, GL_RGB, GL_UNSIGNED_BYTE, data, false, TEXTURES, owner);
         stbi_image_free(data);
     }
 
@@ -78,23 +83,24 @@ Skybox::Skybox(const std::vector<std::string> &facePaths) {
 
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
+    stateBindVertexArray(VAO);
+    stateBindBuffer(GL_ARRAY_BUFFER, VBO);
+    memoryBufferData(GL_ARRAY_BUFFER, VBO, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW, GEOMETRY, owner);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
 }
 
 void Skybox::draw() const {
-    glBindVertexArray(VAO);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, tex_id);
+    PROFILE_SCOPE("draw skybox");
+    stateBindVertexArray(VAO);
+    stateActiveTexture(GL_TEXTURE0);
+    stateBindTexture(GL_TEXTURE_CUBE_MAP, tex_id);
     glDrawArrays(GL_TRIANGLES, 0, 36);
 }
 
 void Skybox::del() {
-    glDeleteTextures(1, &tex_id);
+    memoryDeleteTextures(1, &tex_id);
     tex_id = -1;
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
+    stateDeleteVertexArrays(1, &VAO);
+    memoryDeleteBuffers(1, &VBO);
 }
\ No newline at end of file
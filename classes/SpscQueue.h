@@ -0,0 +1,49 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#ifndef RG_3D_SAH_SPSCQUEUE_H
+#define RG_3D_SAH_SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+// Fixed size ring buffer for handing values from one thread to exactly one other without locks. Each index is
+// written by one side only and sits on its own cache line, so neither side ever waits for the other.
+template<typename T, size_t Capacity>
+class SpscQueue {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    T slots[Capacity];
+    // Next slot to read, written by the consumer
+    std::atomic<size_t> head{0};
+    char headPadding[64 - sizeof(std::atomic<size_t>)];
+    // Next slot to write, written by the producer
+    std::atomic<size_t> tail{0};
+    char tailPadding[64 - sizeof(std::atomic<size_t>)];
+public:
+    // Producer side, false if the queue is full
+    bool push(const T &value) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if(t - head.load(std::memory_order_acquire) == Capacity)
+            return false;
+        slots[t & (Capacity - 1)] = value;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+    // Consumer side, false if the queue is empty
+    bool pop(T &value) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if(h == tail.load(std::memory_order_acquire))
+            return false;
+        value = slots[h & (Capacity - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+    // Approximate when called from the producer, exact from the consumer
+    size_t size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+};
+
+#endif //RG_3D_SAH_SPSCQUEUE_H
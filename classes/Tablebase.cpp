@@ -0,0 +1,1086 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#include "Tablebase.h"
+
+#include <unordered_map>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <climits>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// First bytes of a WDL and of a DTZ file
+const uint8_t WDL_MAGIC[4] = {0x71, 0xE8, 0x23, 0x5D};
+const uint8_t DTZ_MAGIC[4] = {0xD7, 0x66, 0x0C, 0xA5};
+
+// Flags of the file header: a table for each side to move, one for each file of the leading pawn
+const int TB_SPLIT = 1;
+const int TB_HAS_PAWNS = 2;
+
+// Flags of a compressed table
+const int PAIRS_STM = 1;
+const int PAIRS_MAPPED = 2;
+const int PAIRS_WIN_PLIES = 4;
+const int PAIRS_LOSS_PLIES = 8;
+const int PAIRS_WIDE = 16;
+const int PAIRS_SINGLE_VALUE = 128;
+
+// Symbol of the pair tree that has no right half, the left one is then the stored value
+const int LEAF_SYMBOL = 0xFFF;
+
+// Rank of the best root moves, above any distance to zeroing
+const int TB_MAX_DTZ = 1 << 18;
+
+const int TB_CACHE_SIZE = 1024;
+
+enum probeState {
+    PROBE_FAIL,
+    PROBE_OK,
+    // The DTZ table only holds the other side to move
+    PROBE_CHANGE_STM,
+    // The best move is a capture or pawn move, what the table holds for the position itself may be a filler
+    PROBE_ZEROING_BEST_MOVE
+};
+
+// Placements are numbered the way the generator did: the leading pieces or pawns mirrored into a corner
+// triangle or to the queen side, then every further group of equal pieces as a combination of the squares left
+static int mapPawns[64];
+static int mapB1H1H7[64];
+static int mapA1D1D4[64];
+static int mapKK[10][64];
+static uint64_t binomial[6][64];
+static int leadPawnIndex[6][64];
+static int leadPawnsSize[6][4];
+
+// Above the a1-h8 diagonal positive, below negative
+static int offDiagonal(int square) {
+    return rankOf(square) - fileOf(square);
+}
+
+static void initIndexing() {
+    int code = 0;
+    for(int s = 0; s < 64; s++)
+        if(offDiagonal(s) < 0)
+            mapB1H1H7[s] = code++;
+
+    // The b1-d1-d3 triangle first, the a1-d4 diagonal after it
+    std::vector<int> diagonal;
+    code = 0;
+    for(int s = 0; s <= 27; s++)
+        if(offDiagonal(s) < 0 && fileOf(s) <= 3)
+            mapA1D1D4[s] = code++;
+        else if(!offDiagonal(s) && fileOf(s) <= 3)
+            diagonal.push_back(s);
+    for(int s : diagonal)
+        mapA1D1D4[s] = code++;
+
+    // The 462 placements of two kings with the first in the triangle, both on the diagonal last
+    std::vector<std::pair<int, int>> bothOnDiagonal;
+    code = 0;
+    for(int index = 0; index < 10; index++)
+        for(int s1 = 0; s1 <= 27; s1++)
+        {
+            if(mapA1D1D4[s1] != index || (!index && s1 != 1))
+                continue;
+            for(int s2 = 0; s2 < 64; s2++)
+            {
+                if(std::abs(fileOf(s1) - fileOf(s2)) <= 1 && std::abs(rankOf(s1) - rankOf(s2)) <= 1)
+                    continue;
+                if(!offDiagonal(s1) && offDiagonal(s2) > 0)
+                    continue;
+                if(!offDiagonal(s1) && !offDiagonal(s2))
+                    bothOnDiagonal.push_back(std::make_pair(index, s2));
+                else
+                    mapKK[index][s2] = code++;
+            }
+        }
+    for(const std::pair<int, int> &p : bothOnDiagonal)
+        mapKK[p.first][p.second] = code++;
+
+    binomial[0][0] = 1;
+    for(int n = 1; n < 64; n++)
+        for(int k = 0; k < 6 && k <= n; k++)
+            binomial[k][n] = (k > 0 ? binomial[k - 1][n - 1] : 0) + (k < n ? binomial[k][n - 1] : 0);
+
+    // Pawns on a2-h7 count down from the edge files and the second rank, the leading pawn is the one with
+    // the highest number and every other pawn has to be on a lower one
+    int available = 47;
+    for(int leadPawns = 1; leadPawns <= 5; leadPawns++)
+        for(int file = 0; file < 4; file++)
+        {
+            int index = 0;
+            for(int rank = 1; rank <= 6; rank++)
+            {
+                int square = makeSquare(file, rank);
+                if(leadPawns == 1)
+                {
+                    mapPawns[square] = available--;
+                    mapPawns[square ^ 7] = available--;
+                }
+                leadPawnIndex[leadPawns][square] = index;
+                index += (int)binomial[leadPawns - 1][mapPawns[square]];
+            }
+            leadPawnsSize[leadPawns][file] = index;
+        }
+}
+
+static struct IndexingInitializer {
+    IndexingInitializer() {
+        initIndexing();
+    }
+} indexingInitializer;
+
+static uint16_t readLe16(const uint8_t *p) {
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static uint32_t readLe32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint32_t readBe32(const uint8_t *p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | (uint32_t)p[3];
+}
+
+// One table of a file, for a side to move and, with pawns, a file of the leading pawn. Values are compressed
+// by recursive pairing, every symbol standing for a pair of shorter ones, and the symbols by canonical
+// Huffman codes in blocks of a fixed size
+struct PairsData {
+    int flags;
+    uint64_t size;
+    uint64_t sizeofBlock;
+    uint64_t span;
+    uint32_t numBlocks;
+    int minSymLen;
+    // Lowest symbol of every code length, two bytes each
+    const uint8_t *lowestSym;
+    // Left and right half of every symbol, twelve bits each
+    const uint8_t *btree;
+    // Values in every block minus one, two bytes each
+    const uint8_t *blockLength;
+    size_t blockLengthSize;
+    // Block and offset in it of every span-th value, six bytes each
+    const uint8_t *sparseIndex;
+    size_t sparseIndexSize;
+    const uint8_t *data;
+    // Smallest code of every length, left aligned
+    std::vector<uint64_t> base64;
+    // Values a symbol stands for minus one
+    std::vector<int> symlen;
+    // Pieces in the order they're numbered, in the file's piece codes
+    int pieces[TB_MAX_PIECES];
+    uint64_t groupIndex[TB_MAX_PIECES + 1];
+    int groupLength[TB_MAX_PIECES + 1];
+    // Start of the DTZ value map of every result
+    int mapIndex[4];
+};
+
+// A mapped file and the tables read from its header
+struct TableData {
+    const uint8_t *mapping;
+    size_t size;
+    PairsData items[2][4];
+    // Values the DTZ tables store indices of
+    const uint8_t *dtzMap;
+};
+
+struct TableFile {
+    std::string path;
+    std::atomic<TableData *> data;
+    // Probes reading the mapping right now, it's only unmapped when there are none
+    std::atomic<int> readers;
+    std::atomic<uint64_t> lastUse;
+    // Missing or damaged, it isn't tried again
+    std::atomic<bool> failed;
+};
+
+struct Material {
+    // Signatures with the first side of the file name as white and with the colors swapped
+    uint64_t key;
+    uint64_t key2;
+    int pieceCount;
+    bool hasPawns;
+    // Some piece other than a king that only one side has one of, the leading group then takes three pieces
+    bool hasUniquePieces;
+    // Pawns of the side whose pawns lead and of the other side, the one with fewer leads
+    int pawnCount[2];
+    TableFile wdl;
+    TableFile dtz;
+};
+
+// Counts of the non-king pieces, four bits for each color and type
+static uint64_t materialSignature(const int counts[2][5]) {
+    uint64_t signature = 0;
+    for(int c = 0; c < 2; c++)
+        for(int t = PAWN; t < KING; t++)
+            signature |= (uint64_t)counts[c][t] << (4 * (c * 5 + t));
+    return signature;
+}
+
+static uint64_t positionSignature(const Position &pos) {
+    int counts[2][5];
+    for(int c = 0; c < 2; c++)
+        for(int t = PAWN; t < KING; t++)
+            counts[c][t] = popCount(pos.getPieces((color)c, (type)t));
+    return materialSignature(counts);
+}
+
+// Names like KRPvKN, the side before the v is white
+static bool parseMaterial(const std::string &name, int counts[2][5]) {
+    memset(counts, 0, sizeof(int) * 10);
+    size_t split = name.find('v');
+    if(split == std::string::npos || name[0] != 'K' || split + 1 >= name.size() || name[split + 1] != 'K')
+        return false;
+    for(size_t i = 0; i < name.size(); i++)
+    {
+        if(i == 0 || i == split || i == split + 1)
+            continue;
+        const char *letters = "PNBRQ";
+        const char *letter = strchr(letters, name[i]);
+        if(!letter || !*letter)
+            return false;
+        counts[i < split ? WHITE : BLACK][letter - letters]++;
+    }
+    return true;
+}
+
+// Piece codes of the files: white pawn to king 1 to 6, black 9 to 14
+static int tbPiece(int piece) {
+    return (pieceColor(piece) == WHITE ? 0 : 8) + pieceType(piece) + 1;
+}
+
+// Registry keyed by both signatures of every material, only changed by tbInit()
+static std::vector<std::unique_ptr<Material>> materials;
+static std::unordered_map<uint64_t, Material *> tables;
+static int maxPieces = 0;
+static std::atomic<uint32_t> registryGeneration(1);
+
+static std::mutex mapMutex;
+static size_t memoryLimit = SIZE_MAX;
+static std::atomic<uint64_t> useClock(0);
+static std::atomic<uint64_t> statProbes(0), statCacheHits(0), statTableHits(0), statMaps(0), statUnmaps(0),
+        statMappedBytes(0), statNanoseconds(0);
+
+struct CacheEntry {
+    uint64_t key;
+    uint32_t generation;
+    int8_t wdl;
+};
+
+static thread_local CacheEntry cache[TB_CACHE_SIZE];
+
+// Group lengths from the piece order, then the multiplier of every group from the order they're numbered in
+static void setGroups(const Material &material, PairsData &d, const int order[2], int file) {
+    int n = 0, firstLength = material.hasPawns ? 0 : material.hasUniquePieces ? 3 : 2;
+    d.groupLength[n] = 1;
+    for(int i = 1; i < material.pieceCount; i++)
+        if(--firstLength > 0 || d.pieces[i] == d.pieces[i - 1])
+            d.groupLength[n]++;
+        else
+            d.groupLength[++n] = 1;
+    d.groupLength[++n] = 0;
+
+    // The leading group is numbered at order[0], the other side's pawns at order[1], the rest in between
+    bool bothPawns = material.hasPawns && material.pawnCount[1];
+    int next = bothPawns ? 2 : 1;
+    int freeSquares = 64 - d.groupLength[0] - (bothPawns ? d.groupLength[1] : 0);
+    uint64_t index = 1;
+    for(int k = 0; next < n || k == order[0] || k == order[1]; k++)
+        if(k == order[0])
+        {
+            d.groupIndex[0] = index;
+            index *= material.hasPawns ? leadPawnsSize[d.groupLength[0]][file] : material.hasUniquePieces ? 31332 : 462;
+        }
+        else if(k == order[1])
+        {
+            d.groupIndex[1] = index;
+            index *= binomial[d.groupLength[1]][48 - d.groupLength[0]];
+        }
+        else
+        {
+            d.groupIndex[next] = index;
+            index *= binomial[d.groupLength[next]][freeSquares];
+            freeSquares -= d.groupLength[next++];
+        }
+    d.groupIndex[n] = index;
+    d.size = index;
+}
+
+// Values the symbol stands for minus one, the tree has no cycles so marking it first is enough
+static int symbolLength(PairsData &d, int symbol, std::vector<bool> &visited) {
+    visited[symbol] = true;
+    const uint8_t *lr = d.btree + 3 * symbol;
+    int right = lr[2] << 4 | lr[1] >> 4;
+    if(right == LEAF_SYMBOL)
+        return 0;
+    int left = (lr[1] & 0xF) << 8 | lr[0];
+    if(!visited[left])
+        d.symlen[left] = symbolLength(d, left, visited);
+    if(!visited[right])
+        d.symlen[right] = symbolLength(d, right, visited);
+    return d.symlen[left] + d.symlen[right] + 1;
+}
+
+// Reads the sizes and code tables of one table, nullptr if they run past the end of the file
+static const uint8_t *setSizes(PairsData &d, const uint8_t *data, const uint8_t *end) {
+    d.flags = *data++;
+    if(d.flags & PAIRS_SINGLE_VALUE)
+    {
+        d.numBlocks = 0;
+        d.span = 0;
+        d.blockLengthSize = d.sparseIndexSize = 0;
+        d.minSymLen = *data++;
+        return data;
+    }
+    d.sizeofBlock = 1ULL << data[0];
+    d.span = 1ULL << data[1];
+    d.sparseIndexSize = (size_t)((d.size + d.span - 1) / d.span);
+    int padding = data[2];
+    d.numBlocks = readLe32(data + 3);
+    d.blockLengthSize = d.numBlocks + padding;
+    int maxSymLen = data[7];
+    d.minSymLen = data[8];
+    data += 9;
+    if(d.minSymLen < 1 || maxSymLen < d.minSymLen || maxSymLen > 32)
+        return nullptr;
+    d.lowestSym = data;
+
+    // Longer codes are lower numbers, so the smallest code of a length is half the one of the next longer
+    // length plus the number of symbols of that length
+    d.base64.assign(maxSymLen - d.minSymLen + 1, 0);
+    for(int i = (int)d.base64.size() - 2; i >= 0; i--)
+        d.base64[i] = (d.base64[i + 1] + readLe16(d.lowestSym + 2 * i) - readLe16(d.lowestSym + 2 * (i + 1))) / 2;
+    for(size_t i = 0; i < d.base64.size(); i++)
+        d.base64[i] <<= 64 - i - d.minSymLen;
+    data += 2 * d.base64.size();
+
+    int symbols = readLe16(data);
+    data += 2;
+    d.btree = data;
+    if(data + 3 * symbols > end)
+        return nullptr;
+    for(int s = 0; s < symbols; s++)
+    {
+        const uint8_t *lr = d.btree + 3 * s;
+        int left = (lr[1] & 0xF) << 8 | lr[0], right = lr[2] << 4 | lr[1] >> 4;
+        if(right != LEAF_SYMBOL && (left >= symbols || right >= symbols))
+            return nullptr;
+    }
+    d.symlen.assign(symbols, 0);
+    std::vector<bool> visited(symbols);
+    for(int s = 0; s < symbols; s++)
+        if(!visited[s])
+            d.symlen[s] = symbolLength(d, s, visited);
+    return data + 3 * symbols + (symbols & 1);
+}
+
+// Maps from the stored DTZ values to distances, one for every result
+static const uint8_t *setDtzMap(TableData &table, const uint8_t *data, int files) {
+    table.dtzMap = data;
+    for(int f = 0; f < files; f++)
+    {
+        PairsData &d = table.items[0][f];
+        if(!(d.flags & PAIRS_MAPPED))
+            continue;
+        if(d.flags & PAIRS_WIDE)
+        {
+            data += (uintptr_t)data & 1;
+            for(int i = 0; i < 4; i++)
+            {
+                d.mapIndex[i] = (int)((data - table.dtzMap) / 2 + 1);
+                data += 2 * readLe16(data) + 2;
+            }
+        }
+        else
+            for(int i = 0; i < 4; i++)
+            {
+                d.mapIndex[i] = (int)(data - table.dtzMap + 1);
+                data += *data + 1;
+            }
+    }
+    return data + ((uintptr_t)data & 1);
+}
+
+// Reads the header of a mapped file, false if it doesn't belong to the material or runs past its end
+static bool parseTable(const Material &material, bool dtz, TableData &table) {
+    const uint8_t *data = table.mapping + 4, *end = table.mapping + table.size;
+    if(material.hasPawns != ((*data & TB_HAS_PAWNS) != 0) || (material.key != material.key2) != ((*data & TB_SPLIT) != 0))
+        return false;
+    data++;
+    int sides = !dtz && material.key != material.key2 ? 2 : 1;
+    int files = material.hasPawns ? 4 : 1;
+    bool bothPawns = material.hasPawns && material.pawnCount[1];
+    for(int f = 0; f < files; f++)
+    {
+        int order[2][2] = {{data[0] & 0xF, bothPawns ? data[1] & 0xF : 0xF}, {data[0] >> 4, bothPawns ? data[1] >> 4 : 0xF}};
+        data += 1 + bothPawns;
+        for(int k = 0; k < material.pieceCount; k++, data++)
+            for(int i = 0; i < sides; i++)
+                table.items[i][f].pieces[k] = i ? *data >> 4 : *data & 0xF;
+        for(int i = 0; i < sides; i++)
+            setGroups(material, table.items[i][f], order[i], f);
+    }
+    data += (uintptr_t)data & 1;
+
+    for(int f = 0; f < files; f++)
+        for(int i = 0; i < sides; i++)
+            if(!(data = setSizes(table.items[i][f], data, end)))
+                return false;
+    if(dtz)
+        data = setDtzMap(table, data, files);
+    for(int f = 0; f < files; f++)
+        for(int i = 0; i < sides; i++)
+        {
+            table.items[i][f].sparseIndex = data;
+            data += 6 * table.items[i][f].sparseIndexSize;
+        }
+    for(int f = 0; f < files; f++)
+        for(int i = 0; i < sides; i++)
+        {
+            table.items[i][f].blockLength = data;
+            data += 2 * table.items[i][f].blockLengthSize;
+        }
+    for(int f = 0; f < files; f++)
+        for(int i = 0; i < sides; i++)
+        {
+            data = table.mapping + ((data - table.mapping + 63) & ~63);
+            table.items[i][f].data = data;
+            data += table.items[i][f].numBlocks * table.items[i][f].sizeofBlock;
+        }
+    return data <= end;
+}
+
+// Adds the material with the counts' white as the first side of the file names
+static Material *registerMaterial(int counts[2][5]) {
+    materials.emplace_back(new Material());
+    Material *material = materials.back().get();
+    material->key = materialSignature(counts);
+    std::swap(counts[WHITE], counts[BLACK]);
+    material->key2 = materialSignature(counts);
+    std::swap(counts[WHITE], counts[BLACK]);
+    material->pieceCount = 2;
+    material->hasUniquePieces = false;
+    for(int c = 0; c < 2; c++)
+        for(int t = PAWN; t < KING; t++)
+        {
+            material->pieceCount += counts[c][t];
+            if(counts[c][t] == 1)
+                material->hasUniquePieces = true;
+        }
+    material->hasPawns = counts[WHITE][PAWN] || counts[BLACK][PAWN];
+    bool whiteLeads = !counts[BLACK][PAWN] || (counts[WHITE][PAWN] && counts[BLACK][PAWN] >= counts[WHITE][PAWN]);
+    material->pawnCount[0] = counts[whiteLeads ? WHITE : BLACK][PAWN];
+    material->pawnCount[1] = counts[whiteLeads ? BLACK : WHITE][PAWN];
+    for(TableFile *file : {&material->wdl, &material->dtz})
+    {
+        file->data = nullptr;
+        file->readers = 0;
+        file->lastUse = 0;
+        file->failed = false;
+    }
+    tables[material->key] = material;
+    tables[material->key2] = material;
+    return material;
+}
+
+int tbInit(const std::string &directory) {
+    {
+        std::lock_guard<std::mutex> lock(mapMutex);
+        for(auto &material : materials)
+            for(TableFile *file : {&material->wdl, &material->dtz})
+            {
+                TableData *table = file->data.load();
+                if(table)
+                {
+                    munmap((void *)table->mapping, table->size);
+                    delete table;
+                }
+            }
+        materials.clear();
+        tables.clear();
+        maxPieces = 0;
+        statMappedBytes = 0;
+    }
+    registryGeneration++;
+
+    DIR *dir = opendir(directory.c_str());
+    if(!dir)
+        return 0;
+    int count = 0;
+    while(dirent *entry = readdir(dir))
+    {
+        std::string file = entry->d_name;
+        if(file.size() < 6 || (file.compare(file.size() - 5, 5, ".rtbw") != 0 && file.compare(file.size() - 5, 5, ".rtbz") != 0))
+            continue;
+        int counts[2][5];
+        if(!parseMaterial(file.substr(0, file.size() - 5), counts))
+            continue;
+        auto found = tables.find(materialSignature(counts));
+        Material *material = found != tables.end() ? found->second : registerMaterial(counts);
+        if(material->pieceCount > TB_MAX_PIECES)
+            continue;
+        bool wdl = file[file.size() - 1] == 'w';
+        (wdl ? material->wdl : material->dtz).path = directory + "/" + file;
+        if(wdl)
+        {
+            maxPieces = std::max(maxPieces, material->pieceCount);
+            count++;
+        }
+    }
+    closedir(dir);
+    return count;
+}
+
+int tbMaxPieces() {
+    return maxPieces;
+}
+
+void tbSetMemoryLimit(size_t megabytes) {
+    std::lock_guard<std::mutex> lock(mapMutex);
+    memoryLimit = megabytes ? megabytes << 20 : SIZE_MAX;
+}
+
+// Takes the mapping away unless a probe is reading it, a probe that comes later finds it gone and maps it again
+static bool tryUnmap(TableFile &file) {
+    TableData *table = file.data.exchange(nullptr);
+    if(!table)
+        return false;
+    if(file.readers.load())
+    {
+        file.data = table;
+        return false;
+    }
+    munmap((void *)table->mapping, table->size);
+    statMappedBytes -= table->size;
+    statUnmaps++;
+    delete table;
+    return true;
+}
+
+// Called with the map mutex held
+static TableData *mapTable(const Material &material, TableFile &file, bool dtz) {
+    int fd = open(file.path.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+        file.failed = true;
+        return nullptr;
+    }
+    struct stat info;
+    if(fstat(fd, &info) != 0 || info.st_size % 64 != 16)
+    {
+        close(fd);
+        file.failed = true;
+        return nullptr;
+    }
+    void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(mapping == MAP_FAILED)
+        return nullptr;
+    madvise(mapping, info.st_size, MADV_RANDOM);
+    std::unique_ptr<TableData> table(new TableData());
+    table->mapping = (const uint8_t *)mapping;
+    table->size = info.st_size;
+    if(memcmp(mapping, dtz ? DTZ_MAGIC : WDL_MAGIC, 4) != 0 || !parseTable(material, dtz, *table))
+    {
+        munmap(mapping, info.st_size);
+        file.failed = true;
+        return nullptr;
+    }
+    file.data = table.get();
+    statMappedBytes += table->size;
+    statMaps++;
+
+    // Over the limit the least recently probed tables go first
+    while(statMappedBytes > memoryLimit)
+    {
+        TableFile *oldest = nullptr;
+        for(auto &other : materials)
+            for(TableFile *candidate : {&other->wdl, &other->dtz})
+                if(candidate != &file && candidate->data.load() && (!oldest || candidate->lastUse < oldest->lastUse))
+                    oldest = candidate;
+        if(!oldest || !tryUnmap(*oldest))
+            break;
+    }
+    return table.release();
+}
+
+// Value stored at the index: the block is found through the sparse index, then the symbols of the block are
+// decoded until the one covering the index, and that symbol is split into its pairs down to a single value
+static int decompressPairs(const PairsData &d, uint64_t index) {
+    if(d.flags & PAIRS_SINGLE_VALUE)
+        return d.minSymLen;
+
+    // Every span-th entry of the sparse index points to the middle of its span
+    uint32_t k = (uint32_t)(index / d.span);
+    uint32_t block = readLe32(d.sparseIndex + 6 * k);
+    int offset = readLe16(d.sparseIndex + 6 * k + 4);
+    offset += (int)(index % d.span) - (int)(d.span / 2);
+    while(offset < 0)
+        offset += readLe16(d.blockLength + 2 * --block) + 1;
+    while(offset > readLe16(d.blockLength + 2 * block))
+        offset -= readLe16(d.blockLength + 2 * block++) + 1;
+
+    const uint8_t *ptr = d.data + block * d.sizeofBlock;
+    uint64_t buffer = (uint64_t)readBe32(ptr) << 32 | readBe32(ptr + 4);
+    ptr += 8;
+    int bufferBits = 64;
+    int symbol;
+    while(true)
+    {
+        // Codes of a length are consecutive numbers, the length is the first whose smallest code fits
+        int length = 0;
+        while(buffer < d.base64[length])
+            length++;
+        symbol = (int)((buffer - d.base64[length]) >> (64 - length - d.minSymLen));
+        symbol += readLe16(d.lowestSym + 2 * length);
+        if(offset < d.symlen[symbol] + 1)
+            break;
+        offset -= d.symlen[symbol] + 1;
+        length += d.minSymLen;
+        buffer <<= length;
+        bufferBits -= length;
+        if(bufferBits <= 32)
+        {
+            bufferBits += 32;
+            buffer |= (uint64_t)readBe32(ptr) << (64 - bufferBits);
+            ptr += 4;
+        }
+    }
+
+    // The halves of a pair are adjacent, the offset tells which one holds the value
+    while(d.symlen[symbol])
+    {
+        const uint8_t *lr = d.btree + 3 * symbol;
+        int left = (lr[1] & 0xF) << 8 | lr[0];
+        if(offset < d.symlen[left] + 1)
+            symbol = left;
+        else
+        {
+            offset -= d.symlen[left] + 1;
+            symbol = lr[2] << 4 | lr[1] >> 4;
+        }
+    }
+    const uint8_t *lr = d.btree + 3 * symbol;
+    return (lr[1] & 0xF) << 8 | lr[0];
+}
+
+// Distance to zeroing in plies from a stored DTZ value
+static int dtzScore(const TableData &table, int file, int value, int wdl) {
+    static const int resultMap[] = {1, 3, 0, 2, 0};
+    const PairsData &d = table.items[0][file];
+    if(d.flags & PAIRS_MAPPED)
+    {
+        int index = d.mapIndex[resultMap[wdl + 2]] + value;
+        value = d.flags & PAIRS_WIDE ? readLe16(table.dtzMap + 2 * index) : table.dtzMap[index];
+    }
+    // Tables count in moves unless they say otherwise, cursed and blessed results always
+    if((wdl == TB_WIN && !(d.flags & PAIRS_WIN_PLIES)) || (wdl == TB_LOSS && !(d.flags & PAIRS_LOSS_PLIES))
+       || wdl == TB_CURSED_WIN || wdl == TB_BLESSED_LOSS)
+        value *= 2;
+    return value + 1;
+}
+
+// Numbers the placement the way the table was built: the table of its side to move and leading pawn file and
+// the index in it, false if it's a DTZ table holding the other side to move. The tables hold the stronger side
+// as white, positions of the other color and black to move in a symmetric table are looked up mirrored
+static bool locate(const Material &material, const TableData &table, bool dtz, const Position &pos, const PairsData *&pairs, int &file, uint64_t &index) {
+    int squares[TB_MAX_PIECES], pieces[TB_MAX_PIECES];
+    int size = 0, leadPawnsCount = 0;
+    file = 0;
+    Bitboard leadPawns = 0;
+
+    bool symmetricBlackToMove = material.key == material.key2 && pos.getSideToMove() == BLACK;
+    bool blackStronger = positionSignature(pos) != material.key;
+    bool flip = symmetricBlackToMove || blackStronger;
+    int flipColor = flip ? 8 : 0, flipSquares = flip ? 56 : 0;
+    // 0 with white to move in the table's colors
+    int stm = flip ^ (pos.getSideToMove() == BLACK);
+
+    // The pawns of the leading color come first, the one nearest the edge and the second rank picks the table
+    if(material.hasPawns)
+    {
+        int leadPiece = table.items[0][0].pieces[0] ^ flipColor;
+        Bitboard b = leadPawns = pos.getPieces(leadPiece & 8 ? BLACK : WHITE, PAWN);
+        while(b)
+            squares[size++] = popLsb(b) ^ flipSquares;
+        leadPawnsCount = size;
+        std::swap(squares[0], *std::max_element(squares, squares + leadPawnsCount, [](int s1, int s2) {
+            return mapPawns[s1] < mapPawns[s2];
+        }));
+        file = std::min(fileOf(squares[0]), 7 - fileOf(squares[0]));
+    }
+
+    // DTZ tables only hold one side to move
+    if(dtz && (table.items[0][file].flags & PAIRS_STM) != stm && !(material.key == material.key2 && !material.hasPawns))
+        return false;
+
+    Bitboard b = pos.getOccupancy() ^ leadPawns;
+    while(b)
+    {
+        int square = popLsb(b);
+        squares[size] = square ^ flipSquares;
+        pieces[size++] = tbPiece(pos.pieceOn(square)) ^ flipColor;
+    }
+    const PairsData &d = table.items[dtz ? 0 : stm][file];
+    pairs = &d;
+
+    // Same order as the table's pieces
+    for(int i = leadPawnsCount; i < size - 1; i++)
+        for(int j = i + 1; j < size; j++)
+            if(d.pieces[i] == pieces[j])
+            {
+                std::swap(pieces[i], pieces[j]);
+                std::swap(squares[i], squares[j]);
+                break;
+            }
+
+    // The leading piece goes to the a-d files
+    if(fileOf(squares[0]) > 3)
+        for(int i = 0; i < size; i++)
+            squares[i] ^= 7;
+
+    if(material.hasPawns)
+    {
+        index = leadPawnIndex[leadPawnsCount][squares[0]];
+        std::stable_sort(squares + 1, squares + leadPawnsCount, [](int s1, int s2) {
+            return mapPawns[s1] < mapPawns[s2];
+        });
+        for(int i = 1; i < leadPawnsCount; i++)
+            index += binomial[i][mapPawns[squares[i]]];
+    }
+    else
+    {
+        // Without pawns also to the first four ranks, then the first leading piece off the diagonal below it
+        if(rankOf(squares[0]) > 3)
+            for(int i = 0; i < size; i++)
+                squares[i] ^= 56;
+        for(int i = 0; i < d.groupLength[0]; i++)
+        {
+            if(!offDiagonal(squares[i]))
+                continue;
+            if(offDiagonal(squares[i]) > 0)
+                for(int j = i; j < size; j++)
+                    squares[j] = ((squares[j] >> 3) | (squares[j] << 3)) & 63;
+            break;
+        }
+
+        if(material.hasUniquePieces)
+        {
+            // Three pieces together: the first in the b1-d1-d3 triangle, or on the diagonal with the next one
+            // off it, and so on
+            int adjust1 = squares[1] > squares[0];
+            int adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+            if(offDiagonal(squares[0]))
+                index = (mapA1D1D4[squares[0]] * 63 + (squares[1] - adjust1)) * 62 + squares[2] - adjust2;
+            else if(offDiagonal(squares[1]))
+                index = (6 * 63 + rankOf(squares[0]) * 28 + mapB1H1H7[squares[1]]) * 62 + squares[2] - adjust2;
+            else if(offDiagonal(squares[2]))
+                index = 6 * 63 * 62 + 4 * 28 * 62 + rankOf(squares[0]) * 7 * 28 + (rankOf(squares[1]) - adjust1) * 28
+                        + mapB1H1H7[squares[2]];
+            else
+                index = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 + rankOf(squares[0]) * 7 * 6 + (rankOf(squares[1]) - adjust1) * 6
+                        + (rankOf(squares[2]) - adjust2);
+        }
+        else
+            index = mapKK[mapA1D1D4[squares[0]]][squares[1]];
+    }
+
+    // Every further group as a combination of the squares the earlier groups left free
+    index *= d.groupIndex[0];
+    int *groupSquares = squares + d.groupLength[0];
+    bool remainingPawns = material.hasPawns && material.pawnCount[1];
+    for(int next = 1; d.groupLength[next]; next++)
+    {
+        std::stable_sort(groupSquares, groupSquares + d.groupLength[next]);
+        uint64_t n = 0;
+        for(int i = 0; i < d.groupLength[next]; i++)
+        {
+            int adjust = 0;
+            for(int *s = squares; s < groupSquares; s++)
+                adjust += groupSquares[i] > *s;
+            n += binomial[i + 1][groupSquares[i] - adjust - 8 * remainingPawns];
+        }
+        remainingPawns = false;
+        index += n * d.groupIndex[next];
+        groupSquares += d.groupLength[next];
+    }
+    return true;
+}
+
+static int readTable(const Material &material, const TableData &table, bool dtz, const Position &pos, int wdl, probeState &state) {
+    const PairsData *d;
+    int file;
+    uint64_t index;
+    if(!locate(material, table, dtz, pos, d, file, index))
+    {
+        state = PROBE_CHANGE_STM;
+        return 0;
+    }
+    if(index >= d->size)
+    {
+        state = PROBE_FAIL;
+        return 0;
+    }
+    int value = decompressPairs(*d, index);
+    return dtz ? dtzScore(table, file, value, wdl) : value - 2;
+}
+
+// WDL, or the distance to zeroing given the result, from the position's own table
+static int probeTable(const Position &pos, bool dtz, int wdl, probeState &state) {
+    if(popCount(pos.getOccupancy()) == 2)
+        return TB_DRAW;
+    auto found = tables.find(positionSignature(pos));
+    if(found == tables.end())
+    {
+        state = PROBE_FAIL;
+        return 0;
+    }
+    Material &material = *found->second;
+    TableFile &file = dtz ? material.dtz : material.wdl;
+    if(file.path.empty() || file.failed)
+    {
+        state = PROBE_FAIL;
+        return 0;
+    }
+
+    file.readers++;
+    TableData *table = file.data.load();
+    if(!table)
+    {
+        std::lock_guard<std::mutex> lock(mapMutex);
+        table = file.data.load();
+        if(!table && !file.failed)
+            table = mapTable(material, file, dtz);
+    }
+    int value = 0;
+    if(table)
+        value = readTable(material, *table, dtz, pos, wdl, state);
+    else
+        state = PROBE_FAIL;
+    file.lastUse = ++useClock;
+    file.readers--;
+    return value;
+}
+
+// Tables may store anything for positions with a winning capture and a loss for drawn ones with a drawing
+// capture, whichever compresses better, so the captures are played out and the best of them and the table
+// taken. Checking pawn moves as well tells whether the DTZ table can be trusted
+static int searchWdl(Position &pos, bool zeroingMoves, probeState &state) {
+    MoveList moves;
+    generateMoves(pos, moves);
+    int best = TB_LOSS, tried = 0;
+    for(Move m : moves)
+    {
+        if(!isCapture(m) && (!zeroingMoves || pieceType(pos.pieceOn(moveFrom(m))) != PAWN))
+            continue;
+        tried++;
+        pos.makeMove(m);
+        int value = -searchWdl(pos, false, state);
+        pos.unmakeMove();
+        if(state == PROBE_FAIL)
+            return TB_DRAW;
+        if(value > best)
+        {
+            best = value;
+            if(value >= TB_WIN)
+            {
+                state = PROBE_ZEROING_BEST_MOVE;
+                return value;
+            }
+        }
+    }
+
+    // With every move tried the table isn't needed, it wouldn't know about en passant anyway
+    bool noMoreMoves = tried && tried == moves.size();
+    int value = best;
+    if(!noMoreMoves)
+    {
+        value = probeTable(pos, false, TB_DRAW, state);
+        if(state == PROBE_FAIL)
+            return TB_DRAW;
+    }
+    if(best >= value)
+    {
+        state = best > TB_DRAW || noMoreMoves ? PROBE_ZEROING_BEST_MOVE : PROBE_OK;
+        return best;
+    }
+    state = PROBE_OK;
+    return value;
+}
+
+static int sign(int value) {
+    return (value > 0) - (value < 0);
+}
+
+// Distance before a capture or pawn move with the result
+static int dtzBeforeZeroing(int wdl) {
+    switch(wdl)
+    {
+        case TB_WIN:
+            return 1;
+        case TB_CURSED_WIN:
+            return 101;
+        case TB_BLESSED_LOSS:
+            return -101;
+        case TB_LOSS:
+            return -1;
+        default:
+            return 0;
+    }
+}
+
+static int probeDtz(Position &pos, probeState &state) {
+    state = PROBE_OK;
+    int wdl = searchWdl(pos, true, state);
+    if(state == PROBE_FAIL || wdl == TB_DRAW)
+        return 0;
+    if(state == PROBE_ZEROING_BEST_MOVE)
+        return dtzBeforeZeroing(wdl);
+    int dtz = probeTable(pos, true, wdl, state);
+    if(state == PROBE_FAIL)
+        return 0;
+    if(state != PROBE_CHANGE_STM)
+        return (dtz + 100 * (wdl == TB_BLESSED_LOSS || wdl == TB_CURSED_WIN)) * sign(wdl);
+
+    // The table holds the other side to move, one ply is searched for the move with the best distance
+    int minDtz = 0xFFFF;
+    MoveList moves;
+    generateMoves(pos, moves);
+    for(Move m : moves)
+    {
+        bool zeroing = isCapture(m) || pieceType(pos.pieceOn(moveFrom(m))) == PAWN;
+        pos.makeMove(m);
+        dtz = zeroing ? -dtzBeforeZeroing(searchWdl(pos, false, state)) : -probeDtz(pos, state);
+        if(dtz == 1 && pos.inCheck())
+        {
+            MoveList replies;
+            generateMoves(pos, replies);
+            if(!replies.size())
+                minDtz = 1;
+        }
+        if(!zeroing)
+            dtz += sign(dtz);
+        if(dtz < minDtz && sign(dtz) == sign(wdl))
+            minDtz = dtz;
+        pos.unmakeMove();
+        if(state == PROBE_FAIL)
+            return 0;
+    }
+    return minDtz == 0xFFFF ? -1 : minDtz;
+}
+
+// Positions the tables don't hold, or too close to the end of the move stack for the moves a probe tries
+static bool probeable(const Position &pos) {
+    return popCount(pos.getOccupancy()) <= maxPieces && !pos.getCastlingRights() && pos.getEpSquare() == NO_SQUARE
+           && pos.getGamePly() < MAX_GAME_PLY - 2 * TB_MAX_PIECES;
+}
+
+bool tbProbeWdl(Position &pos, int &wdl) {
+    if(!probeable(pos))
+        return false;
+    auto start = std::chrono::steady_clock::now();
+    statProbes++;
+    uint32_t generation = registryGeneration.load(std::memory_order_relaxed);
+    CacheEntry &entry = cache[pos.getKey() & (TB_CACHE_SIZE - 1)];
+    bool found;
+    if(entry.key == pos.getKey() && entry.generation == generation)
+    {
+        wdl = entry.wdl;
+        found = true;
+        statCacheHits++;
+    }
+    else
+    {
+        probeState state = PROBE_OK;
+        wdl = searchWdl(pos, false, state);
+        found = state != PROBE_FAIL;
+        if(found)
+        {
+            entry = {pos.getKey(), generation, (int8_t)wdl};
+            statTableHits++;
+        }
+    }
+    statNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    return found;
+}
+
+bool tbProbe(Position &pos, TablebaseResult &result) {
+    if(!tbProbeWdl(pos, result.wdl))
+        return false;
+    probeState state;
+    result.dtz = probeDtz(pos, state);
+    return state != PROBE_FAIL;
+}
+
+bool tbBestMoves(Position &pos, MoveList &best, TablebaseResult &result) {
+    best.count = 0;
+    if(!tbProbeWdl(pos, result.wdl))
+        return false;
+    // Without moves the side to move is mated or stalemated
+    result.dtz = result.wdl < 0 ? -1 : 0;
+    MoveList moves;
+    generateMoves(pos, moves);
+    int distances[MAX_MOVES];
+    int bestRank = INT_MIN;
+    for(int i = 0; i < moves.size(); i++)
+    {
+        Move m = moves.moves[i];
+        bool zeroing = isCapture(m) || pieceType(pos.pieceOn(moveFrom(m))) == PAWN;
+        probeState state = PROBE_OK;
+        pos.makeMove(m);
+        // Seen from the side to move, one ply further from zeroing unless the move zeroes
+        int dtz;
+        if(zeroing)
+            dtz = dtzBeforeZeroing(-searchWdl(pos, false, state));
+        else
+        {
+            dtz = -probeDtz(pos, state);
+            dtz += sign(dtz);
+        }
+        if(dtz == 2 && pos.inCheck())
+        {
+            MoveList replies;
+            generateMoves(pos, replies);
+            if(!replies.size())
+                dtz = 1;
+        }
+        pos.unmakeMove();
+        if(state == PROBE_FAIL)
+            return false;
+        distances[i] = dtz;
+        // Wins as fast, losses as slow as they go
+        int rank = dtz > 0 ? TB_MAX_DTZ - dtz : dtz < 0 ? -TB_MAX_DTZ - dtz : 0;
+        if(rank > bestRank)
+        {
+            bestRank = rank;
+            result.dtz = dtz;
+        }
+    }
+    for(int i = 0; i < moves.size(); i++)
+        if(distances[i] == result.dtz)
+            best.add(moves.moves[i]);
+    return true;
+}
+
+TablebaseStats tbStats() {
+    TablebaseStats stats;
+    stats.probes = statProbes;
+    stats.cacheHits = statCacheHits;
+    stats.tableHits = statTableHits;
+    stats.maps = statMaps;
+    stats.unmaps = statUnmaps;
+    stats.mappedBytes = statMappedBytes;
+    stats.nanoseconds = statNanoseconds;
+    return stats;
+}
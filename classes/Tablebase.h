@@ -0,0 +1,68 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#ifndef RG_3D_SAH_TABLEBASE_H
+#define RG_3D_SAH_TABLEBASE_H
+
+#include <string>
+
+#include "Position.h"
+#include "MoveGen.h"
+
+// Endgame tablebases in the Syzygy format: a .rtbw file per material combination, named like KRvK.rtbw, holds
+// win, draw or loss of every position and a .rtbz file the distance to the next capture or pawn move that
+// keeps the result. Files are found by tbInit() and only mapped when first probed. Positions with castling
+// rights or an en passant capture aren't probed
+
+// The largest published set
+const int TB_MAX_PIECES = 7;
+
+// Results from the side to move, the cursed and blessed ones are decided by the fifty move rule
+enum tbWdl {
+    TB_LOSS = -2,
+    // Lost, but the fifty move rule saves it
+    TB_BLESSED_LOSS = -1,
+    TB_DRAW = 0,
+    // Won, but the fifty move rule lets the other side escape
+    TB_CURSED_WIN = 1,
+    TB_WIN = 2
+};
+
+struct TablebaseResult {
+    int wdl;
+    // Plies to the capture or pawn move that keeps a win, negative for a loss, 0 for a draw. Above 100 the
+    // win is a cursed one, -1 means the side to move is mated or has to make a losing capture or pawn move
+    int dtz;
+};
+
+struct TablebaseStats {
+    uint64_t probes;
+    uint64_t cacheHits;
+    uint64_t tableHits;
+    uint64_t maps;
+    uint64_t unmaps;
+    uint64_t mappedBytes;
+    // Summed over every probe, cache hits included
+    uint64_t nanoseconds;
+};
+
+// Registers the tables in the directory without opening any of them, returns how many material combinations
+// have a WDL table. Not safe while other threads probe
+int tbInit(const std::string &directory);
+// Most pieces any registered table covers, 0 without tables
+int tbMaxPieces();
+// Mapped tables beyond this size are unmapped least recently used first, unless a probe is reading them
+void tbSetMemoryLimit(size_t megabytes);
+
+// Win, draw or loss of the position, false if no table covers it. Captures are tried on the board, so the
+// position is changed during the probe and left as it was. Safe from any number of threads, every thread
+// keeps a cache of recent results
+bool tbProbeWdl(Position &pos, int &wdl);
+// Result and distance to zeroing of the position, false unless both of its tables are there
+bool tbProbe(Position &pos, TablebaseResult &result);
+// Moves keeping the best result in the fewest plies to zeroing, for a loss the ones putting it off the longest
+bool tbBestMoves(Position &pos, MoveList &best, TablebaseResult &result);
+TablebaseStats tbStats();
+
+#endif //RG_3D_SAH_TABLEBASE_H
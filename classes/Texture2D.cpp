@@ -6,51 +6,99 @@
 
 #include <stb_image.h>
 #include <iostream>
+#include <mutex>
 
 #include "error.h"
+#include "MemoryTracker.h"
+#include "GlState.h"
+#include "Profiler.h"
 
-Texture2D::Texture2D(const std::string &texturePath, texType type, GLenum filtering, GLenum sampling) {
+// The vertical flip flag of stb_image is global, images decoded on other threads must not race on it
+static std::mutex decodeMutex;
+
+bool ImageData::load(const std::string &path, ImageData &image) {
+    PROFILE_SCOPE("decode image");
+    std::lock_guard<std::mutex> lock(decodeMutex);
+    stbi_set_flip_vertically_on_load(true);
+    image.data = stbi_load(path.c_str(), &image.width, &image.height, &image.nChannels, 0);
+    return image.data != nullptr;
+}
+
+void ImageData::free() {
+    if(data != nullptr)
+        stbi_image_free(data);
+    data = nullptr;
+}
+
+Texture2D::Texture2D(texType type, GLenum filtering, GLenum sampling) {
     tex_type = type;
     glGenTextures(1, &tex_id);
-    glBindTexture(GL_TEXTURE_2D, tex_id);
+    stateBindTexture(GL_TEXTURE_2D, tex_id);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, filtering);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, filtering);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, sampling);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, sampling);
+}
 
-    int width, height, nChannels;
-    stbi_set_flip_vertically_on_load(true);
-    unsigned char *data = stbi_load(texturePath.c_str(), &width, &height, &nChannels, 0);
-    CHECK_ERROR(data != nullptr, "Failed to load image from file");
+Texture2D::Texture2D(const std::string &texturePath, texType type, GLenum filtering, GLenum sampling)
+    : Texture2D(type, filtering, sampling) {
+    ImageData image;
+    CHECK_ERROR(ImageData::load(texturePath, image), "Failed to load image from file");
+    CHECK_ERROR(upload(image, texturePath), "Number of channels not supported");
+    image.free();
+}
+
+Texture2D *Texture2D::create(const ImageData &image, const std::string &owner, texType type, GLenum filtering, GLenum sampling) {
+    if(image.data == nullptr)
+        return nullptr;
+    Texture2D *texture = new Texture2D(type, filtering, sampling);
+    if(!texture->upload(image, owner))
+    {
+        texture->del();
+        delete texture;
+        return nullptr;
+    }
+    return texture;
+}
 
-    switch(nChannels)
+bool Texture2D::upload(const ImageData &image, const std::string &owner) const {
+    PROFILE_SCOPE("upload texture");
+    GLenum format;
+    switch(image.nChannels)
     {
         case 1:
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, data);
+            format = GL_RED;
             break;
         case 3:
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+            format = GL_RGB;
             break;
         case 4:
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+            format = GL_RGBA;
             break;
         default:
-            CHECK_ERROR(0, "Number of channels not supported");
-            break;
+            return false;
     }
+    stateBindTexture(GL_TEXTURE_2D, tex_id);
+    memoryTexImage2D(GL_TEXTURE_2D, tex_id, format, image.width, image.height, format, GL_UNSIGNED_BYTE, image.data, true, TEXTURES, owner);
     glGenerateMipmap(GL_TEXTURE_2D);
-    stbi_image_free(data);
+    return true;
+}
+
+bool Texture2D::reload(const ImageData &image) const {
+    if(image.data == nullptr)
+        return false;
+    return upload(image, "");
 }
 
 void Texture2D::active(GLenum e) const {
-    glActiveTexture(e);
-    glBindTexture(GL_TEXTURE_2D, tex_id);
+    stateActiveTexture(e);
+    stateBindTexture(GL_TEXTURE_2D, tex_id);
 }
 
 void Texture2D::del() {
-    glDeleteTextures(1, &tex_id);
+    memoryDeleteTextures(1, &tex_id);
     tex_id = -1;
 }
 
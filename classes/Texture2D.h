@@ -15,13 +15,31 @@ enum texType {
     HEIGHT
 };
 
+// Decoded image kept on the CPU until it gets uploaded, decoding doesn't need a GL context
+struct ImageData {
+    int width = 0;
+    int height = 0;
+    int nChannels = 0;
+    unsigned char *data = nullptr;
+    static bool load(const std::string &path, ImageData &image);
+    void free();
+};
+
 class Texture2D {
     unsigned tex_id;
     texType tex_type;
+    // Creates the GL object with its parameters set but no image yet
+    Texture2D(texType type, GLenum filtering, GLenum sampling);
+    // An empty owner keeps the one the texture was created with
+    bool upload(const ImageData &image, const std::string &owner) const;
 public:
     Texture2D(const std::string &texturePath, texType type, GLenum filtering, GLenum sampling);
+    // Uploads an image decoded beforehand, nullptr instead of exiting if the image can't be used
+    static Texture2D *create(const ImageData &image, const std::string &owner, texType type, GLenum filtering, GLenum sampling);
     void active(GLenum e) const;
     void del();
+    // Replaces the image of this texture in place, so every copy sharing the GL object sees the new one
+    bool reload(const ImageData &image) const;
 
     texType getTextureType() const;
     std::string getTextureTypeString() const;
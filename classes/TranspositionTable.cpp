@@ -0,0 +1,186 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#include "TranspositionTable.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <sys/mman.h>
+
+#include "error.h"
+
+const uint64_t PAYLOAD_MASK = (1ULL << 48) - 1;
+const int DEPTH_SHIFT = 48;
+const int BOUND_SHIFT = 56;
+const int GENERATION_SHIFT = 58;
+const int GENERATION_COUNT = 64;
+// Transparent huge pages are this large, a table aligned to them can be backed by them entirely
+const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+static int entryDepth(uint64_t data) {
+    return (int)((data >> DEPTH_SHIFT) & 0xFF);
+}
+
+static int entryBound(uint64_t data) {
+    return (int)((data >> BOUND_SHIFT) & 3);
+}
+
+static int entryGeneration(uint64_t data) {
+    return (int)(data >> GENERATION_SHIFT);
+}
+
+TranspositionTable::TranspositionTable(size_t megabytes)
+        : buckets{nullptr}, bucketCount{0}, allocatedBytes{0}, generation{0} {
+    resize(megabytes);
+}
+
+TranspositionTable::~TranspositionTable() {
+    release();
+}
+
+void TranspositionTable::release() {
+    if(buckets)
+        std::free(buckets);
+    buckets = nullptr;
+    bucketCount = 0;
+    allocatedBytes = 0;
+}
+
+void TranspositionTable::resize(size_t megabytes) {
+    release();
+    size_t bytes = std::max<size_t>(megabytes, 1) * 1024 * 1024;
+    bucketCount = bytes / sizeof(Bucket);
+    allocatedBytes = bucketCount * sizeof(Bucket);
+
+    size_t alignment = allocatedBytes >= HUGE_PAGE_SIZE ? HUGE_PAGE_SIZE : 64;
+    void *memory = nullptr;
+    CHECK_ERROR(posix_memalign(&memory, alignment, allocatedBytes) == 0, "Failed to allocate " << megabytes << " MB for the transposition table");
+#ifdef MADV_HUGEPAGE
+    // Probes land all over the table, huge pages spare the TLB most of the misses. Only a hint, a kernel
+    // without them just ignores it
+    if(alignment == HUGE_PAGE_SIZE)
+        madvise(memory, allocatedBytes, MADV_HUGEPAGE);
+#endif
+    buckets = (Bucket *)memory;
+    clear();
+}
+
+void TranspositionTable::clear() {
+    int threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    // Splitting a small table isn't worth starting threads for
+    if(allocatedBytes < 64 * 1024 * 1024)
+        threads = 1;
+    size_t chunk = (bucketCount + threads - 1) / threads;
+    auto zero = [this, chunk](int i) {
+        size_t begin = std::min(bucketCount, i * chunk), end = std::min(bucketCount, begin + chunk);
+        std::memset((void *)(buckets + begin), 0, (end - begin) * sizeof(Bucket));
+    };
+    std::vector<std::thread> pool;
+    for(int i = 1; i < threads; i++)
+        pool.emplace_back(zero, i);
+    zero(0);
+    for(std::thread &t : pool)
+        t.join();
+    generation = 0;
+}
+
+void TranspositionTable::newSearch() {
+    generation = (generation + 1) % GENERATION_COUNT;
+}
+
+size_t TranspositionTable::getSizeMegabytes() const {
+    return allocatedBytes / (1024 * 1024);
+}
+
+bool TranspositionTable::probeData(uint64_t key, uint64_t &data) const {
+    Bucket &bucket = bucketFor(key);
+    for(Entry &e : bucket.entries)
+    {
+        uint64_t d = e.data.load(std::memory_order_relaxed);
+        if((e.check.load(std::memory_order_relaxed) ^ d) == key && entryBound(d) != BOUND_NONE)
+        {
+            data = d;
+            return true;
+        }
+    }
+    return false;
+}
+
+void TranspositionTable::storeData(uint64_t key, uint64_t payload, int depth, int bound) {
+    Bucket &bucket = bucketFor(key);
+    // The position's own entry if it has one, otherwise the least valuable: shallow and from old searches
+    Entry *replace = &bucket.entries[0];
+    int worst = 1 << 30;
+    for(Entry &e : bucket.entries)
+    {
+        uint64_t d = e.data.load(std::memory_order_relaxed);
+        if((e.check.load(std::memory_order_relaxed) ^ d) == key)
+        {
+            // A shallower result doesn't push out a deeper one unless it's exact
+            if(entryBound(d) != BOUND_NONE && depth < entryDepth(d) && bound != BOUND_EXACT)
+                return;
+            replace = &e;
+            break;
+        }
+        int age = (GENERATION_COUNT + generation - entryGeneration(d)) % GENERATION_COUNT;
+        int value = entryBound(d) == BOUND_NONE ? -(1 << 20) : entryDepth(d) - 8 * age;
+        if(value < worst)
+        {
+            worst = value;
+            replace = &e;
+        }
+    }
+    uint64_t data = (payload & PAYLOAD_MASK) | ((uint64_t)std::min(depth, 255) << DEPTH_SHIFT)
+                    | ((uint64_t)bound << BOUND_SHIFT) | ((uint64_t)generation << GENERATION_SHIFT);
+    replace->check.store(key ^ data, std::memory_order_relaxed);
+    replace->data.store(data, std::memory_order_relaxed);
+}
+
+bool TranspositionTable::probe(uint64_t key, TTEntry &entry) const {
+    uint64_t data;
+    if(!probeData(key, data))
+        return false;
+    entry.move = (Move)(data & 0xFFFF);
+    entry.score = (int16_t)((data >> 16) & 0xFFFF);
+    entry.depth = (uint8_t)entryDepth(data);
+    entry.bound = (uint8_t)entryBound(data);
+    return true;
+}
+
+void TranspositionTable::store(uint64_t key, Move move, int score, int depth, int bound) {
+    // Keep the old move if this search didn't find one
+    TTEntry old;
+    if(move == NO_MOVE && probe(key, old))
+        move = old.move;
+    storeData(key, (uint64_t)move | ((uint64_t)(uint16_t)score << 16), depth, bound);
+}
+
+bool TranspositionTable::probeCount(uint64_t key, int depth, uint64_t &count) const {
+    uint64_t data;
+    if(!probeData(key, data) || entryDepth(data) != depth)
+        return false;
+    count = data & PAYLOAD_MASK;
+    return true;
+}
+
+void TranspositionTable::storeCount(uint64_t key, int depth, uint64_t count) {
+    if(count <= PAYLOAD_MASK)
+        storeData(key, count, depth, BOUND_EXACT);
+}
+
+int TranspositionTable::hashfull() const {
+    size_t sample = std::min<size_t>(250, bucketCount);
+    int used = 0;
+    for(size_t i = 0; i < sample; i++)
+        for(const Entry &e : buckets[i].entries)
+        {
+            uint64_t d = e.data.load(std::memory_order_relaxed);
+            if(entryBound(d) != BOUND_NONE && entryGeneration(d) == generation)
+                used++;
+        }
+    return sample ? (int)(used * 1000 / (sample * BUCKET_SIZE)) : 0;
+}
@@ -0,0 +1,88 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#ifndef RG_3D_SAH_TRANSPOSITIONTABLE_H
+#define RG_3D_SAH_TRANSPOSITIONTABLE_H
+
+#include <atomic>
+#include <cstddef>
+
+#include "ChessTypes.h"
+
+// What a stored score says about the real one
+enum bound {
+    BOUND_NONE,
+    // The search failed low, the real score is at most this
+    BOUND_UPPER,
+    // The search failed high, the real score is at least this
+    BOUND_LOWER,
+    BOUND_EXACT
+};
+
+// Decoded copy of a stored search result
+struct TTEntry {
+    Move move;
+    int16_t score;
+    uint8_t depth;
+    uint8_t bound;
+};
+
+// Results of earlier searches indexed by the position's Zobrist key, shared by all search threads without
+// locks. Entries are 16 bytes, four to a 64 byte bucket, so a probe touches a single cache line.
+//
+// Every entry holds its data and the key XOR-ed with that data. Two threads writing the same entry at once
+// can leave the halves of different writes behind, that pair no longer XORs back to any key and the entry
+// reads as empty, so a torn write costs a lost result but never a wrong one.
+class TranspositionTable {
+    struct Entry {
+        std::atomic<uint64_t> check;
+        // Bits 0-47 payload, 48-55 depth, 56-57 bound, 58-63 generation
+        std::atomic<uint64_t> data;
+    };
+    static const int BUCKET_SIZE = 4;
+    struct Bucket {
+        Entry entries[BUCKET_SIZE];
+    };
+
+    Bucket *buckets;
+    size_t bucketCount;
+    size_t allocatedBytes;
+    // Bumped once per search, older entries are the first to be replaced
+    uint8_t generation;
+
+    Bucket &bucketFor(uint64_t key) const {
+        // Multiply-shift maps the key onto any bucket count, no power of two needed
+        return buckets[(size_t)(((unsigned __int128)key * bucketCount) >> 64)];
+    }
+    bool probeData(uint64_t key, uint64_t &data) const;
+    void storeData(uint64_t key, uint64_t payload, int depth, int bound);
+    void release();
+public:
+    explicit TranspositionTable(size_t megabytes);
+    ~TranspositionTable();
+    TranspositionTable(const TranspositionTable &) = delete;
+    TranspositionTable &operator=(const TranspositionTable &) = delete;
+
+    // Reallocates the table, everything stored is lost. Not safe while a search is using it
+    void resize(size_t megabytes);
+    // Zeroes the table using all cores, a large table takes too long for one
+    void clear();
+    void newSearch();
+    size_t getSizeMegabytes() const;
+
+    bool probe(uint64_t key, TTEntry &entry) const;
+    void store(uint64_t key, Move move, int score, int depth, int bound);
+    // Perft keeps subtree node counts of up to 48 bits in the same layout
+    bool probeCount(uint64_t key, int depth, uint64_t &count) const;
+    void storeCount(uint64_t key, int depth, uint64_t count);
+
+    // Starts loading the key's bucket into cache ahead of the probe
+    void prefetch(uint64_t key) const {
+        __builtin_prefetch(&bucketFor(key));
+    }
+    // Permille of a sample of entries written during the current search
+    int hashfull() const;
+};
+
+#endif //RG_3D_SAH_TRANSPOSITIONTABLE_H
@@ -0,0 +1,21 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#include "Zobrist.h"
+
+static constexpr ZobristKeys generateKeys() {
+    ZobristKeys keys = {};
+    uint64_t state = 0x3D5A1C3E0F2B4D6CULL;
+    for(int piece = 0; piece < 12; piece++)
+        for(int square = 0; square < 64; square++)
+            keys.pieces[piece][square] = splitmix64(state);
+    keys.side = splitmix64(state);
+    for(int i = 0; i < 16; i++)
+        keys.castling[i] = splitmix64(state);
+    for(int i = 0; i < 8; i++)
+        keys.enPassant[i] = splitmix64(state);
+    return keys;
+}
+
+constexpr ZobristKeys zobrist = generateKeys();
@@ -0,0 +1,30 @@
+//
+// Created by aca on 19.10.26..
+//
+
+#ifndef RG_3D_SAH_ZOBRIST_H
+#define RG_3D_SAH_ZOBRIST_H
+
+#include "ChessTypes.h"
+
+// Random keys XOR-ed together to identify a position: one per piece on every square, one for the side to
+// move, one per castling rights combination and one per en passant file
+struct ZobristKeys {
+    uint64_t pieces[12][64];
+    uint64_t side;
+    uint64_t castling[16];
+    uint64_t enPassant[8];
+};
+
+// splitmix64 step, keys have to be the same in every process that shares hashes so they come from fixed seeds
+constexpr uint64_t splitmix64(uint64_t &state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Generated at compile time, so global positions constructed before main() already see the real keys
+extern const ZobristKeys zobrist;
+
+#endif //RG_3D_SAH_ZOBRIST_H
@@ -0,0 +1,19 @@
+#version 330 core
+
+uniform sampler2D sourceTexture;
+uniform ivec2 sourceSize;
+
+out float FragDepth;
+
+void main()
+{
+    // Every destination texel keeps the farthest depth of the 2x2 source texels it covers, clamping
+    // at the border so odd sized levels stay covered
+    ivec2 base = ivec2(gl_FragCoord.xy) * 2;
+    ivec2 last = sourceSize - ivec2(1, 1);
+    float d0 = texelFetch(sourceTexture, min(base, last), 0).r;
+    float d1 = texelFetch(sourceTexture, min(base + ivec2(1, 0), last), 0).r;
+    float d2 = texelFetch(sourceTexture, min(base + ivec2(0, 1), last), 0).r;
+    float d3 = texelFetch(sourceTexture, min(base + ivec2(1, 1), last), 0).r;
+    FragDepth = max(max(d0, d1), max(d2, d3));
+}
@@ -0,0 +1,364 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+#include "../classes/Search.h"
+#include "../classes/PgnReader.h"
+#include "../classes/Nnue.h"
+
+// Searches every position of a FEN list, or every position before a move of a PGN database, to a fixed depth
+// or node budget. Each thread runs its own searcher with its own slice of the hash, and takes a contiguous
+// range of the positions so consecutive positions of a game share a table. A thread that runs out steals
+// half of the largest range left.
+//
+// Results are appended to the output as JSON lines or CSV, whichever its name ends with, as soon as a
+// position is done. The output is the checkpoint: on a rerun with the same input the positions already in it
+// are skipped, so an interrupted run picks up where it stopped. Scores are from the side to move.
+//
+// Usage: rg_3d_sah_analyze INPUT OUTPUT [--depth N] [--nodes N] [--threads N] [--hash MB] [--nnue FILE]
+
+struct AnalysisJob {
+    // Offset of the FEN in the shared text
+    size_t fen;
+    // Line of a FEN list, or game number and ply of a PGN
+    uint32_t source;
+    uint16_t ply;
+    Move played;
+};
+
+struct JobList {
+    std::vector<AnalysisJob> jobs;
+    std::vector<char> fens;
+    bool fromPgn = false;
+
+    void add(const Position &pos, uint32_t source, uint16_t ply, Move played) {
+        char fen[MAX_FEN_LENGTH];
+        int length = pos.getFen(fen);
+        jobs.push_back({fens.size(), source, ply, played});
+        fens.insert(fens.end(), fen, fen + length + 1);
+    }
+    const char *fen(const AnalysisJob &job) const {
+        return fens.data() + job.fen;
+    }
+};
+
+static bool endsWith(const std::string &text, const char *suffix) {
+    size_t length = strlen(suffix);
+    return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+}
+
+static bool loadFenList(const char *path, JobList &list) {
+    std::ifstream file(path);
+    if(!file)
+        return false;
+    std::unique_ptr<Position> pos(new Position());
+    std::string line;
+    for(uint32_t number = 1; std::getline(file, line); number++)
+    {
+        if(line.empty() || line[0] == '#')
+            continue;
+        if(pos->setFen(line.c_str()))
+            list.add(*pos, number, 0, NO_MOVE);
+        else
+            std::cerr << "Skipping invalid FEN on line " << number << std::endl;
+    }
+    return true;
+}
+
+static bool loadPgn(const char *path, JobList &list) {
+    PgnReader reader;
+    if(!reader.open(path))
+        return false;
+    list.fromPgn = true;
+    std::unique_ptr<Position> replay(new Position());
+    uint32_t number = 0;
+    // One thread keeps the games in file order, the numbering has to be the same on every run
+    reader.read([&](const PgnGame &game, const Position &) {
+        number++;
+        PgnView fen = game.tag("FEN");
+        if(fen.size())
+        {
+            if(!replay->setFen(fen.str().c_str()))
+                return;
+        }
+        else
+            replay->setStartPosition();
+        // Moves up to an illegal one are still worth looking at
+        for(int i = 0; i < game.moveCount; i++)
+        {
+            list.add(*replay, number, (uint16_t)(i + 1), game.moves[i]);
+            replay->makeMove(game.moves[i]);
+        }
+    }, 1);
+    return true;
+}
+
+// Ids of the positions finished by an earlier run. A line cut short by the interruption is dropped
+static std::vector<bool> loadCheckpoint(const char *path, size_t jobCount, bool csv, size_t &finished) {
+    std::vector<bool> done(jobCount, false);
+    finished = 0;
+    std::ifstream file(path, std::ios::binary);
+    if(!file)
+        return done;
+    std::stringstream stream;
+    stream << file.rdbuf();
+    std::string text = stream.str();
+    size_t complete = text.rfind('\n');
+    complete = complete == std::string::npos ? 0 : complete + 1;
+    if(complete < text.size() && truncate(path, (off_t)complete) != 0)
+        std::cerr << "Failed to drop the unfinished line of " << path << std::endl;
+
+    const char *prefix = csv ? "" : "{\"id\":";
+    size_t prefixLength = strlen(prefix);
+    for(size_t start = 0; start < complete;)
+    {
+        size_t end = text.find('\n', start);
+        if(text.compare(start, prefixLength, prefix) == 0 && isdigit((unsigned char)text[start + prefixLength]))
+        {
+            size_t id = strtoull(text.c_str() + start + prefixLength, nullptr, 10);
+            if(id < jobCount && !done[id])
+            {
+                done[id] = true;
+                finished++;
+            }
+        }
+        start = end + 1;
+    }
+    return done;
+}
+
+// Range of job ids a thread works through, others take its upper half when they run dry
+struct WorkRange {
+    std::mutex mutex;
+    size_t next = 0, end = 0;
+};
+
+static bool takeJob(WorkRange &range, size_t &id) {
+    std::lock_guard<std::mutex> lock(range.mutex);
+    if(range.next == range.end)
+        return false;
+    id = range.next++;
+    return true;
+}
+
+static bool stealJobs(std::vector<std::unique_ptr<WorkRange>> &ranges, size_t thief) {
+    size_t victim = thief, most = 0;
+    for(size_t i = 0; i < ranges.size(); i++)
+    {
+        std::lock_guard<std::mutex> lock(ranges[i]->mutex);
+        if(ranges[i]->end - ranges[i]->next > most)
+        {
+            most = ranges[i]->end - ranges[i]->next;
+            victim = i;
+        }
+    }
+    if(!most || victim == thief)
+        return false;
+    size_t begin, end;
+    {
+        std::lock_guard<std::mutex> lock(ranges[victim]->mutex);
+        if(ranges[victim]->next == ranges[victim]->end)
+            return true;
+        end = ranges[victim]->end;
+        begin = ranges[victim]->next + (end - ranges[victim]->next) / 2;
+        ranges[victim]->end = begin;
+    }
+    std::lock_guard<std::mutex> lock(ranges[thief]->mutex);
+    ranges[thief]->next = begin;
+    ranges[thief]->end = end;
+    return true;
+}
+
+static std::string formatResult(const JobList &list, size_t id, const SearchReport &report, bool csv) {
+    const AnalysisJob &job = list.jobs[id];
+    bool mate = std::abs(report.score) >= VALUE_MATE_IN_MAX_PLY;
+    int mateMoves = report.score > 0 ? (VALUE_MATE - report.score + 1) / 2 : -(VALUE_MATE + report.score) / 2;
+    std::string pv;
+    for(int i = 0; i < report.pvLength; i++)
+        pv += (i ? " " : "") + moveToString(report.pv[i]);
+    std::string played = job.played != NO_MOVE ? moveToString(job.played) : "";
+    std::string score = std::to_string(mate ? mateMoves : report.score);
+
+    std::ostringstream line;
+    if(csv)
+    {
+        line << id << "," << job.source << "," << job.ply << "," << list.fen(job) << "," << played << ","
+             << moveToString(report.bestMove()) << "," << (mate ? "" : score) << "," << (mate ? score : "") << ","
+             << report.depth << "," << report.nodes << "," << report.elapsed << "," << pv << "\n";
+        return line.str();
+    }
+    line << "{\"id\":" << id << (list.fromPgn ? ",\"game\":" : ",\"line\":") << job.source;
+    if(list.fromPgn)
+        line << ",\"ply\":" << job.ply << ",\"played\":\"" << played << "\"";
+    line << ",\"fen\":\"" << list.fen(job) << "\",\"bestmove\":\"" << moveToString(report.bestMove()) << "\","
+         << (mate ? "\"mate\":" : "\"cp\":") << score << ",\"depth\":" << report.depth << ",\"nodes\":"
+         << report.nodes << ",\"time_ms\":" << report.elapsed << ",\"pv\":\"" << pv << "\"}\n";
+    return line.str();
+}
+
+// Set from the signal handler, searches in progress are cut short and their results dropped
+static std::atomic<bool> interrupted(false);
+static std::vector<std::unique_ptr<SearchSignals>> searchSignals;
+
+static void onInterrupt(int) {
+    interrupted = true;
+    for(const std::unique_ptr<SearchSignals> &s : searchSignals)
+        s->stop = true;
+}
+
+int main(int argc, char **argv) {
+    const char *input = nullptr, *output = nullptr, *nnuePath = nullptr;
+    SearchLimits limits;
+    limits.depth = 0;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t hashMegabytes = 1024;
+    bool usage = false;
+    for(int i = 1; i < argc && !usage; i++)
+    {
+        std::string arg = argv[i];
+        if(arg == "--depth" && i + 1 < argc)
+            limits.depth = std::min(MAX_PLY - 1, std::max(1, std::atoi(argv[++i])));
+        else if(arg == "--nodes" && i + 1 < argc)
+            limits.nodes = std::strtoull(argv[++i], nullptr, 10);
+        else if(arg == "--threads" && i + 1 < argc)
+            threads = std::max(1, std::atoi(argv[++i]));
+        else if(arg == "--hash" && i + 1 < argc)
+            hashMegabytes = std::max(1ul, std::strtoul(argv[++i], nullptr, 10));
+        else if(arg == "--nnue" && i + 1 < argc)
+            nnuePath = argv[++i];
+        else if(arg[0] != '-' && !input)
+            input = argv[i];
+        else if(arg[0] != '-' && !output)
+            output = argv[i];
+        else
+            usage = true;
+    }
+    if(usage || !input || !output)
+    {
+        std::cerr << "Usage: " << argv[0] << " INPUT OUTPUT [--depth N] [--nodes N] [--threads N] [--hash MB] [--nnue FILE]" << std::endl;
+        return 2;
+    }
+    // Without a budget every position gets a quick look
+    if(!limits.depth && !limits.nodes)
+        limits.depth = 12;
+    if(!limits.depth)
+        limits.depth = MAX_PLY - 1;
+    if(nnuePath && !nnueLoad(nnuePath))
+    {
+        std::cerr << "Failed to load " << nnuePath << std::endl;
+        return 1;
+    }
+
+    JobList list;
+    std::string inputName = input;
+    if(!(endsWith(inputName, ".pgn") ? loadPgn(input, list) : loadFenList(input, list)))
+    {
+        std::cerr << "Failed to read " << input << std::endl;
+        return 1;
+    }
+    bool csv = endsWith(output, ".csv");
+    size_t finished;
+    std::vector<bool> done = loadCheckpoint(output, list.jobs.size(), csv, finished);
+    std::vector<size_t> pending;
+    for(size_t id = 0; id < list.jobs.size(); id++)
+        if(!done[id])
+            pending.push_back(id);
+    std::cout << list.jobs.size() << " positions, " << finished << " done earlier, " << pending.size() << " to search" << std::endl;
+
+    FILE *out = fopen(output, "ab");
+    if(!out)
+    {
+        std::cerr << "Failed to write " << output << std::endl;
+        return 1;
+    }
+    fseek(out, 0, SEEK_END);
+    if(csv && ftell(out) == 0)
+        fputs("id,source,ply,fen,played,bestmove,cp,mate,depth,nodes,time_ms,pv\n", out);
+    fflush(out);
+
+    threads = (int)std::max<size_t>(1, std::min<size_t>(threads, pending.size()));
+    std::vector<std::unique_ptr<WorkRange>> ranges;
+    for(int t = 0; t < threads; t++)
+    {
+        ranges.emplace_back(new WorkRange());
+        ranges[t]->next = pending.size() * t / threads;
+        ranges[t]->end = pending.size() * (t + 1) / threads;
+        searchSignals.emplace_back(new SearchSignals());
+    }
+    signal(SIGINT, onInterrupt);
+    signal(SIGTERM, onInterrupt);
+
+    std::mutex outputMutex;
+    std::atomic<uint64_t> completed(0), totalNodes(0);
+    auto start = std::chrono::steady_clock::now();
+    auto worker = [&](int index) {
+        TranspositionTable tt(std::max<size_t>(1, hashMegabytes / threads));
+        std::unique_ptr<Searcher> searcher(new Searcher(tt, *searchSignals[index]));
+        std::unique_ptr<Position> pos(new Position());
+        size_t slot;
+        while(!interrupted)
+        {
+            if(!takeJob(*ranges[index], slot))
+            {
+                if(!stealJobs(ranges, index))
+                    break;
+                continue;
+            }
+            size_t id = pending[slot];
+            pos->setFen(list.fen(list.jobs[id]));
+            tt.newSearch();
+            SearchReport report = searcher->think(*pos, limits, nullptr);
+            if(interrupted)
+                break;
+            std::string line = formatResult(list, id, report, csv);
+            std::lock_guard<std::mutex> lock(outputMutex);
+            fputs(line.c_str(), out);
+            fflush(out);
+            completed++;
+            totalNodes += report.nodes;
+        }
+    };
+    std::vector<std::thread> pool;
+    for(int t = 1; t < threads; t++)
+        pool.emplace_back(worker, t);
+    std::thread progress([&]() {
+        auto last = std::chrono::steady_clock::now();
+        while(completed < pending.size() && !interrupted)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            if(std::chrono::steady_clock::now() - last < std::chrono::seconds(10))
+                continue;
+            last = std::chrono::steady_clock::now();
+            double seconds = std::chrono::duration<double>(last - start).count();
+            std::cerr << completed << "/" << pending.size() << " positions, " << (uint64_t)(totalNodes / seconds) << " nodes/s" << std::endl;
+        }
+    });
+    worker(0);
+    for(std::thread &t : pool)
+        t.join();
+    interrupted = interrupted || completed < pending.size();
+    progress.join();
+    fclose(out);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << completed << " positions searched in " << seconds << " s, " << (uint64_t)(totalNodes / std::max(seconds, 1e-3))
+              << " nodes/s" << std::endl;
+    if(completed < pending.size())
+    {
+        std::cout << "Interrupted, run again to continue" << std::endl;
+        return 1;
+    }
+    return 0;
+}
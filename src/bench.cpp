@@ -0,0 +1,418 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../classes/Engine.h"
+#include "../classes/Nnue.h"
+#include "../classes/Profiler.h"
+#include "../classes/Benchmark.h"
+
+// Measures how the search scales with threads: every position is searched to a fixed depth with an empty
+// table, once per thread count, and time to depth and nodes per second are compared with a single thread.
+//
+// With --eval it instead compares the evaluators' throughput, walking the move tree of the same positions with
+// make/unmake and evaluating every node. Without a network file the NNUE gets random weights, which evaluate
+// just as fast.
+//
+// With --fen-file it measures how fast a file of FENs, one per line, is parsed and written back out.
+//
+// --trace writes the search threads' profiling zones as a Chrome trace, in builds with RG_3D_SAH_PROFILE.
+//
+// With --run it instead runs the named scenarios whose names contain the filter ("all" for every one), each
+// after warmup runs and repeated, and prints median, confidence interval and rate. --json saves the results,
+// --compare checks them against saved ones and fails if any scenario got slower by more than the threshold.
+// Where the 3D app can be built, asset loading and offscreen rendering scenarios are linked in as well.
+//
+// Usage: rg_3d_sah_bench [--depth N] [--threads N] [--hash MB] [--nnue FILE] [--eval] [--fen-file FILE] [--trace FILE]
+//                        [--list] [--run FILTER] [--repeat N] [--warmup N] [--json FILE] [--compare FILE] [--threshold PCT]
+
+const char *benchPositions[] = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+        "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP1B1PPP/R2QKB1R w KQ - 0 8",
+        "2r3k1/5pp1/p3p2p/1p1nP3/3P4/P2B1P2/1P3KPP/2R5 b - - 0 27",
+};
+
+struct BenchResult {
+    double seconds;
+    uint64_t nodes;
+};
+
+BenchResult runBench(Engine &engine, int depth) {
+    BenchResult total = {0, 0};
+    for(const char *fen : benchPositions)
+    {
+        Position pos;
+        pos.setFen(fen);
+        engine.clearHash();
+        SearchLimits limits;
+        limits.depth = depth;
+        auto start = std::chrono::steady_clock::now();
+        engine.go(pos, limits);
+        SearchReport report;
+        while(!engine.poll(report) || !report.finished)
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        total.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        total.nodes += report.nodes;
+    }
+    return total;
+}
+
+// Evaluates every node of the tree below pos, returns a checksum so the calls can't be optimized away
+int64_t evalWalk(Position &pos, int depth, int (*eval)(const Position &), uint64_t &nodes) {
+    int64_t sum = eval(pos);
+    nodes++;
+    if(depth == 0)
+        return sum;
+    MoveList list;
+    generateMoves(pos, list);
+    for(Move m : list)
+    {
+        pos.makeMove(m);
+        sum += evalWalk(pos, depth - 1, eval, nodes);
+        pos.unmakeMove();
+    }
+    return sum;
+}
+
+void runEvalBench(int depth) {
+    struct {
+        const char *name;
+        int (*eval)(const Position &);
+    } evaluators[] = {{"classical", classicalEvaluate}, {"nnue", nnueEvaluate}};
+    Accumulator *accumulators = nnueAllocateAccumulators();
+    double classicalRate = 0;
+    std::cout << "Evaluating every node to depth " << depth << ", NNUE kernels: " << nnueKernels() << std::endl;
+    for(auto &evaluator : evaluators)
+    {
+        uint64_t nodes = 0;
+        int64_t checksum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for(const char *fen : benchPositions)
+        {
+            Position pos;
+            pos.setFen(fen);
+            pos.setAccumulators(accumulators);
+            checksum += evalWalk(pos, depth, evaluator.eval, nodes);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double rate = nodes / seconds;
+        if(!classicalRate)
+            classicalRate = rate;
+        std::cout << std::setw(10) << evaluator.name << std::setw(12) << nodes << " nodes" << std::fixed << std::setprecision(3)
+                  << std::setw(9) << seconds << " s" << std::setprecision(2) << std::setw(8) << rate / 1e6 << " M/s"
+                  << std::setw(8) << classicalRate / rate << "x slower  (checksum " << checksum << ")" << std::endl;
+    }
+    nnueFreeAccumulators(accumulators);
+}
+
+// Parses the lines of the file where they are mapped, once alone and once writing every position back out
+int runFenBench(const char *path) {
+    int fd = open(path, O_RDONLY);
+    struct stat info;
+    if(fd < 0 || fstat(fd, &info) != 0 || info.st_size <= 0)
+    {
+        if(fd >= 0)
+            close(fd);
+        std::cerr << "Failed to read " << path << std::endl;
+        return 1;
+    }
+    void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapping == MAP_FAILED)
+    {
+        std::cerr << "Failed to map " << path << std::endl;
+        return 1;
+    }
+    madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+    const char *begin = (const char *)mapping, *end = begin + info.st_size;
+
+    // The parser may look a character past the end of the line, a last line without a newline is copied out
+    char lastLine[MAX_FEN_LENGTH] = {};
+    const char *lastStart = end;
+    if(end[-1] != '\n')
+    {
+        lastStart = (const char *)memrchr(begin, '\n', info.st_size);
+        lastStart = lastStart ? lastStart + 1 : begin;
+        memcpy(lastLine, lastStart, std::min<size_t>(end - lastStart, MAX_FEN_LENGTH - 1));
+    }
+
+    Position pos;
+    char fen[MAX_FEN_LENGTH];
+    uint64_t lines = 0, invalid = 0, written = 0;
+    double seconds[2];
+    for(int pass = 0; pass < 2; pass++)
+    {
+        lines = invalid = written = 0;
+        auto start = std::chrono::steady_clock::now();
+        for(const char *line = begin; line < end; )
+        {
+            const char *next = line < lastStart ? (const char *)memchr(line, '\n', lastStart - line) + 1 : end;
+            if(next - line > 1 && *line != '\r')
+            {
+                lines++;
+                if(!pos.setFen(line < lastStart ? line : lastLine))
+                    invalid++;
+                else if(pass == 1)
+                    written += pos.getFen(fen);
+            }
+            line = next;
+        }
+        seconds[pass] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    munmap(mapping, info.st_size);
+
+    std::cout << lines << " FENs, " << invalid << " invalid" << std::endl;
+    std::cout << "Parse:     " << std::fixed << std::setprecision(3) << seconds[0] << " s, " << std::setprecision(2)
+              << lines / seconds[0] / 1e6 << " M FENs/s" << std::endl;
+    std::cout << "Parse+FEN: " << std::setprecision(3) << seconds[1] << " s, " << std::setprecision(2)
+              << lines / seconds[1] / 1e6 << " M FENs/s  (" << written << " chars written)" << std::endl;
+    return 0;
+}
+
+// Settings of the scenarios below, taken from the command line before they run
+int scenarioDepth = 10;
+size_t scenarioHash = 64;
+std::unique_ptr<Engine> scenarioEngine;
+
+uint64_t perft(Position &pos, int depth) {
+    MoveList list;
+    generateMoves(pos, list);
+    if(depth == 1)
+        return list.size();
+    uint64_t leaves = 0;
+    for(Move m : list)
+    {
+        pos.makeMove(m);
+        leaves += perft(pos, depth - 1);
+        pos.unmakeMove();
+    }
+    return leaves;
+}
+
+uint64_t searchScenario(int threads) {
+    if(scenarioEngine->getThreads() != threads)
+        scenarioEngine->setThreads(threads);
+    return runBench(*scenarioEngine, scenarioDepth).nodes;
+}
+
+uint64_t evalScenario(int (*eval)(const Position &)) {
+    Accumulator *accumulators = nnueAllocateAccumulators();
+    uint64_t nodes = 0;
+    int64_t checksum = 0;
+    for(const char *fen : benchPositions)
+    {
+        Position pos;
+        pos.setFen(fen);
+        pos.setAccumulators(accumulators);
+        checksum += evalWalk(pos, 3, eval, nodes);
+    }
+    nnueFreeAccumulators(accumulators);
+    // Keeps the walk from being optimized away
+    return checksum == INT64_MIN ? 0 : nodes;
+}
+
+BenchRegistrar perftScenario({"movegen/perft-4", "leaves", []() {
+    uint64_t leaves = 0;
+    for(const char *fen : benchPositions)
+    {
+        std::unique_ptr<Position> pos(new Position());
+        pos->setFen(fen);
+        leaves += perft(*pos, 4);
+    }
+    return leaves;
+}, {}, {}, {}});
+
+BenchRegistrar fenScenario({"fen/parse-write", "positions", []() {
+    std::unique_ptr<Position> pos(new Position());
+    char fen[MAX_FEN_LENGTH];
+    uint64_t positions = 0, written = 0;
+    for(int i = 0; i < 20000; i++)
+        for(const char *line : benchPositions)
+        {
+            pos->setFen(line);
+            written += pos->getFen(fen);
+            positions++;
+        }
+    return written ? positions : 0;
+}, {}, {}, {}});
+
+BenchScenario searchScenarioWith(const std::string &name, int threads) {
+    BenchScenario scenario;
+    scenario.name = name;
+    scenario.unit = "nodes";
+    scenario.run = [threads]() {
+        return searchScenario(threads);
+    };
+    scenario.setup = []() {
+        if(!scenarioEngine)
+            scenarioEngine.reset(new Engine(scenarioHash, 1));
+        return true;
+    };
+    return scenario;
+}
+
+BenchRegistrar searchSingleScenario(searchScenarioWith("search/1-thread", 1));
+BenchRegistrar searchAllScenario(searchScenarioWith("search/all-threads", std::max(1u, std::thread::hardware_concurrency())));
+
+BenchRegistrar classicalScenario({"eval/classical", "nodes", []() {
+    return evalScenario(classicalEvaluate);
+}, {}, {}, {}});
+
+// Without a network the NNUE gets random weights, which evaluate just as fast. The search would use them too,
+// so this runs after the search scenarios
+BenchRegistrar nnueScenario({"eval/nnue", "nodes", []() {
+    return evalScenario(nnueEvaluate);
+}, []() {
+    if(!nnueIsLoaded())
+        nnueInitRandom(1);
+    return true;
+}, {}, {}});
+
+int runScenarios(const BenchOptions &options, const char *jsonPath, const char *comparePath, double threshold) {
+    std::vector<BenchStats> results = benchRun(options, std::cout);
+    scenarioEngine.reset();
+    if(results.empty())
+    {
+        std::cerr << "No scenario matches " << options.filter << std::endl;
+        return 1;
+    }
+    if(jsonPath && !benchWriteJson(jsonPath, results))
+    {
+        std::cerr << "Failed to write " << jsonPath << std::endl;
+        return 1;
+    }
+    if(!comparePath)
+        return 0;
+    std::vector<BenchStats> baseline;
+    if(!benchReadJson(comparePath, baseline))
+    {
+        std::cerr << "Failed to read " << comparePath << std::endl;
+        return 1;
+    }
+    std::cout << "Against " << comparePath << ", threshold " << threshold << "%:" << std::endl;
+    int regressions = benchCompare(baseline, results, threshold, std::cout);
+    if(regressions)
+        std::cout << regressions << " regression" << (regressions > 1 ? "s" : "") << std::endl;
+    return regressions ? 3 : 0;
+}
+
+int main(int argc, char **argv) {
+    int depth = 10;
+    int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    size_t hashMegabytes = 64;
+    const char *network = nullptr, *fenFile = nullptr, *tracePath = nullptr;
+    bool evalBench = false;
+    BenchOptions options;
+    const char *runFilter = nullptr, *jsonPath = nullptr, *comparePath = nullptr;
+    double threshold = 5;
+    for(int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if(arg == "--depth" && i + 1 < argc)
+            depth = std::max(1, std::atoi(argv[++i]));
+        else if(arg == "--threads" && i + 1 < argc)
+            maxThreads = std::max(1, std::atoi(argv[++i]));
+        else if(arg == "--hash" && i + 1 < argc)
+            hashMegabytes = std::strtoul(argv[++i], nullptr, 10);
+        else if(arg == "--nnue" && i + 1 < argc)
+            network = argv[++i];
+        else if(arg == "--eval")
+            evalBench = true;
+        else if(arg == "--fen-file" && i + 1 < argc)
+            fenFile = argv[++i];
+        else if(arg == "--trace" && i + 1 < argc)
+            tracePath = argv[++i];
+        else if(arg == "--list")
+        {
+            for(const std::string &name : benchNames())
+                std::cout << name << std::endl;
+            return 0;
+        }
+        else if(arg == "--run" && i + 1 < argc)
+            runFilter = argv[++i];
+        else if(arg == "--repeat" && i + 1 < argc)
+            options.repetitions = std::max(1, std::atoi(argv[++i]));
+        else if(arg == "--warmup" && i + 1 < argc)
+            options.warmup = std::max(0, std::atoi(argv[++i]));
+        else if(arg == "--json" && i + 1 < argc)
+            jsonPath = argv[++i];
+        else if(arg == "--compare" && i + 1 < argc)
+            comparePath = argv[++i];
+        else if(arg == "--threshold" && i + 1 < argc)
+            threshold = std::atof(argv[++i]);
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--depth N] [--threads N] [--hash MB] [--nnue FILE] [--eval] [--fen-file FILE] [--trace FILE]"
+                      << " [--list] [--run FILTER] [--repeat N] [--warmup N] [--json FILE] [--compare FILE] [--threshold PCT]" << std::endl;
+            return 2;
+        }
+    }
+
+    if(fenFile)
+        return runFenBench(fenFile);
+    if(network && !nnueLoad(network))
+    {
+        std::cerr << "Failed to load the network " << network << std::endl;
+        return 1;
+    }
+    if(runFilter)
+    {
+        options.filter = runFilter;
+        scenarioDepth = depth;
+        scenarioHash = hashMegabytes;
+        int status = runScenarios(options, jsonPath, comparePath, threshold);
+        if(tracePath && !profileWriteTrace(tracePath))
+            std::cerr << (profileEnabled() ? "Failed to write " : "Profiling is compiled out, not writing ") << tracePath << std::endl;
+        return status;
+    }
+    if(evalBench)
+    {
+        if(!network)
+            nnueInitRandom(1);
+        runEvalBench(std::min(depth, 4));
+        return 0;
+    }
+
+    // Doubling thread counts up to the maximum, which is always included
+    std::vector<int> threadCounts;
+    for(int t = 1; t < maxThreads; t *= 2)
+        threadCounts.push_back(t);
+    threadCounts.push_back(maxThreads);
+
+    Engine engine(hashMegabytes, 1);
+    std::cout << sizeof(benchPositions) / sizeof(benchPositions[0]) << " positions to depth " << depth << ", "
+              << hashMegabytes << " MB hash" << std::endl;
+    std::cout << "threads    time (s)         nodes     Mnps  time speedup  nps speedup" << std::endl;
+    BenchResult single = {0, 0};
+    for(int threads : threadCounts)
+    {
+        engine.setThreads(threads);
+        BenchResult result = runBench(engine, depth);
+        if(threads == 1)
+            single = result;
+        double nps = result.nodes / result.seconds, singleNps = single.nodes / single.seconds;
+        std::cout << std::setw(7) << threads << std::fixed << std::setprecision(3) << std::setw(12) << result.seconds
+                  << std::setw(14) << result.nodes << std::setprecision(2) << std::setw(9) << nps / 1e6
+                  << std::setw(13) << single.seconds / result.seconds << std::setw(13) << nps / singleNps << std::endl;
+    }
+    if(tracePath && !profileWriteTrace(tracePath))
+    {
+        std::cerr << (profileEnabled() ? "Failed to write " : "Profiling is compiled out, not writing ") << tracePath << std::endl;
+        return 1;
+    }
+    return 0;
+}
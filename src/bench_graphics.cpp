@@ -0,0 +1,370 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <memory>
+#include <fcntl.h>
+#include <unistd.h>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "../classes/Benchmark.h"
+#include "../classes/Shader.h"
+#include "../classes/Texture2D.h"
+#include "../classes/Model.h"
+#include "../classes/Skybox.h"
+#include "../classes/Camera.h"
+#include "../classes/FigurePool.h"
+#include "../classes/lights.h"
+#include "../classes/materials.h"
+#include "../classes/MemoryTracker.h"
+#include "../classes/GlState.h"
+
+// Scenarios of rg_3d_sah_bench that need the 3D app's dependencies: importing and decoding the assets,
+// loading them onto the GPU with the file cache cold and warm, compiling the shaders and drawing the figures
+// of the start position offscreen. Linked into the bench only where the app can be built. Everything that
+// needs GL runs in a hidden window, the scenarios are skipped if none can be opened. Paths are relative to
+// the build directory, like the app's.
+
+// In the order of the figure types, so the render scenarios index the models by type
+static const char *pieceNames[] = {"pawn", "knight", "bishop", "rook", "queen", "king"};
+static const char *skyboxFaces[] = {"right", "left", "top", "bottom", "front", "back"};
+static const char *shaderNames[][3] = {
+        {"board", "board_vertex_shader.vs", "board_fragment_shader.fs"},
+        {"piece", "chess_piece_vertex_shader.vs", "chess_piece_fragment_shader.fs"},
+        {"skybox", "skybox.vs", "skybox.fs"},
+        {"lightcube", "lightcube_vertex_shader.vs", "lightcube_fragment_shader.fs"},
+};
+static const int resolutions[][2] = {{640, 360}, {1280, 720}, {1920, 1080}, {3840, 2160}};
+// Frames drawn per repetition of a render scenario
+static const int RENDER_FRAMES = 30;
+
+static std::string modelPath(const char *piece) {
+    return std::string("../resources/models/chess/") + piece + "/" + piece + ".obj";
+}
+
+static std::vector<std::string> skyboxPaths() {
+    std::vector<std::string> paths;
+    for(const char *face : skyboxFaces)
+        paths.push_back(std::string("../resources/skybox/") + face + ".jpg");
+    return paths;
+}
+
+static bool exists(const std::string &path) {
+    return access(path.c_str(), R_OK) == 0;
+}
+
+static GLFWwindow *window = nullptr;
+
+// One hidden window for every scenario, opened by the first that needs it
+static bool openContext() {
+    if(window != nullptr)
+        return true;
+    if(!glfwInit())
+        return false;
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    window = glfwCreateWindow(64, 64, "rg_3d_sah_bench", nullptr, nullptr);
+    if(window == nullptr)
+    {
+        std::cerr << "No GL context, skipping the GPU scenarios" << std::endl;
+        glfwTerminate();
+        return false;
+    }
+    glfwMakeContextCurrent(window);
+    if(!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        window = nullptr;
+        return false;
+    }
+    return true;
+}
+
+// Asks the kernel to drop the file from the page cache, so the next read comes from the disk. Pages of the
+// file that are mapped or dirty stay, which is as cold as it gets without root
+static void evict(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+        return;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+static BenchScenario importScenario(const char *piece) {
+    BenchScenario scenario;
+    scenario.name = std::string("assets/import-") + piece;
+    scenario.unit = "vertices";
+    std::string path = modelPath(piece);
+    scenario.setup = [path]() {
+        return exists(path);
+    };
+    scenario.run = [path]() {
+        ModelData data;
+        if(!ModelData::import(path, data))
+            return (uint64_t)0;
+        uint64_t vertices = 0;
+        for(MeshData &mesh : data.meshes)
+            vertices += mesh.vertices.size();
+        return vertices;
+    };
+    return scenario;
+}
+
+static BenchScenario decodeScenario(const std::string &name, const std::vector<std::string> &paths) {
+    BenchScenario scenario;
+    scenario.name = name;
+    scenario.unit = "bytes";
+    scenario.setup = [paths]() {
+        for(const std::string &path : paths)
+            if(!exists(path))
+                return false;
+        return true;
+    };
+    scenario.run = [paths]() {
+        uint64_t bytes = 0;
+        for(const std::string &path : paths)
+        {
+            ImageData image;
+            if(ImageData::load(path, image))
+                bytes += (uint64_t)image.width * image.height * image.nChannels;
+            image.free();
+        }
+        return bytes;
+    };
+    return scenario;
+}
+
+// Everything the app loads at startup, created directly rather than through the asset registry so every
+// repetition really loads
+struct LoadedAssets {
+    std::vector<std::unique_ptr<Model>> models;
+    std::vector<Texture2D> textures;
+    std::unique_ptr<Skybox> skybox;
+
+    void release() {
+        for(auto &model : models)
+            model->del();
+        models.clear();
+        for(Texture2D &texture : textures)
+            texture.del();
+        textures.clear();
+        if(skybox)
+            skybox->del();
+        skybox.reset();
+    }
+};
+
+static LoadedAssets loaded;
+
+static std::vector<std::string> assetFiles() {
+    std::vector<std::string> files = skyboxPaths();
+    for(const char *piece : pieceNames)
+        files.push_back(modelPath(piece));
+    files.push_back("../resources/textures/chess_board_diffuse.jpg");
+    files.push_back("../resources/textures/chess_board_specular.jpg");
+    return files;
+}
+
+static BenchScenario loadScenario(bool cold) {
+    BenchScenario scenario;
+    scenario.name = cold ? "assets/load-cold" : "assets/load-warm";
+    scenario.unit = "assets";
+    scenario.setup = []() {
+        for(const std::string &path : assetFiles())
+            if(!exists(path))
+                return false;
+        return openContext();
+    };
+    scenario.before = [cold]() {
+        loaded.release();
+        glFinish();
+        if(cold)
+            for(const std::string &path : assetFiles())
+                evict(path);
+    };
+    scenario.run = []() {
+        for(const char *piece : pieceNames)
+            loaded.models.emplace_back(new Model(modelPath(piece)));
+        loaded.textures.emplace_back("../resources/textures/chess_board_diffuse.jpg", DIFFUSE, GL_REPEAT, GL_LINEAR);
+        loaded.textures.emplace_back("../resources/textures/chess_board_specular.jpg", SPECULAR, GL_REPEAT, GL_LINEAR);
+        loaded.skybox.reset(new Skybox(skyboxPaths()));
+        // Uploads are queued, the load isn't over before the driver is done with them
+        glFinish();
+        return (uint64_t)(loaded.models.size() + loaded.textures.size() + 1);
+    };
+    scenario.teardown = []() {
+        loaded.release();
+    };
+    return scenario;
+}
+
+static BenchScenario shaderScenario(const char *name, const char *vertex, const char *fragment) {
+    BenchScenario scenario;
+    scenario.name = std::string("shader/compile-") + name;
+    scenario.unit = "programs";
+    std::string vertexPath = std::string("../resources/shaders/") + vertex;
+    std::string fragmentPath = std::string("../resources/shaders/") + fragment;
+    scenario.setup = [vertexPath, fragmentPath]() {
+        return exists(vertexPath) && exists(fragmentPath) && openContext();
+    };
+    scenario.run = [vertexPath, fragmentPath]() {
+        Shader shader(vertexPath, fragmentPath);
+        // Drivers may link lazily, using the program makes sure it's done
+        shader.use();
+        glFinish();
+        shader.del();
+        return (uint64_t)1;
+    };
+    return scenario;
+}
+
+// The figures of the start position and the skybox, with the app's camera, lights and materials, drawn into a framebuffer of the given size
+struct OffscreenScene {
+    std::unique_ptr<Shader> modelShader, skyboxShader;
+    std::vector<std::unique_ptr<Model>> models;
+    std::unique_ptr<Skybox> skybox;
+    FigurePool figures;
+    unsigned fbo = 0, colorTex = 0, depthTex = 0;
+    int width = 0, height = 0;
+
+    bool load() {
+        if(modelShader)
+            return true;
+        for(const char *piece : pieceNames)
+            if(!exists(modelPath(piece)))
+                return false;
+        modelShader.reset(new Shader("../resources/shaders/chess_piece_vertex_shader.vs", "../resources/shaders/chess_piece_fragment_shader.fs"));
+        skyboxShader.reset(new Shader("../resources/shaders/skybox.vs", "../resources/shaders/skybox.fs"));
+        skyboxShader->use();
+        skyboxShader->setUniform1i("skybox", 0);
+        for(const char *piece : pieceNames)
+            models.emplace_back(new Model(modelPath(piece)));
+        skybox.reset(new Skybox(skyboxPaths()));
+        std::unique_ptr<Position> start(new Position());
+        start->setStartPosition();
+        figures.sync(*start, NO_SQUARE, {0, 0});
+        return true;
+    }
+
+    void resize(int w, int h) {
+        release();
+        width = w;
+        height = h;
+        glGenTextures(1, &colorTex);
+        stateBindTexture(GL_TEXTURE_2D, colorTex);
+        memoryTexImage2D(GL_TEXTURE_2D, colorTex, GL_RGBA, w, h, GL_RGBA, GL_UNSIGNED_BYTE, nullptr, false, RENDER_TARGETS, "bench");
+        glGenTextures(1, &depthTex);
+        stateBindTexture(GL_TEXTURE_2D, depthTex);
+        memoryTexImage2D(GL_TEXTURE_2D, depthTex, GL_DEPTH24_STENCIL8, w, h, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, nullptr, false,
+                         RENDER_TARGETS, "bench");
+        glGenFramebuffers(1, &fbo);
+        stateBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTex, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depthTex, 0);
+    }
+
+    void release() {
+        if(fbo == 0)
+            return;
+        stateDeleteFramebuffers(1, &fbo);
+        memoryDeleteTextures(1, &colorTex);
+        memoryDeleteTextures(1, &depthTex);
+        fbo = colorTex = depthTex = 0;
+    }
+
+    void draw() {
+        static const MaterialColor white(256.0f, glm::vec3(1.0f), glm::vec3(1.0f), glm::vec3(1.0f));
+        static const MaterialColor black(256.0f, glm::vec3(0.1f), glm::vec3(0.15f), glm::vec3(1.0f));
+        static const DirectionalLight directionalLight("directionalLight", glm::vec3(0.1f), glm::vec3(0.3f), glm::vec3(1.0f),
+                                                       glm::vec3(3.0f, -3.0f, 3.0f));
+        static const PointLight pointLight("pointLight", glm::vec3(0.2f), glm::vec3(0.6f), glm::vec3(1.0f),
+                                           glm::vec3(1.75f, 3.0f, 1.75f), 1.0f, 0.12f, 0.082f);
+        static const SpotLight spotLight("spotLight", glm::vec3(0.1f), glm::vec3(1.0f), glm::vec3(1.0f),
+                                         glm::vec3(1.5f, 2.0f, 0.5f), glm::vec3(0.0f, -1.0f, 0.0f), 7.5f, 1.0f, 0.09f, 0.032f);
+        static const Camera camera(glm::vec3(1.75f, 3.0f, 7.0f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, -30.0f);
+        glm::mat4 view = glm::lookAt(camera.Position, camera.Position + camera.Front, camera.Up);
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)width / height, 0.1f, 100.0f);
+
+        stateBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glViewport(0, 0, width, height);
+        stateEnable(GL_DEPTH_TEST);
+        glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        modelShader->use();
+        modelShader->setUniformMatrix4fv("view", view);
+        modelShader->setUniformMatrix4fv("projection", projection);
+        modelShader->setUniform3fv("viewPosition", camera.Position);
+        directionalLight.activate(*modelShader);
+        pointLight.activate(*modelShader);
+        spotLight.activate(*modelShader);
+        int activeColor = -1;
+        for(int i = 0; i < figures.size(); i++)
+        {
+            if(figures.figureColor(i) != activeColor)
+            {
+                activeColor = figures.figureColor(i);
+                (activeColor == WHITE ? white : black).activate(*modelShader, "material");
+            }
+            modelShader->setUniformMatrix4fv("model", figures.transform(i));
+            models[figures.figureType(i)]->draw(*modelShader);
+        }
+
+        stateDepthMask(GL_FALSE);
+        stateDepthFunc(GL_LEQUAL);
+        skyboxShader->use();
+        skyboxShader->setUniformMatrix4fv("view", glm::mat4(glm::mat3(view)));
+        skyboxShader->setUniformMatrix4fv("projection", projection);
+        skybox->draw();
+        stateDepthMask(GL_TRUE);
+        stateDepthFunc(GL_LESS);
+    }
+};
+
+static OffscreenScene offscreen;
+
+static BenchScenario renderScenario(int width, int height) {
+    BenchScenario scenario;
+    scenario.name = "render/start-" + std::to_string(width) + "x" + std::to_string(height);
+    scenario.unit = "frames";
+    scenario.setup = [width, height]() {
+        if(!openContext() || !offscreen.load())
+            return false;
+        offscreen.resize(width, height);
+        return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    };
+    scenario.run = []() {
+        for(int frame = 0; frame < RENDER_FRAMES; frame++)
+            offscreen.draw();
+        // Commands are only queued until the GPU has drawn them
+        glFinish();
+        return (uint64_t)RENDER_FRAMES;
+    };
+    scenario.teardown = []() {
+        offscreen.release();
+        stateBindFramebuffer(GL_FRAMEBUFFER, 0);
+    };
+    return scenario;
+}
+
+static int registerScenarios() {
+    for(const char *piece : pieceNames)
+        benchRegister(importScenario(piece));
+    benchRegister(decodeScenario("assets/decode-board", {"../resources/textures/chess_board_diffuse.jpg",
+                                                         "../resources/textures/chess_board_specular.jpg"}));
+    benchRegister(decodeScenario("assets/decode-skybox", skyboxPaths()));
+    benchRegister(loadScenario(true));
+    benchRegister(loadScenario(false));
+    for(auto &shader : shaderNames)
+        benchRegister(shaderScenario(shader[0], shader[1], shader[2]));
+    for(auto &resolution : resolutions)
+        benchRegister(renderScenario(resolution[0], resolution[1]));
+    return 0;
+}
+
+static int registered = registerScenarios();
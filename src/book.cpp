@@ -0,0 +1,280 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <queue>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+#include "../classes/PgnReader.h"
+#include "../classes/PolyglotBook.h"
+
+// Builds a Polyglot opening book from PGN files. Every position of the first plies of a game gets the move
+// played in it, worth 2 for a win, 1 for a draw and 0 for a loss of the side that played it. Records are
+// collected up to a memory budget, sorted and spilled to run files, and the runs are merged at the end, so
+// the archive can be far bigger than RAM.
+//
+// Usage: rg_3d_sah_book OUTPUT.bin PGN... [--plies N] [--min-games N] [--memory MB] [--threads N]
+
+struct BookRecord {
+    uint64_t key;
+    uint32_t weight;
+    uint32_t games;
+    uint16_t move;
+
+    bool operator<(const BookRecord &other) const {
+        return key != other.key ? key < other.key : move < other.move;
+    }
+    bool sameEntry(const BookRecord &other) const {
+        return key == other.key && move == other.move;
+    }
+};
+
+// Sorted records of one spill, read back in blocks during the merge
+class RunReader {
+    FILE *file;
+    std::vector<BookRecord> buffer;
+    size_t position, count;
+public:
+    explicit RunReader(const std::string &path) : file{fopen(path.c_str(), "rb")}, buffer(1 << 16), position{0}, count{0} {
+    }
+    ~RunReader() {
+        if(file)
+            fclose(file);
+    }
+    bool next(BookRecord &record) {
+        if(position == count)
+        {
+            count = file ? fread(buffer.data(), sizeof(BookRecord), buffer.size(), file) : 0;
+            position = 0;
+            if(!count)
+                return false;
+        }
+        record = buffer[position++];
+        return true;
+    }
+};
+
+class BookBuilder {
+    std::string output;
+    size_t memoryRecords;
+    int maxPlies;
+    std::vector<BookRecord> records;
+    std::vector<std::string> runs;
+    std::mutex mutex;
+    uint64_t gamesUsed = 0;
+
+    // Sorts the buffer, folds repeated moves together and writes it out as one run
+    void spill() {
+        std::sort(records.begin(), records.end());
+        size_t kept = 0;
+        for(size_t i = 0; i < records.size(); i++)
+        {
+            if(kept && records[kept - 1].sameEntry(records[i]))
+            {
+                records[kept - 1].weight += records[i].weight;
+                records[kept - 1].games += records[i].games;
+            }
+            else
+                records[kept++] = records[i];
+        }
+        std::string path = output + ".run" + std::to_string(runs.size());
+        FILE *file = fopen(path.c_str(), "wb");
+        if(!file || fwrite(records.data(), sizeof(BookRecord), kept, file) != kept)
+        {
+            std::cerr << "Failed to write " << path << std::endl;
+            exit(1);
+        }
+        fclose(file);
+        runs.push_back(path);
+        records.clear();
+    }
+public:
+    BookBuilder(const std::string &output, size_t memoryMegabytes, int maxPlies)
+            : output{output}, memoryRecords{std::max<size_t>(1, (memoryMegabytes << 20) / sizeof(BookRecord))}, maxPlies{maxPlies} {
+        records.reserve(memoryRecords);
+    }
+
+    // Called from the reader's threads, the records of a game are made without the lock and added at once
+    void addGame(const PgnGame &game) {
+        int whiteScore;
+        if(game.result.equals("1-0"))
+            whiteScore = 2;
+        else if(game.result.equals("0-1"))
+            whiteScore = 0;
+        else if(game.result.equals("1/2-1/2"))
+            whiteScore = 1;
+        else
+            return;
+        // Openings come from the initial position, games set up from a FEN and broken ones are left out
+        if(game.error != PGN_OK || game.tag("FEN").size())
+            return;
+
+        static thread_local std::unique_ptr<Position> replay;
+        if(!replay)
+            replay.reset(new Position());
+        replay->setStartPosition();
+        BookRecord gameRecords[MAX_GAME_PLY];
+        int count = std::min(game.moveCount, maxPlies);
+        for(int i = 0; i < count; i++)
+        {
+            int score = replay->getSideToMove() == WHITE ? whiteScore : 2 - whiteScore;
+            gameRecords[i] = {polyglotKey(*replay), (uint32_t)score, 1, toPolyglotMove(game.moves[i])};
+            replay->makeMove(game.moves[i]);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        gamesUsed++;
+        for(int i = 0; i < count; i++)
+        {
+            records.push_back(gameRecords[i]);
+            if(records.size() == memoryRecords)
+                spill();
+        }
+    }
+
+    // Merges the runs into the book, returns the number of entries written
+    uint64_t finish(int minGames) {
+        if(!records.empty() || runs.empty())
+            spill();
+        FILE *book = fopen(output.c_str(), "wb");
+        if(!book)
+        {
+            std::cerr << "Failed to write " << output << std::endl;
+            exit(1);
+        }
+
+        std::vector<std::unique_ptr<RunReader>> readers;
+        typedef std::pair<BookRecord, size_t> HeapItem;
+        auto later = [](const HeapItem &a, const HeapItem &b) {
+            return b.first < a.first;
+        };
+        std::priority_queue<HeapItem, std::vector<HeapItem>, decltype(later)> heap(later);
+        for(size_t i = 0; i < runs.size(); i++)
+        {
+            readers.emplace_back(new RunReader(runs[i]));
+            BookRecord record;
+            if(readers[i]->next(record))
+                heap.push(HeapItem(record, i));
+        }
+
+        uint64_t entries = 0;
+        std::vector<BookRecord> position;
+        auto writePosition = [&]() {
+            // Weights are 16 bits in the book, the moves of a popular position are scaled down together
+            uint32_t maxWeight = 0;
+            for(const BookRecord &r : position)
+                maxWeight = std::max(maxWeight, r.weight);
+            std::sort(position.begin(), position.end(), [](const BookRecord &a, const BookRecord &b) {
+                return a.weight > b.weight;
+            });
+            for(const BookRecord &r : position)
+            {
+                uint32_t weight = maxWeight > 0xFFFF ? (uint32_t)((uint64_t)r.weight * 0xFFFF / maxWeight) : r.weight;
+                if(r.games < (uint32_t)minGames || !weight)
+                    continue;
+                uint8_t entry[POLYGLOT_ENTRY_SIZE] = {};
+                for(int b = 0; b < 8; b++)
+                    entry[b] = (uint8_t)(r.key >> (56 - 8 * b));
+                entry[8] = (uint8_t)(r.move >> 8);
+                entry[9] = (uint8_t)r.move;
+                entry[10] = (uint8_t)(weight >> 8);
+                entry[11] = (uint8_t)weight;
+                fwrite(entry, 1, sizeof(entry), book);
+                entries++;
+            }
+            position.clear();
+        };
+        while(!heap.empty())
+        {
+            HeapItem item = heap.top();
+            heap.pop();
+            BookRecord record;
+            if(readers[item.second]->next(record))
+                heap.push(HeapItem(record, item.second));
+            if(!position.empty() && position.back().sameEntry(item.first))
+            {
+                position.back().weight += item.first.weight;
+                position.back().games += item.first.games;
+                continue;
+            }
+            if(!position.empty() && position.back().key != item.first.key)
+                writePosition();
+            position.push_back(item.first);
+        }
+        writePosition();
+        fclose(book);
+
+        readers.clear();
+        for(const std::string &run : runs)
+            remove(run.c_str());
+        return entries;
+    }
+
+    uint64_t getGamesUsed() const {
+        return gamesUsed;
+    }
+    size_t getRuns() const {
+        return runs.size();
+    }
+};
+
+int main(int argc, char **argv) {
+    std::vector<const char *> inputs;
+    const char *output = nullptr;
+    int maxPlies = 40, minGames = 3;
+    size_t memoryMegabytes = 1024;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    for(int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if(arg == "--plies" && i + 1 < argc)
+            maxPlies = std::max(1, std::atoi(argv[++i]));
+        else if(arg == "--min-games" && i + 1 < argc)
+            minGames = std::max(1, std::atoi(argv[++i]));
+        else if(arg == "--memory" && i + 1 < argc)
+            memoryMegabytes = std::max(1ul, std::strtoul(argv[++i], nullptr, 10));
+        else if(arg == "--threads" && i + 1 < argc)
+            threads = std::max(1, std::atoi(argv[++i]));
+        else if(arg[0] != '-' && !output)
+            output = argv[i];
+        else if(arg[0] != '-')
+            inputs.push_back(argv[i]);
+        else
+        {
+            inputs.clear();
+            break;
+        }
+    }
+    if(!output || inputs.empty())
+    {
+        std::cerr << "Usage: " << argv[0] << " OUTPUT.bin PGN... [--plies N] [--min-games N] [--memory MB] [--threads N]" << std::endl;
+        return 2;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    BookBuilder builder(output, memoryMegabytes, maxPlies);
+    uint64_t games = 0;
+    for(const char *input : inputs)
+    {
+        PgnReader reader;
+        if(!reader.open(input))
+        {
+            std::cerr << "Failed to read " << input << std::endl;
+            return 1;
+        }
+        games += reader.read([&](const PgnGame &game, const Position &) {
+            builder.addGame(game);
+        }, threads).games;
+    }
+    uint64_t entries = builder.finish(minGames);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << games << " games read, " << builder.getGamesUsed() << " used, " << builder.getRuns() << " sorted runs, "
+              << entries << " book entries in " << std::fixed << std::setprecision(2) << seconds << " s" << std::endl;
+    return 0;
+}
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <random>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
@@ -8,12 +9,25 @@
 #include "../classes/Texture2D.h"
 #include "../classes/Camera.h"
 #include "../classes/Model.h"
-#include "../classes/ChessFigure.h"
+#include "../classes/FigurePool.h"
 #include "../classes/Skybox.h"
 #include "../classes/lights.h"
 #include "../classes/materials.h"
 #include "../classes/Scene.h"
 #include "../classes/RawMesh.h"
+#include "../classes/OcclusionCuller.h"
+#include "../classes/HotReloader.h"
+#include "../classes/AssetRegistry.h"
+#include "../classes/MemoryTracker.h"
+#include "../classes/GlState.h"
+#include "../classes/Profiler.h"
+#include "../classes/InputRecorder.h"
+#include "../classes/Position.h"
+#include "../classes/MoveGen.h"
+#include "../classes/Engine.h"
+#include "../classes/Nnue.h"
+#include "../classes/PolyglotBook.h"
+#include "../classes/Tablebase.h"
 
 void framebuffer_size_cb(GLFWwindow *window, int width, int height);
 void key_cb(GLFWwindow *window, int key, int scancode, int action, int mods);
@@ -33,22 +47,128 @@ bool firstMouse = true;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-ChessFigure *chessBoard[8][8];
-ChessFigure *currentlyActive = nullptr;
-std::pair<int, int> currentlyActiveRealPos;
+// The game state, the figures drawn every frame are derived from it
+Position position;
+Model *figureModels[6];
+// What's drawn of the position, kept in step with it at the start of every board pass
+FigurePool figures;
+// Square of the figure that's picked up, it follows the cursor until dropped
+int activeSquare = NO_SQUARE;
 std::pair<int, int> boardCursor = std::make_pair(6, 1);
 
-void createChessBoard(Model *pawn, Model *rook, Model *knight, Model *bishop, Model *queen, Model *king);
-void drawChessBoard(Shader &shader, MaterialColor &white, MaterialColor &black);
-void destroyChessBoard();
+// The computer opponent thinks on its own threads, one core is left to the renderer. Its moves are picked up
+// at the start of a frame
+Engine engine(64, std::max(1, (int)std::thread::hardware_concurrency() - 1));
+bool computerOpponent = true;
+color computerColor = BLACK;
+const int64_t computerMoveTime = 1000;
+// Known openings are played from the book without searching, picked at random by their weights
+PolyglotBook book;
+std::mt19937_64 bookRandom(std::random_device{}());
+// Endgames are looked up in the tablebases, the result is printed once for every new position they cover
+uint64_t tablebaseShownKey = 0;
+
+bool occlusionCulling = true;
+// Where P and the exit write the profile when it is compiled in
+std::string tracePath = "rg_3d_sah_trace.json";
+
+void setFigureModels(Model *pawn, Model *rook, Model *knight, Model *bishop, Model *queen, Model *king);
+void drawChessBoard(Shader &shader, MaterialColor &white, MaterialColor &black, OcclusionCuller &culler);
+int cursorSquare();
+void startComputerMove();
+void applyComputerMove();
+void printBookMoves();
+void showTablebaseResult();
+void printTablebaseStats();
+void writeTrace();
+void replayMove(Move move);
+
+int main(int argc, char **argv) {
+    // Usage: rg_3d_sah [--fen "<fen>"] [--book FILE] [--tablebases DIR] [--memory-log SECONDS] [--trace FILE] [--record FILE] [--replay FILE [--replay-step SECONDS] [--headless]] [--no-state-cache]
+    const char *bookPath = "../resources/book/book.bin";
+    const char *tablebasePath = "../resources/tablebases";
+    // Seconds between memory log lines, 0 turns them off
+    double memoryLogInterval = 60;
+    const char *recordPath = nullptr, *replayPath = nullptr;
+    // Seconds the clock advances per replayed frame, 0 replays the recorded clock
+    double replayStep = 0;
+    bool headless = false;
+    PROFILE_THREAD("main");
+    for(int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if(arg == "--fen" && i + 1 < argc)
+        {
+            if(!position.setFen(argv[++i]))
+            {
+                std::cerr << "Invalid FEN: " << argv[i] << std::endl;
+                return 2;
+            }
+        }
+        else if(arg == "--book" && i + 1 < argc)
+            bookPath = argv[++i];
+        else if(arg == "--tablebases" && i + 1 < argc)
+            tablebasePath = argv[++i];
+        else if(arg == "--memory-log" && i + 1 < argc)
+            memoryLogInterval = atof(argv[++i]);
+        else if(arg == "--trace" && i + 1 < argc)
+            tracePath = argv[++i];
+        else if(arg == "--record" && i + 1 < argc)
+            recordPath = argv[++i];
+        else if(arg == "--replay" && i + 1 < argc)
+            replayPath = argv[++i];
+        else if(arg == "--replay-step" && i + 1 < argc)
+            replayStep = atof(argv[++i]);
+        else if(arg == "--headless")
+            headless = true;
+        else if(arg == "--no-state-cache")
+            stateSetCaching(false);
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--fen \"<fen>\"] [--book FILE] [--tablebases DIR] [--memory-log SECONDS] [--trace FILE] [--record FILE] [--replay FILE [--replay-step SECONDS] [--headless]] [--no-state-cache]" << std::endl;
+            return 2;
+        }
+    }
+    if(replayPath != nullptr)
+    {
+        // The replay starts from the recorded position, whatever --fen said
+        std::string fen;
+        if(!inputReplay(replayPath, fen, replayStep) || !position.setFen(fen.c_str()))
+        {
+            std::cerr << "Invalid recording: " << replayPath << std::endl;
+            return 2;
+        }
+    }
+    else if(headless)
+    {
+        std::cerr << "--headless only works with --replay, there's nobody to give input" << std::endl;
+        return 2;
+    }
+    else if(recordPath != nullptr)
+    {
+        char fen[MAX_FEN_LENGTH];
+        position.getFen(fen);
+        if(!inputRecord(recordPath, fen))
+        {
+            std::cerr << "Can't write the recording to " << recordPath << std::endl;
+            return 2;
+        }
+    }
+    if(book.open(bookPath))
+        std::cout << "Opening book with " << book.size() << " entries" << std::endl;
+    // Only the file names are read here, tables are mapped when a game first reaches them
+    if(tbInit(tablebasePath))
+        std::cout << "Tablebases for up to " << tbMaxPieces() << " pieces" << std::endl;
 
-int main() {
     glfwInit();
 
     // OpenGL 3.3 Core
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    // Drawing still happens, nothing is shown
+    if(headless)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
     GLFWwindow *window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "3D Chess Scene", nullptr, nullptr);
     if(window == nullptr)
@@ -59,11 +179,13 @@ int main() {
     }
     glfwMakeContextCurrent(window);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_cb);
-    glfwSetKeyCallback(window, key_cb);
-    glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetScrollCallback(window, scroll_callback);
+    inputInstall(window, key_cb, mouse_callback, scroll_callback, replayMove);
 
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    // A replay measures frame times, it doesn't wait for the display and leaves the cursor alone
+    if(inputReplaying())
+        glfwSwapInterval(0);
+    else
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
     if(!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
     {
@@ -72,15 +194,17 @@ int main() {
         return -1;
     }
 
-    Shader boardShader("../resources/shaders/board_vertex_shader.vs", "../resources/shaders/board_fragment_shader.fs");
-    Shader lightcubeShader("../resources/shaders/lightcube_vertex_shader.vs", "../resources/shaders/lightcube_fragment_shader.fs");
-    Shader modelShader("../resources/shaders/chess_piece_vertex_shader.vs", "../resources/shaders/chess_piece_fragment_shader.fs");
-    Shader skyboxShader("../resources/shaders/skybox.vs", "../resources/shaders/skybox.fs");
+    AssetHandle<Shader> boardShader = assetShader("../resources/shaders/board_vertex_shader.vs", "../resources/shaders/board_fragment_shader.fs");
+    AssetHandle<Shader> lightcubeShader = assetShader("../resources/shaders/lightcube_vertex_shader.vs", "../resources/shaders/lightcube_fragment_shader.fs");
+    AssetHandle<Shader> modelShader = assetShader("../resources/shaders/chess_piece_vertex_shader.vs", "../resources/shaders/chess_piece_fragment_shader.fs");
+    AssetHandle<Shader> skyboxShader = assetShader("../resources/shaders/skybox.vs", "../resources/shaders/skybox.fs");
+
+    OcclusionCuller occlusionCuller("../resources/shaders/hiz_vertex_shader.vs", "../resources/shaders/hiz_fragment_shader.fs");
 
-    Texture2D checkerDifTex("../resources/textures/chess_board_diffuse.jpg", DIFFUSE, GL_REPEAT, GL_LINEAR);
-    Texture2D checkerSpecTex("../resources/textures/chess_board_specular.jpg", SPECULAR, GL_REPEAT, GL_LINEAR);
+    AssetHandle<Texture2D> checkerDifTex = assetTexture("../resources/textures/chess_board_diffuse.jpg", DIFFUSE);
+    AssetHandle<Texture2D> checkerSpecTex = assetTexture("../resources/textures/chess_board_specular.jpg", SPECULAR);
 
-    MaterialTexture boardMaterial(256.0f, checkerDifTex, checkerSpecTex);
+    MaterialTexture boardMaterial(256.0f, *checkerDifTex, *checkerSpecTex);
     MaterialColor figureMaterialWhite(256.0f,
                                       glm::vec3(1.0f, 1.0f, 1.0f),
                                       glm::vec3(1.0f, 1.0f, 1.0f),
@@ -110,12 +234,12 @@ int main() {
                         glm::vec3(0.0f, -1.0f, 0.0f),
                         7.5f,1.0f, 0.09f, 0.032f);
 
-    Model pawn("../resources/models/chess/pawn/pawn.obj");
-    Model rook("../resources/models/chess/rook/rook.obj");
-    Model knight("../resources/models/chess/knight/knight.obj");
-    Model bishop("../resources/models/chess/bishop/bishop.obj");
-    Model queen("../resources/models/chess/queen/queen.obj");
-    Model king("../resources/models/chess/king/king.obj");
+    AssetHandle<Model> pawn = assetModel("../resources/models/chess/pawn/pawn.obj");
+    AssetHandle<Model> rook = assetModel("../resources/models/chess/rook/rook.obj");
+    AssetHandle<Model> knight = assetModel("../resources/models/chess/knight/knight.obj");
+    AssetHandle<Model> bishop = assetModel("../resources/models/chess/bishop/bishop.obj");
+    AssetHandle<Model> queen = assetModel("../resources/models/chess/queen/queen.obj");
+    AssetHandle<Model> king = assetModel("../resources/models/chess/king/king.obj");
 
     std::vector<std::string> skyboxFaces = {
             "../resources/skybox/right.jpg",
@@ -125,19 +249,42 @@ int main() {
             "../resources/skybox/front.jpg",
             "../resources/skybox/back.jpg",
     };
-    Skybox skybox(skyboxFaces);
-    skyboxShader.use();
-    skyboxShader.setUniform1i("skybox", 0);
-
-    createChessBoard(&pawn, &rook, &knight, &bishop, &queen, &king);
+    AssetHandle<Skybox> skybox = assetSkybox(skyboxFaces);
+    skyboxShader->use();
+    skyboxShader->setUniform1i("skybox", 0);
+
+    setFigureModels(pawn.get(), rook.get(), knight.get(), bishop.get(), queen.get(), king.get());
+    std::cout << "Loaded " << assetCount() << " assets" << std::endl;
+    memoryReport(std::cout);
+
+    // The network is optional, without one the computer opponent falls back to material and piece placement
+    if(nnueLoad("../resources/nnue/network.nnue"))
+        std::cout << "Computer opponent uses the NNUE evaluation (" << nnueKernels() << " kernels)" << std::endl;
+    // A position given with --fen can have the computer's side to move
+    startComputerMove();
+
+    // Edited shaders, textures and models get rebuilt in the background and swapped in between frames
+    HotReloader hotReloader("../resources");
+    hotReloader.watch(boardShader.get(), "../resources/shaders/board_vertex_shader.vs", "../resources/shaders/board_fragment_shader.fs");
+    hotReloader.watch(lightcubeShader.get(), "../resources/shaders/lightcube_vertex_shader.vs", "../resources/shaders/lightcube_fragment_shader.fs");
+    hotReloader.watch(modelShader.get(), "../resources/shaders/chess_piece_vertex_shader.vs", "../resources/shaders/chess_piece_fragment_shader.fs");
+    hotReloader.watch(skyboxShader.get(), "../resources/shaders/skybox.vs", "../resources/shaders/skybox.fs");
+    hotReloader.watch(checkerDifTex.get(), "../resources/textures/chess_board_diffuse.jpg");
+    hotReloader.watch(checkerSpecTex.get(), "../resources/textures/chess_board_specular.jpg");
+    hotReloader.watch(pawn.get(), "../resources/models/chess/pawn/pawn.obj");
+    hotReloader.watch(rook.get(), "../resources/models/chess/rook/rook.obj");
+    hotReloader.watch(knight.get(), "../resources/models/chess/knight/knight.obj");
+    hotReloader.watch(bishop.get(), "../resources/models/chess/bishop/bishop.obj");
+    hotReloader.watch(queen.get(), "../resources/models/chess/queen/queen.obj");
+    hotReloader.watch(king.get(), "../resources/models/chess/king/king.obj");
 
     Scene scene(camera);
-    scene.addLight(&directionalLight, &boardShader);
-    scene.addLight(&directionalLight, &modelShader);
-    scene.addLight(&pointLight, &boardShader);
-    scene.addLight(&pointLight, &modelShader);
-    scene.addLight(&spotLight, &boardShader);
-    scene.addLight(&spotLight, &modelShader);
+    scene.addLight(&directionalLight, boardShader.get());
+    scene.addLight(&directionalLight, modelShader.get());
+    scene.addLight(&pointLight, boardShader.get());
+    scene.addLight(&pointLight, modelShader.get());
+    scene.addLight(&spotLight, boardShader.get());
+    scene.addLight(&spotLight, modelShader.get());
 
     float boardVertices[] = {
             // Coords           Normals           Texture
@@ -207,18 +354,29 @@ int main() {
 
     glm::mat4 cubeTransform = glm::mat4(1.0);
 
-    scene.addRawMesh(&brd, &boardShader, &boardTransform);
-    scene.addRawMesh(&cub, &lightcubeShader, &cubeTransform);
+    scene.addRawMesh(&brd, boardShader.get(), &boardTransform);
+    scene.addRawMesh(&cub, lightcubeShader.get(), &cubeTransform);
 
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-    glEnable(GL_DEPTH_TEST);
+    stateEnable(GL_DEPTH_TEST);
 
+    // Models and textures were reported after loading, the log follows how that changes
+    double nextMemoryLog = memoryLogInterval;
     while(!glfwWindowShouldClose(window))
     {
-        glfwPollEvents();
-        float currentFrame = glfwGetTime();
+        PROFILE_SCOPE("frame");
+        hotReloader.update();
+        // The clock of a replay is the recorded one, the animations below go by it too
+        double currentFrame = inputPoll(window);
+        applyComputerMove();
+        showTablebaseResult();
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
+        if(memoryLogInterval > 0 && currentFrame >= nextMemoryLog)
+        {
+            memoryReport(std::cout);
+            nextMemoryLog = currentFrame + memoryLogInterval;
+        }
         processInput(window);
         glClearColor(0.2, 0.2, 0.2, 1.0);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -229,50 +387,72 @@ int main() {
 
         view = glm::lookAt(camera.Position, camera.Position + camera.Front, camera.Up);
         projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / SCR_HEIGHT, 0.1f, 100.0f);
+        if(occlusionCuller.isEnabled() != occlusionCulling)
+            occlusionCuller.setEnabled(occlusionCulling);
+        occlusionCuller.beginFrame(projection * view);
 
         float lightSpeedReduction = 5;
         cubeTransform = glm::mat4(1.0);
-        cubeTransform = glm::translate(cubeTransform, glm::vec3(1.75f + 3.0 * cos(glfwGetTime() / lightSpeedReduction), 3.0f, 1.75f + 3.0 * sin(glfwGetTime() / lightSpeedReduction))); // m * T
-        cubeTransform = glm::rotate(cubeTransform, (float)glfwGetTime(), glm::vec3(0.0f, 0.0f, 1.0f)); // m * T * R
+        cubeTransform = glm::translate(cubeTransform, glm::vec3(1.75f + 3.0 * cos(currentFrame / lightSpeedReduction), 3.0f, 1.75f + 3.0 * sin(currentFrame / lightSpeedReduction))); // m * T
+        cubeTransform = glm::rotate(cubeTransform, (float)currentFrame, glm::vec3(0.0f, 0.0f, 1.0f)); // m * T * R
         cubeTransform = glm::scale(cubeTransform, glm::vec3(0.2f, 0.2f, 0.2f)); // m * T * R * S
 
-        pointLight.setPosition(glm::vec3(1.75 + 3.0f * cos(glfwGetTime() / lightSpeedReduction), 3.0f, 1.75 + 3.0f * sin(glfwGetTime() / lightSpeedReduction)));
+        pointLight.setPosition(glm::vec3(1.75 + 3.0f * cos(currentFrame / lightSpeedReduction), 3.0f, 1.75 + 3.0f * sin(currentFrame / lightSpeedReduction)));
 
         // Light up the currently selected field
         spotLight.setPosition(glm::vec3(boardCursor.second * 0.5f, 2.0f, boardCursor.first * 0.5f));
-        spotLight.setDiffuse(glm::vec3((sin(glfwGetTime()) + 1) / 2, 0.5, 0.1));
+        spotLight.setDiffuse(glm::vec3((sin(currentFrame) + 1) / 2, 0.5, 0.1));
 
         scene.render();
 
-        modelShader.use();
-        modelShader.setUniformMatrix4fv("view", view);
-        modelShader.setUniformMatrix4fv("projection", projection);
-        modelShader.setUniform3fv("viewPosition", camera.Position);
-        drawChessBoard(modelShader, figureMaterialWhite, figureMaterialBlack);
-
-        glDepthMask(GL_FALSE);
-        glDepthFunc(GL_LEQUAL);
-        skyboxShader.use();
-        skyboxShader.setUniformMatrix4fv("view", glm::mat4(glm::mat3(view)));
-        skyboxShader.setUniformMatrix4fv("projection", projection);
-        skybox.draw();
-        glDepthMask(GL_TRUE);
-        glDepthFunc(GL_LESS);
+        modelShader->use();
+        modelShader->setUniformMatrix4fv("view", view);
+        modelShader->setUniformMatrix4fv("projection", projection);
+        modelShader->setUniform3fv("viewPosition", camera.Position);
+        drawChessBoard(*modelShader, figureMaterialWhite, figureMaterialBlack, occlusionCuller);
+
+        // Everything opaque is drawn, keep its depth around for culling the figures in the next frames
+        int framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        occlusionCuller.captureDepth(framebufferWidth, framebufferHeight);
+
+        stateDepthMask(GL_FALSE);
+        stateDepthFunc(GL_LEQUAL);
+        skyboxShader->use();
+        skyboxShader->setUniformMatrix4fv("view", glm::mat4(glm::mat3(view)));
+        skyboxShader->setUniformMatrix4fv("projection", projection);
+        skybox->draw();
+        stateDepthMask(GL_TRUE);
+        stateDepthFunc(GL_LESS);
 
         glfwSwapBuffers(window);
+        // Resources released during the frame are deleted once nothing can be drawing with them
+        assetCollect();
+        stateEndFrame();
     }
 
-    skybox.del();
-
-    checkerDifTex.del();
-    checkerSpecTex.del();
-
-    boardShader.del();
-    lightcubeShader.del();
-    modelShader.del();
-    skyboxShader.del();
-
-    destroyChessBoard();
+    inputFinish(std::cout);
+    occlusionCuller.del();
+    brd.del();
+    cub.del();
+
+    // Dropping the last handles lets the registry delete everything while the context is still alive
+    skybox.reset();
+    pawn.reset();
+    rook.reset();
+    knight.reset();
+    bishop.reset();
+    queen.reset();
+    king.reset();
+    checkerDifTex.reset();
+    checkerSpecTex.reset();
+    boardShader.reset();
+    lightcubeShader.reset();
+    modelShader.reset();
+    skyboxShader.reset();
+    assetShutdown();
+    if(profileEnabled())
+        writeTrace();
 
     glfwTerminate();
 
@@ -284,102 +464,226 @@ void framebuffer_size_cb(GLFWwindow *window, int width, int height) {
 }
 
 void processInput(GLFWwindow *window) {
-    if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+    if(inputKeyDown(window, GLFW_KEY_ESCAPE))
         glfwSetWindowShouldClose(window, true);
-    if(glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+    if(inputKeyDown(window, GLFW_KEY_W))
         camera.ProcessKeyboard(FORWARD, deltaTime);
-    if(glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+    if(inputKeyDown(window, GLFW_KEY_S))
         camera.ProcessKeyboard(BACKWARD, deltaTime);
-    if(glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+    if(inputKeyDown(window, GLFW_KEY_A))
         camera.ProcessKeyboard(LEFT, deltaTime);
-    if(glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+    if(inputKeyDown(window, GLFW_KEY_D))
         camera.ProcessKeyboard(RIGHT, deltaTime);
 }
 
 void key_cb(GLFWwindow *window, int key, int scancode, int action, int mods) {
     if(key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
+    if(key == GLFW_KEY_C && action == GLFW_PRESS)
+    {
+        occlusionCulling = !occlusionCulling;
+        std::cout << "Occlusion culling " << (occlusionCulling ? "enabled" : "disabled") << std::endl;
+    }
     if(key == GLFW_KEY_UP && action == GLFW_PRESS)
     {
-        int i = boardCursor.second;
-        int j = boardCursor.first;
         if(boardCursor.first > 0)
-        {
             boardCursor.first--;
-            if (currentlyActive != nullptr)
-                currentlyActive->position = std::make_pair(i, j - 1);
-        }
     }
     if(key == GLFW_KEY_LEFT && action == GLFW_PRESS)
     {
-        int i = boardCursor.second;
-        int j = boardCursor.first;
         if(boardCursor.second > 0)
-        {
             boardCursor.second--;
-            if (currentlyActive != nullptr)
-                currentlyActive->position = std::make_pair(i - 1, j);
-        }
     }
     if(key == GLFW_KEY_RIGHT && action == GLFW_PRESS)
     {
-        int i = boardCursor.second;
-        int j = boardCursor.first;
         if(boardCursor.second < 7)
-        {
             boardCursor.second++;
-            if (currentlyActive != nullptr)
-                currentlyActive->position = std::make_pair(i + 1, j);
-        }
     }
     if(key == GLFW_KEY_DOWN && action == GLFW_PRESS)
     {
-        int i = boardCursor.second;
-        int j = boardCursor.first;
         if(boardCursor.first < 7)
-        {
             boardCursor.first++;
-            if (currentlyActive != nullptr)
-                currentlyActive->position = std::make_pair(i, j + 1);
-        }
     }
     if(key == GLFW_KEY_SPACE && action == GLFW_PRESS)
     {
-        int i = boardCursor.second;
-        int j = boardCursor.first;
-        // If there's an active chess figure and the square isn't occupied, place the chess figure on it
-        if(currentlyActive != nullptr && chessBoard[i][j] == nullptr)
+        int square = cursorSquare();
+        int piece = position.pieceOn(square);
+        // If we don't have an active chess figure and there is a figure of the side to move on the selected square, pick it up
+        if(activeSquare == NO_SQUARE)
         {
-            chessBoard[currentlyActiveRealPos.first][currentlyActiveRealPos.second] = nullptr;
-            chessBoard[i][j] = currentlyActive;
-            currentlyActive->figure_status = INACTIVE;
-            currentlyActive = nullptr;
+            if(piece != NO_PIECE && pieceColor(piece) == position.getSideToMove()
+               && !(computerOpponent && computerColor == position.getSideToMove()))
+                activeSquare = square;
         }
         // If we're returning the active chess figure to its original square, just drop it
-        else if(currentlyActive != nullptr && i == currentlyActiveRealPos.first && j == currentlyActiveRealPos.second)
+        else if(square == activeSquare)
+            activeSquare = NO_SQUARE;
+        // Otherwise the drop has to be a legal move, pawns reaching the last rank become queens
+        else
         {
-            currentlyActive->figure_status = INACTIVE;
-            currentlyActive = nullptr;
+            Move move = findLegalMove(position, activeSquare, square);
+            if(move != NO_MOVE)
+            {
+                position.makeMove(move);
+                activeSquare = NO_SQUARE;
+                startComputerMove();
+            }
+            else
+                std::cout << "Illegal move" << std::endl;
         }
-        // If we don't have an active chess figure and there is a figure on the selected square, pick it up
-        else if(currentlyActive == nullptr && chessBoard[i][j] != nullptr)
+    }
+    if(key == GLFW_KEY_BACKSPACE && action == GLFW_PRESS)
+    {
+        // Take back the last move, a figure that's held is put back first. Against the computer take back
+        // its reply too, so it's the player's turn again
+        activeSquare = NO_SQUARE;
+        engine.stop();
+        if(position.getGamePly() > 0)
+            position.unmakeMove();
+        if(computerOpponent && computerColor == position.getSideToMove() && position.getGamePly() > 0)
+            position.unmakeMove();
+        startComputerMove();
+    }
+    if(key == GLFW_KEY_F && action == GLFW_PRESS)
+    {
+        // Print the position so it can be copied into other tools or passed back with --fen
+        char fen[MAX_FEN_LENGTH];
+        position.getFen(fen);
+        std::cout << fen << std::endl;
+    }
+    if(key == GLFW_KEY_B && action == GLFW_PRESS)
+        printBookMoves();
+    if(key == GLFW_KEY_T && action == GLFW_PRESS)
+        printTablebaseStats();
+    if(key == GLFW_KEY_M && action == GLFW_PRESS)
+        memoryReport(std::cout, true);
+    if(key == GLFW_KEY_G && action == GLFW_PRESS)
+        stateReport(std::cout);
+    if(key == GLFW_KEY_P && action == GLFW_PRESS)
+        writeTrace();
+    if(key == GLFW_KEY_E && action == GLFW_PRESS)
+    {
+        // The computer takes over the side to move, or hands its side back to the player
+        computerOpponent = !computerOpponent;
+        if(computerOpponent)
         {
-            currentlyActive = chessBoard[i][j];
-            currentlyActive->figure_status = ACTIVE;
-            currentlyActiveRealPos = std::make_pair(i, j);
+            computerColor = position.getSideToMove();
+            activeSquare = NO_SQUARE;
+            std::cout << "Computer plays " << (computerColor == WHITE ? "white" : "black") << std::endl;
+            startComputerMove();
         }
-        // If we can capture the figure, delete it and move the active figure to its spot
-        else if(currentlyActive != nullptr && chessBoard[i][j] != nullptr && currentlyActive->figure_color != chessBoard[i][j]->figure_color)
+        else
         {
-            chessBoard[currentlyActiveRealPos.first][currentlyActiveRealPos.second] = nullptr;
-            delete chessBoard[i][j];
-            chessBoard[i][j] = currentlyActive;
-            currentlyActive->figure_status = INACTIVE;
-            currentlyActive = nullptr;
+            engine.stop();
+            std::cout << "Computer opponent disabled" << std::endl;
         }
     }
 }
 
+void startComputerMove() {
+    // A replay plays the moves the computer made in the recording
+    if(!computerOpponent || computerColor != position.getSideToMove() || inputReplaying())
+        return;
+    MoveList moves;
+    generateMoves(position, moves);
+    if(moves.size() == 0)
+        return;
+    Move bookMove = book.weightedMove(position, bookRandom());
+    if(bookMove != NO_MOVE)
+    {
+        position.makeMove(bookMove);
+        inputMove(bookMove);
+        std::cout << "Computer plays " << moveToString(bookMove) << " (book)" << std::endl;
+        return;
+    }
+    // With a table for the position there's nothing left to search
+    MoveList best;
+    TablebaseResult result;
+    if(tbBestMoves(position, best, result) && best.size())
+    {
+        Move move = best.moves[bookRandom() % best.size()];
+        position.makeMove(move);
+        inputMove(move);
+        std::cout << "Computer plays " << moveToString(move) << " (tablebase)" << std::endl;
+        return;
+    }
+    SearchLimits limits;
+    limits.moveTime = computerMoveTime;
+    engine.go(position, limits);
+}
+
+void applyComputerMove() {
+    PROFILE_SCOPE("computer move");
+    SearchReport report;
+    while(engine.poll(report))
+    {
+        // Results of a search the game has moved past, after a take back or a toggle, are thrown away
+        if(!report.finished || !computerOpponent || report.rootKey != position.getKey())
+            continue;
+        Move move = report.bestMove();
+        MoveList moves;
+        generateMoves(position, moves);
+        if(!moves.contains(move))
+            continue;
+        position.makeMove(move);
+        inputMove(move);
+        std::cout << "Computer plays " << moveToString(move) << " (depth " << report.depth << ", score "
+                  << report.score << ")" << std::endl;
+    }
+}
+
+void printBookMoves() {
+    BookMove moves[MAX_MOVES];
+    int count = book.probe(position, moves, MAX_MOVES);
+    if(!count)
+    {
+        std::cout << "Out of book" << std::endl;
+        return;
+    }
+    int total = 0;
+    for(int i = 0; i < count; i++)
+        total += moves[i].weight;
+    std::cout << "Book:";
+    for(int i = 0; i < count; i++)
+        std::cout << " " << moveToString(moves[i].move) << " " << (total ? 100 * moves[i].weight / total : 0) << "%";
+    std::cout << std::endl;
+}
+
+void showTablebaseResult() {
+    if(position.getKey() == tablebaseShownKey)
+        return;
+    MoveList best;
+    TablebaseResult result;
+    if(!tbBestMoves(position, best, result))
+        return;
+    tablebaseShownKey = position.getKey();
+    std::cout << "Tablebase: " << (position.getSideToMove() == WHITE ? "white" : "black");
+    if(result.wdl == TB_WIN)
+        std::cout << " wins, " << result.dtz << " plies to the next capture or pawn move";
+    else if(result.wdl == TB_CURSED_WIN)
+        std::cout << " wins, but the fifty move rule draws it";
+    else if(result.wdl == TB_BLESSED_LOSS)
+        std::cout << " loses, but the fifty move rule draws it";
+    else if(result.wdl == TB_LOSS)
+        std::cout << (best.size() ? " loses, " + std::to_string(-result.dtz) + " plies to the next capture or pawn move" : std::string(" is mated"));
+    else
+        std::cout << " draws";
+    if(best.size())
+    {
+        std::cout << ", best:";
+        for(Move move : best)
+            std::cout << " " << moveToString(move);
+    }
+    std::cout << std::endl;
+}
+
+void printTablebaseStats() {
+    TablebaseStats stats = tbStats();
+    std::cout << "Tablebase probes: " << stats.probes << ", " << stats.cacheHits << " cached, " << stats.tableHits
+              << " from tables, " << (stats.probes ? stats.nanoseconds / stats.probes : 0) << " ns average, "
+              << stats.maps << " maps, " << stats.unmaps << " unmaps, " << (stats.mappedBytes >> 20) << " MB mapped" << std::endl;
+}
+
 void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
     if (firstMouse)
     {
@@ -401,51 +705,55 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
     camera.ProcessMouseScroll(yoffset);
 }
 
-void createChessBoard(Model *pawn, Model *rook, Model *knight, Model *bishop, Model *queen, Model *king) {
-    for(int i = 0; i < 8; i++)
-        chessBoard[i][1] = new ChessFigure(pawn, std::make_pair(i, 1), PAWN, BLACK);
-    chessBoard[0][0] = new ChessFigure(rook, std::make_pair(0, 0), ROOK, BLACK);
-    chessBoard[7][0] = new ChessFigure(rook, std::make_pair(7, 0), ROOK, BLACK);
-    chessBoard[1][0] = new ChessFigure(knight, std::make_pair(1, 0), KNIGHT, BLACK);
-    chessBoard[6][0] = new ChessFigure(knight, std::make_pair(6, 0), KNIGHT, BLACK);
-    chessBoard[2][0] = new ChessFigure(bishop, std::make_pair(2, 0), BISHOP, BLACK);
-    chessBoard[5][0] = new ChessFigure(bishop, std::make_pair(5, 0), BISHOP, BLACK);
-    chessBoard[3][0] = new ChessFigure(queen, std::make_pair(3, 0), QUEEN, BLACK);
-    chessBoard[4][0] = new ChessFigure(king, std::make_pair(4, 0), KING, BLACK);
-
-    for(int i = 0; i < 8; i++)
-        chessBoard[i][6] = new ChessFigure(pawn, std::make_pair(i, 6), PAWN, WHITE);
-    chessBoard[0][7] = new ChessFigure(rook, std::make_pair(0, 7), ROOK, WHITE);
-    chessBoard[7][7] = new ChessFigure(rook, std::make_pair(7, 7), ROOK, WHITE);
-    chessBoard[1][7] = new ChessFigure(knight, std::make_pair(1, 7), KNIGHT, WHITE);
-    chessBoard[6][7] = new ChessFigure(knight, std::make_pair(6, 7), KNIGHT, WHITE);
-    chessBoard[2][7] = new ChessFigure(bishop, std::make_pair(2, 7), BISHOP, WHITE);
-    chessBoard[5][7] = new ChessFigure(bishop, std::make_pair(5, 7), BISHOP, WHITE);
-    chessBoard[3][7] = new ChessFigure(queen, std::make_pair(3, 7), QUEEN, WHITE);
-    chessBoard[4][7] = new ChessFigure(king, std::make_pair(4, 7), KING, WHITE);
+void setFigureModels(Model *pawn, Model *rook, Model *knight, Model *bishop, Model *queen, Model *king) {
+    figureModels[PAWN] = pawn;
+    figureModels[KNIGHT] = knight;
+    figureModels[BISHOP] = bishop;
+    figureModels[ROOK] = rook;
+    figureModels[QUEEN] = queen;
+    figureModels[KING] = king;
 }
 
-void drawChessBoard(Shader &shader, MaterialColor &white, MaterialColor &black) {
-    for(int i = 0; i < 8; i++)
-    {
-        for (int j = 0; j < 8; j++)
-        {
-            if (chessBoard[i][j] != nullptr)
-                chessBoard[i][j]->draw(shader, white, black);
-        }
-    }
+// The cursor counts rows from the top of the board, where the black figures start
+int cursorSquare() {
+    return makeSquare(boardCursor.second, 7 - boardCursor.first);
 }
 
-void destroyChessBoard() {
-    for(int i = 0; i < 8; i++)
+void drawChessBoard(Shader &shader, MaterialColor &white, MaterialColor &black, OcclusionCuller &culler) {
+    PROFILE_SCOPE("draw figures");
+    // Only figures that moved since the last frame get new transforms. Whatever they uncovered isn't in the
+    // depth captured before, so culling waits for a capture of the new layout
+    if(figures.sync(position, activeSquare, std::make_pair(boardCursor.second, boardCursor.first)))
+        culler.invalidate();
+    int materialColor = -1;
+    for(int i = 0; i < figures.size(); i++)
     {
-        for(int j = 0; j < 8; j++)
+        Model *model = figureModels[figures.figureType(i)];
+        // The held figure gets an id of its own, whatever hid it on its square says nothing about it in the air
+        unsigned objectId = figures.figureStatus(i) == ACTIVE ? MAX_FIGURES : figures.handle(i);
+        // Back rank figures are mostly hidden behind the front ones at low camera angles
+        if(!culler.isVisible(objectId, model->boundsMin, model->boundsMax, figures.transform(i)))
+            continue;
+        if(figures.figureColor(i) != materialColor)
         {
-            if(chessBoard[i][j] != nullptr)
-            {
-                delete chessBoard[i][j];
-                chessBoard[i][j] = nullptr;
-            }
+            materialColor = figures.figureColor(i);
+            (materialColor == WHITE ? white : black).activate(shader, "material");
         }
+        shader.setUniformMatrix4fv("model", figures.transform(i));
+        model->draw(shader);
     }
-}
\ No newline at end of file
+}
+
+void replayMove(Move move) {
+    position.makeMove(move);
+    std::cout << "Computer plays " << moveToString(move) << " (recorded)" << std::endl;
+}
+
+void writeTrace() {
+    if(!profileEnabled())
+        std::cout << "Profiling is compiled out, configure with -DRG_3D_SAH_PROFILE=ON" << std::endl;
+    else if(profileWriteTrace(tracePath))
+        std::cout << "Profile written to " << tracePath << std::endl;
+    else
+        std::cerr << "Writing the profile to " << tracePath << " failed" << std::endl;
+}
@@ -0,0 +1,681 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "../classes/PgnReader.h"
+#include "../classes/Evaluation.h"
+#include "../classes/Tablebase.h"
+
+// Plays two UCI engines against each other, one game per core. Every opening is played twice with the colors
+// swapped, and after every such pair a sequential probability ratio test decides whether the first engine is
+// elo1 stronger than the second rather than elo0, stopping the match as soon as it can tell. Moves are checked
+// against our own rules and the games adjudicated by the harness, engines only send moves and scores.
+//
+// Openings come from an EPD or FEN list or from the games of a PGN file, every game written to --pgn as it
+// ends. Engine commands are run by the shell, so they can carry arguments.
+//
+// Usage: rg_3d_sah_match ENGINE1 ENGINE2 [--openings FILE] [--games N] [--concurrency N] [--tc SECONDS+INC]
+//                        [--elo0 N] [--elo1 N] [--alpha N] [--beta N] [--pgn FILE] [--hash MB]
+//                        [--option NAME=VALUE] [--resign CP] [--draw CP] [--tablebases DIR]
+
+struct MatchSettings {
+    std::string commands[2];
+    std::vector<std::string> options;
+    int64_t baseTime = 10000, increment = 100;
+    // Time an engine may overstep its clock by before it forfeits, covers the pipe and scheduling
+    int64_t margin = 50;
+    size_t hashMegabytes = 16;
+    // An engine resigns after three moves below -resignScore with its opponent agreeing, zero turns it off
+    int resignScore = 600;
+    // Both engines within drawScore of zero for eight moves each after move 40 is a draw
+    int drawScore = 10;
+    bool tablebases = false;
+};
+
+// Engine running as a child process, spoken to through pipes
+class UciEngine {
+    pid_t pid;
+    int toEngine, fromEngine;
+    std::string buffer;
+    std::vector<std::string> options;
+public:
+    std::string name;
+
+    UciEngine() : pid{-1}, toEngine{-1}, fromEngine{-1} {
+    }
+    ~UciEngine() {
+        stop();
+    }
+    UciEngine(const UciEngine &) = delete;
+    UciEngine &operator=(const UciEngine &) = delete;
+
+    bool start(const std::string &command) {
+        stop();
+        int in[2], out[2];
+        if(pipe2(in, O_CLOEXEC) != 0)
+            return false;
+        if(pipe2(out, O_CLOEXEC) != 0)
+        {
+            close(in[0]);
+            close(in[1]);
+            return false;
+        }
+        pid = fork();
+        if(pid == 0)
+        {
+            // A process group of its own, so Ctrl-C at the terminal reaches the runner only and it stops the engines
+            setpgid(0, 0);
+            dup2(in[0], STDIN_FILENO);
+            dup2(out[1], STDOUT_FILENO);
+            execl("/bin/sh", "sh", "-c", command.c_str(), (char *)nullptr);
+            _exit(127);
+        }
+        close(in[0]);
+        close(out[1]);
+        toEngine = in[1];
+        fromEngine = out[0];
+        buffer.clear();
+        options.clear();
+        return pid > 0;
+    }
+
+    // Asks the engine to quit and kills it if it doesn't
+    void stop() {
+        if(pid <= 0)
+            return;
+        send("quit");
+        close(toEngine);
+        close(fromEngine);
+        for(int i = 0; i < 20 && waitpid(pid, nullptr, WNOHANG) == 0; i++)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        if(waitpid(pid, nullptr, WNOHANG) == 0)
+        {
+            kill(pid, SIGKILL);
+            waitpid(pid, nullptr, 0);
+        }
+        pid = -1;
+        toEngine = fromEngine = -1;
+    }
+
+    bool running() const {
+        return pid > 0;
+    }
+
+    void send(const std::string &line) {
+        std::string text = line + "\n";
+        if(toEngine >= 0 && write(toEngine, text.data(), text.size()) < 0)
+            return;
+    }
+
+    // Next line from the engine, false on a timeout or when the engine is gone
+    bool readLine(std::string &line, int64_t timeout) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+        while(true)
+        {
+            size_t end = buffer.find('\n');
+            if(end != std::string::npos)
+            {
+                line = buffer.substr(0, end);
+                if(!line.empty() && line.back() == '\r')
+                    line.pop_back();
+                buffer.erase(0, end + 1);
+                return true;
+            }
+            int64_t left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+            pollfd readable = {fromEngine, POLLIN, 0};
+            if(left <= 0 || poll(&readable, 1, (int)left) <= 0)
+                return false;
+            char chunk[4096];
+            ssize_t count = read(fromEngine, chunk, sizeof(chunk));
+            if(count <= 0)
+                return false;
+            buffer.append(chunk, count);
+        }
+    }
+
+    // Handshake and options, the engine's name comes from its id
+    bool initialize(const MatchSettings &settings) {
+        send("uci");
+        std::string line;
+        while(readLine(line, 10000))
+        {
+            std::istringstream tokens(line);
+            std::string token;
+            tokens >> token;
+            if(token == "id" && tokens >> token && token == "name" && name.empty())
+                std::getline(tokens >> std::ws, name);
+            else if(token == "option" && tokens >> token && token == "name")
+            {
+                std::string option;
+                while(tokens >> token && token != "type")
+                    option += (option.empty() ? "" : " ") + token;
+                options.push_back(option);
+            }
+            else if(token == "uciok")
+                break;
+        }
+        if(line != "uciok")
+            return false;
+        if(hasOption("Hash"))
+            send("setoption name Hash value " + std::to_string(settings.hashMegabytes));
+        if(hasOption("Threads"))
+            send("setoption name Threads value 1");
+        for(const std::string &option : settings.options)
+        {
+            size_t equals = option.find('=');
+            send("setoption name " + option.substr(0, equals) + (equals != std::string::npos ? " value " + option.substr(equals + 1) : ""));
+        }
+        return isReady();
+    }
+
+    bool isReady() {
+        send("isready");
+        std::string line;
+        while(readLine(line, 10000))
+            if(line == "readyok")
+                return true;
+        return false;
+    }
+
+    bool hasOption(const std::string &option) const {
+        for(const std::string &o : options)
+            if(o == option)
+                return true;
+        return false;
+    }
+};
+
+struct Opening {
+    std::string fen;
+    std::vector<std::string> moves;
+};
+
+static bool loadOpenings(const std::string &path, std::vector<Opening> &openings) {
+    if(path.size() > 4 && path.compare(path.size() - 4, 4, ".pgn") == 0)
+    {
+        PgnReader reader;
+        if(!reader.open(path.c_str()))
+            return false;
+        std::unique_ptr<Position> replay(new Position());
+        reader.read([&](const PgnGame &game, const Position &) {
+            PgnView fen = game.tag("FEN");
+            Opening opening;
+            if(fen.size())
+            {
+                if(!replay->setFen(fen.str().c_str()))
+                    return;
+                opening.fen = fen.str();
+            }
+            for(int i = 0; i < game.moveCount; i++)
+                opening.moves.push_back(moveToString(game.moves[i]));
+            if(game.error == PGN_OK)
+                openings.push_back(opening);
+        }, 1);
+        return true;
+    }
+
+    // EPD lines have the first four FEN fields and then operations, the move counters start over
+    std::ifstream file(path);
+    if(!file)
+        return false;
+    std::unique_ptr<Position> pos(new Position());
+    std::string line;
+    while(std::getline(file, line))
+    {
+        std::istringstream tokens(line);
+        std::string fields[4], counters[2];
+        if(!(tokens >> fields[0] >> fields[1] >> fields[2] >> fields[3]))
+            continue;
+        std::string fen = fields[0] + " " + fields[1] + " " + fields[2] + " " + fields[3];
+        if(tokens >> counters[0] >> counters[1] && isdigit((unsigned char)counters[0][0]) && isdigit((unsigned char)counters[1][0]))
+            fen += " " + counters[0] + " " + counters[1];
+        char normalized[MAX_FEN_LENGTH];
+        if(pos->setFen(fen.c_str()) && pos->getFen(normalized))
+            openings.push_back({normalized, {}});
+    }
+    return true;
+}
+
+static const char START_FEN[] = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+struct GameRecord {
+    // Points of the first engine: 0, 1 or 2 half points
+    int score;
+    std::string result;
+    std::string termination;
+    std::string pgn;
+};
+
+static bool insufficientMaterial(const Position &pos) {
+    Bitboard heavy = 0;
+    for(color c : {BLACK, WHITE})
+        heavy |= pos.getPieces(c, PAWN) | pos.getPieces(c, ROOK) | pos.getPieces(c, QUEEN);
+    return !heavy && popCount(pos.getOccupancy()) <= 3;
+}
+
+static int moveScore(const std::string &info, int previous) {
+    std::istringstream tokens(info);
+    std::string token;
+    while(tokens >> token)
+    {
+        if(token != "score")
+            continue;
+        std::string kind;
+        int value;
+        if(!(tokens >> kind >> value))
+            return previous;
+        if(kind == "cp")
+            return value;
+        if(kind == "mate")
+            return value > 0 ? VALUE_MATE - 2 * value : -VALUE_MATE - 2 * value;
+    }
+    return previous;
+}
+
+static std::string movetext(const Opening &opening, const std::vector<std::string> &moves, const std::string &result) {
+    std::unique_ptr<Position> pos(new Position());
+    pos->setFen(opening.fen.empty() ? START_FEN : opening.fen.c_str());
+    std::string text, line;
+    for(size_t i = 0; i < moves.size(); i++)
+    {
+        Move m = parseMove(*pos, moves[i]);
+        std::string token;
+        if(pos->getSideToMove() == WHITE || i == 0)
+            token = std::to_string(pos->getFullmoveNumber()) + (pos->getSideToMove() == WHITE ? ". " : "... ");
+        token += moveToSan(*pos, m);
+        pos->makeMove(m);
+        if(line.size() + token.size() + 1 > 80)
+        {
+            text += line + "\n";
+            line.clear();
+        }
+        line += (line.empty() ? "" : " ") + token;
+    }
+    if(line.size() + result.size() + 1 > 80)
+    {
+        text += line + "\n";
+        line.clear();
+    }
+    return text + line + (line.empty() ? "" : " ") + result + "\n";
+}
+
+// Set by Ctrl-C, games still running are abandoned and not scored
+static std::atomic<bool> interrupted(false);
+
+static void onInterrupt(int) {
+    interrupted = true;
+}
+
+// Plays one game, engines[0] is the first engine. Returns false if an engine has to be restarted
+static bool playGame(UciEngine *engines[2], bool firstIsWhite, const Opening &opening, const MatchSettings &settings,
+                     int round, GameRecord &record) {
+    std::unique_ptr<Position> pos(new Position());
+    pos->setFen(opening.fen.empty() ? START_FEN : opening.fen.c_str());
+    std::vector<std::string> moves;
+    for(const std::string &text : opening.moves)
+    {
+        Move m = parseMove(*pos, text);
+        if(m == NO_MOVE)
+            break;
+        pos->makeMove(m);
+        moves.push_back(text);
+    }
+    size_t openingLength = moves.size();
+    for(int e = 0; e < 2; e++)
+    {
+        engines[e]->send("ucinewgame");
+        engines[e]->isReady();
+    }
+
+    // Engines by color, clocks in milliseconds
+    UciEngine *players[2];
+    players[WHITE] = engines[firstIsWhite ? 0 : 1];
+    players[BLACK] = engines[firstIsWhite ? 1 : 0];
+    int64_t clocks[2] = {settings.baseTime, settings.baseTime};
+    int scores[2] = {0, 0};
+    int resignCount[2] = {0, 0}, winningCount[2] = {0, 0}, drawCount = 0;
+    int winner = -1;
+    bool healthy = true;
+    std::string termination;
+    while(true)
+    {
+        if(interrupted)
+        {
+            termination = "interrupted";
+            break;
+        }
+        color us = pos->getSideToMove();
+        MoveList legal;
+        generateMoves(*pos, legal);
+        if(!legal.size())
+        {
+            winner = pos->inCheck() ? !us : -1;
+            termination = pos->inCheck() ? "checkmate" : "stalemate";
+            break;
+        }
+        if(pos->getHalfmoveClock() >= 100)
+        {
+            termination = "fifty move rule";
+            break;
+        }
+        if(pos->repetitions() >= 2)
+        {
+            termination = "threefold repetition";
+            break;
+        }
+        if(insufficientMaterial(*pos))
+        {
+            termination = "insufficient material";
+            break;
+        }
+        // Cursed wins and blessed losses are draws under the fifty move rule the harness plays by
+        int wdl;
+        if(settings.tablebases && tbProbeWdl(*pos, wdl))
+        {
+            winner = wdl == TB_WIN ? us : wdl == TB_LOSS ? !us : -1;
+            termination = "tablebase";
+            break;
+        }
+        if(pos->getGamePly() >= MAX_GAME_PLY - 1)
+        {
+            termination = "game too long";
+            break;
+        }
+
+        std::string command = "position fen " + std::string(opening.fen.empty() ? START_FEN : opening.fen);
+        if(!moves.empty())
+            command += " moves";
+        for(const std::string &m : moves)
+            command += " " + m;
+        players[us]->send(command);
+        players[us]->send("go wtime " + std::to_string(clocks[WHITE]) + " btime " + std::to_string(clocks[BLACK])
+                          + " winc " + std::to_string(settings.increment) + " binc " + std::to_string(settings.increment));
+        auto start = std::chrono::steady_clock::now();
+        std::string line, best;
+        while(best.empty() && players[us]->readLine(line, clocks[us] + settings.margin
+                - std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count()))
+        {
+            if(line.compare(0, 5, "info ") == 0)
+                scores[us] = moveScore(line, scores[us]);
+            else if(line.compare(0, 9, "bestmove ") == 0)
+                best = line.substr(9, line.find(' ', 9) - 9);
+        }
+        clocks[us] -= std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        if(best.empty() || clocks[us] < -settings.margin)
+        {
+            winner = !us;
+            termination = best.empty() && clocks[us] >= -settings.margin ? "engine disconnected" : "time forfeit";
+            healthy = false;
+            break;
+        }
+        clocks[us] = std::max<int64_t>(clocks[us], 0) + settings.increment;
+        Move move = parseMove(*pos, best);
+        if(move == NO_MOVE)
+        {
+            winner = !us;
+            termination = "illegal move " + best;
+            break;
+        }
+        pos->makeMove(move);
+        moves.push_back(best);
+
+        // Adjudication by the scores the engines agree on
+        resignCount[us] = settings.resignScore && scores[us] <= -settings.resignScore ? resignCount[us] + 1 : 0;
+        winningCount[us] = settings.resignScore && scores[us] >= settings.resignScore ? winningCount[us] + 1 : 0;
+        drawCount = settings.drawScore && pos->getFullmoveNumber() > 40 && std::abs(scores[us]) <= settings.drawScore ? drawCount + 1 : 0;
+        if(resignCount[us] >= 3 && winningCount[!us] >= 3)
+        {
+            winner = !us;
+            termination = "adjudication";
+        }
+        else if(drawCount >= 16)
+            termination = "adjudication";
+        if(!termination.empty())
+            break;
+    }
+
+    std::string result = winner == WHITE ? "1-0" : winner == BLACK ? "0-1" : "1/2-1/2";
+    record.result = result;
+    record.termination = termination;
+    record.score = winner < 0 ? 1 : (winner == WHITE) == firstIsWhite ? 2 : 0;
+
+    char date[16];
+    time_t now = time(nullptr);
+    strftime(date, sizeof(date), "%Y.%m.%d", localtime(&now));
+    std::ostringstream pgn;
+    pgn << "[Event \"rg_3d_sah match\"]\n[Site \"?\"]\n[Date \"" << date << "\"]\n[Round \"" << round << "\"]\n"
+        << "[White \"" << players[WHITE]->name << "\"]\n[Black \"" << players[BLACK]->name << "\"]\n"
+        << "[Result \"" << result << "\"]\n[TimeControl \"" << settings.baseTime / 1000.0 << "+" << settings.increment / 1000.0 << "\"]\n"
+        << "[PlyCount \"" << moves.size() << "\"]\n[Termination \"" << termination << "\"]\n";
+    if(!opening.fen.empty())
+        pgn << "[SetUp \"1\"]\n[FEN \"" << opening.fen << "\"]\n";
+    pgn << "\n" << movetext(opening, moves, "{" + termination + ", book " + std::to_string(openingLength) + " plies} " + result) << "\n";
+    record.pgn = pgn.str();
+    return healthy;
+}
+
+// Log likelihood ratio of elo1 against elo0 from the game pairs, with the pair scores 0, 1/4, ... 1 taken as
+// normally distributed
+static double sprtLlr(const uint64_t pairs[5], double elo0, double elo1) {
+    double count = 0, mean = 0, variance = 0;
+    for(int i = 0; i < 5; i++)
+    {
+        count += pairs[i];
+        mean += pairs[i] * i / 4.0;
+    }
+    if(!count)
+        return 0;
+    mean /= count;
+    for(int i = 0; i < 5; i++)
+        variance += pairs[i] * (i / 4.0 - mean) * (i / 4.0 - mean);
+    variance /= count;
+    if(variance <= 0)
+        return 0;
+    double s0 = 1 / (1 + std::pow(10.0, -elo0 / 400)), s1 = 1 / (1 + std::pow(10.0, -elo1 / 400));
+    return count * (s1 - s0) * (2 * mean - s0 - s1) / (2 * variance);
+}
+
+static double scoreToElo(double score) {
+    score = std::min(std::max(score, 1e-6), 1 - 1e-6);
+    return -400 * std::log10(1 / score - 1);
+}
+
+int main(int argc, char **argv) {
+    MatchSettings settings;
+    std::string openingsPath, pgnPath = "match.pgn", tablebasePath;
+    int games = 2000;
+    int concurrency = std::max(1u, std::thread::hardware_concurrency());
+    double elo0 = 0, elo1 = 5, alpha = 0.05, beta = 0.05;
+    int commandCount = 0;
+    bool usage = false;
+    for(int i = 1; i < argc && !usage; i++)
+    {
+        std::string arg = argv[i];
+        if(arg == "--openings" && i + 1 < argc)
+            openingsPath = argv[++i];
+        else if(arg == "--games" && i + 1 < argc)
+            games = std::max(2, std::atoi(argv[++i]));
+        else if(arg == "--concurrency" && i + 1 < argc)
+            concurrency = std::max(1, std::atoi(argv[++i]));
+        else if(arg == "--tc" && i + 1 < argc)
+        {
+            std::string tc = argv[++i];
+            size_t plus = tc.find('+');
+            settings.baseTime = (int64_t)(std::atof(tc.c_str()) * 1000);
+            settings.increment = plus != std::string::npos ? (int64_t)(std::atof(tc.c_str() + plus + 1) * 1000) : 0;
+            usage = settings.baseTime <= 0;
+        }
+        else if(arg == "--elo0" && i + 1 < argc)
+            elo0 = std::atof(argv[++i]);
+        else if(arg == "--elo1" && i + 1 < argc)
+            elo1 = std::atof(argv[++i]);
+        else if(arg == "--alpha" && i + 1 < argc)
+            alpha = std::atof(argv[++i]);
+        else if(arg == "--beta" && i + 1 < argc)
+            beta = std::atof(argv[++i]);
+        else if(arg == "--pgn" && i + 1 < argc)
+            pgnPath = argv[++i];
+        else if(arg == "--hash" && i + 1 < argc)
+            settings.hashMegabytes = std::max(1ul, std::strtoul(argv[++i], nullptr, 10));
+        else if(arg == "--option" && i + 1 < argc)
+            settings.options.push_back(argv[++i]);
+        else if(arg == "--resign" && i + 1 < argc)
+            settings.resignScore = std::max(0, std::atoi(argv[++i]));
+        else if(arg == "--draw" && i + 1 < argc)
+            settings.drawScore = std::max(0, std::atoi(argv[++i]));
+        else if(arg == "--tablebases" && i + 1 < argc)
+            tablebasePath = argv[++i];
+        else if(arg[0] != '-' && commandCount < 2)
+            settings.commands[commandCount++] = arg;
+        else
+            usage = true;
+    }
+    if(usage || commandCount < 2 || alpha <= 0 || beta <= 0 || alpha + beta >= 1)
+    {
+        std::cerr << "Usage: " << argv[0] << " ENGINE1 ENGINE2 [--openings FILE] [--games N] [--concurrency N] [--tc SECONDS+INC]" << std::endl
+                  << "       [--elo0 N] [--elo1 N] [--alpha N] [--beta N] [--pgn FILE] [--hash MB] [--option NAME=VALUE]" << std::endl
+                  << "       [--resign CP] [--draw CP] [--tablebases DIR]" << std::endl;
+        return 2;
+    }
+
+    std::vector<Opening> openings;
+    if(!openingsPath.empty() && !loadOpenings(openingsPath, openings))
+    {
+        std::cerr << "Failed to read " << openingsPath << std::endl;
+        return 1;
+    }
+    if(openings.empty())
+    {
+        if(!openingsPath.empty())
+            std::cerr << "No openings in " << openingsPath << std::endl;
+        openings.push_back(Opening());
+    }
+    if(!tablebasePath.empty())
+        settings.tablebases = tbInit(tablebasePath) > 0;
+    FILE *pgn = fopen(pgnPath.c_str(), "ab");
+    if(!pgn)
+    {
+        std::cerr << "Failed to write " << pgnPath << std::endl;
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, onInterrupt);
+
+    double lowerBound = std::log(beta / (1 - alpha)), upperBound = std::log((1 - beta) / alpha);
+    int pairCount = (games + 1) / 2;
+    concurrency = std::min(concurrency, pairCount);
+    std::atomic<int> nextPair(0);
+    std::atomic<bool> decided(false);
+    std::mutex resultMutex;
+    uint64_t pairs[5] = {}, wins = 0, draws = 0, losses = 0;
+    std::string verdict;
+    std::atomic<bool> failed(false);
+
+    auto worker = [&]() {
+        UciEngine first, second;
+        UciEngine *engines[2] = {&first, &second};
+        int pair;
+        while(!decided && !interrupted && !failed && (pair = nextPair++) < pairCount)
+        {
+            int pairScore = 0;
+            GameRecord records[2];
+            for(int game = 0; game < 2; game++)
+            {
+                for(int e = 0; e < 2; e++)
+                {
+                    if(engines[e]->running())
+                        continue;
+                    engines[e]->name.clear();
+                    if(!engines[e]->start(settings.commands[e]) || !engines[e]->initialize(settings))
+                    {
+                        std::lock_guard<std::mutex> lock(resultMutex);
+                        std::cerr << "Failed to start " << settings.commands[e] << std::endl;
+                        failed = true;
+                        return;
+                    }
+                }
+                // Two builds of the same engine go by the same name, the games have to tell them apart
+                if(first.name == second.name)
+                {
+                    first.name += " 1";
+                    second.name += " 2";
+                }
+                if(!playGame(engines, game == 0, openings[pair % openings.size()], settings, 2 * pair + game + 1, records[game]))
+                {
+                    first.stop();
+                    second.stop();
+                }
+                pairScore += records[game].score;
+            }
+            // A pair cut short by Ctrl-C says nothing about the engines, it's left out of the PGN and the statistics
+            if(interrupted)
+                return;
+
+            std::lock_guard<std::mutex> lock(resultMutex);
+            for(const GameRecord &record : records)
+            {
+                fputs(record.pgn.c_str(), pgn);
+                wins += record.score == 2;
+                draws += record.score == 1;
+                losses += record.score == 0;
+            }
+            fflush(pgn);
+            pairs[pairScore]++;
+            double llr = sprtLlr(pairs, elo0, elo1);
+            uint64_t played = wins + draws + losses;
+            double score = (wins + draws / 2.0) / played;
+            std::cout << "Games " << played << ": +" << wins << " =" << draws << " -" << losses << ", elo "
+                      << std::fixed << std::setprecision(1) << scoreToElo(score) << ", LLR " << std::setprecision(2) << llr
+                      << " [" << lowerBound << ", " << upperBound << "]" << std::endl;
+            if(verdict.empty() && (llr >= upperBound || llr <= lowerBound))
+            {
+                verdict = llr >= upperBound ? "H1 accepted: " + first.name + " is stronger" : "H0 accepted: no gain of elo1";
+                decided = true;
+            }
+        }
+    };
+    std::vector<std::thread> pool;
+    for(int t = 0; t < concurrency; t++)
+        pool.emplace_back(worker);
+    for(std::thread &t : pool)
+        t.join();
+    fclose(pgn);
+    if(failed)
+        return 1;
+
+    uint64_t played = wins + draws + losses, pairsPlayed = 0;
+    double mean = 0, variance = 0;
+    for(int i = 0; i < 5; i++)
+    {
+        pairsPlayed += pairs[i];
+        mean += pairs[i] * i / 4.0;
+    }
+    mean /= std::max<uint64_t>(pairsPlayed, 1);
+    for(int i = 0; i < 5; i++)
+        variance += pairs[i] * (i / 4.0 - mean) * (i / 4.0 - mean);
+    double error = 1.96 * std::sqrt(variance / std::max<uint64_t>(pairsPlayed, 1)) / std::sqrt(std::max<uint64_t>(pairsPlayed, 1));
+    std::cout << "Score of " << settings.commands[0] << " vs " << settings.commands[1] << ": +" << wins << " =" << draws << " -" << losses << " in " << played
+              << " games, elo " << std::fixed << std::setprecision(1) << scoreToElo(mean) << " +/- "
+              << (scoreToElo(std::min(mean + error, 1.0)) - scoreToElo(std::max(mean - error, 0.0))) / 2 << std::endl
+              << "Pentanomial " << pairs[0] << " " << pairs[1] << " " << pairs[2] << " " << pairs[3] << " " << pairs[4]
+              << ", SPRT elo0 " << elo0 << " elo1 " << elo1 << ": " << (verdict.empty() ? "inconclusive" : verdict) << std::endl;
+    return 0;
+}
@@ -0,0 +1,206 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <memory>
+
+#include "../classes/Position.h"
+#include "../classes/MoveGen.h"
+#include "../classes/TranspositionTable.h"
+
+// Counts the leaves of the legal move tree, the standard way of validating and timing a move generator.
+//
+// Usage: rg_3d_sah_perft [--fen "<fen>"] [--depth N] [--divide] [--threads N] [--hash MB] [--suite]
+
+struct ReferencePosition {
+    const char *name;
+    const char *fen;
+    int depth;
+    uint64_t nodes[8];
+};
+
+// Well known positions with published node counts, indexed by depth - 1
+const ReferencePosition referencePositions[] = {
+        {"start", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 6,
+                {20, 400, 8902, 197281, 4865609, 119060324, 3195901860ULL}},
+        {"kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 5,
+                {48, 2039, 97862, 4085603, 193690690, 8031647685ULL}},
+        {"position 3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 6,
+                {14, 191, 2812, 43238, 674624, 11030083, 178633661}},
+        {"position 4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 5,
+                {6, 264, 9467, 422333, 15833292, 706045033}},
+        {"position 5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 5,
+                {44, 1486, 62379, 2103487, 89941194}},
+        {"position 6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 5,
+                {46, 2079, 89890, 3894594, 164075551, 6923051137ULL}},
+};
+
+// Positions setFen has to refuse, anything it lets through ends up in move generation and the search
+const char *const rejectedFens[] = {
+        "4k3/8/8/8/8/8/8/8 w - - 0 1",
+        "4k3/8/8/8/8/8/8/3KK3 w - - 0 1",
+        "4k3/8/8/8/8/8/8/P3K3 w - - 0 1",
+        "4k3/8/8/8/8/N7/PPPPPPPP/NNNNKNNN w - - 0 1",
+        "4k3/4R3/8/8/8/8/8/4K3 w - - 0 1",
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR x KQkq - 0 1",
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBN w KQkq - 0 1",
+};
+
+uint64_t perft(Position &pos, int depth, TranspositionTable *hash);
+uint64_t runPerft(const Position &root, int depth, int threads, TranspositionTable *hash, bool divide);
+int runSuite(int maxDepth, int threads, size_t hashMegabytes);
+
+int main(int argc, char **argv) {
+    std::string fen = referencePositions[0].fen;
+    int depth = 5;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t hashMegabytes = 0;
+    bool divide = false, suite = false, depthGiven = false;
+
+    for(int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if(arg == "--fen" && i + 1 < argc)
+            fen = argv[++i];
+        else if(arg == "--depth" && i + 1 < argc)
+        {
+            depth = std::atoi(argv[++i]);
+            depthGiven = true;
+        }
+        else if(arg == "--threads" && i + 1 < argc)
+            threads = std::max(1, std::atoi(argv[++i]));
+        else if(arg == "--hash" && i + 1 < argc)
+            hashMegabytes = std::strtoul(argv[++i], nullptr, 10);
+        else if(arg == "--divide")
+            divide = true;
+        else if(arg == "--suite")
+            suite = true;
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--fen \"<fen>\"] [--depth N] [--divide] [--threads N] [--hash MB] [--suite]" << std::endl;
+            return 2;
+        }
+    }
+
+    if(suite)
+        return runSuite(depthGiven ? depth : 0, threads, hashMegabytes);
+
+    Position pos;
+    if(!pos.setFen(fen.c_str()))
+    {
+        std::cerr << "Invalid FEN: " << fen << std::endl;
+        return 2;
+    }
+    std::unique_ptr<TranspositionTable> hash(hashMegabytes ? new TranspositionTable(hashMegabytes) : nullptr);
+    auto start = std::chrono::steady_clock::now();
+    uint64_t nodes = runPerft(pos, depth, threads, hash.get(), divide);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Nodes: " << nodes << std::endl;
+    std::cout << "Time: " << std::fixed << std::setprecision(3) << seconds << " s, "
+              << std::setprecision(1) << nodes / seconds / 1e6 << " Mnps" << std::endl;
+    if(hash)
+        std::cout << "Hash: " << hash->getSizeMegabytes() << " MB, " << hash->hashfull() / 10.0 << "% full" << std::endl;
+    return 0;
+}
+
+// Subtree counts are shared by all threads through the lock-free transposition table
+uint64_t perft(Position &pos, int depth, TranspositionTable *hash) {
+    if(depth == 0)
+        return 1;
+    uint64_t nodes = 0;
+    if(hash && depth > 1 && hash->probeCount(pos.getKey(), depth, nodes))
+        return nodes;
+    MoveList list;
+    generateMoves(pos, list);
+    // Bulk counting, the moves of the last ply don't have to be made
+    if(depth == 1)
+        return list.size();
+
+    for(Move m : list)
+    {
+        if(hash && depth > 2)
+            hash->prefetch(pos.keyAfter(m));
+        pos.makeMove(m);
+        nodes += perft(pos, depth - 1, hash);
+        pos.unmakeMove();
+    }
+    if(hash)
+        hash->storeCount(pos.getKey(), depth, nodes);
+    return nodes;
+}
+
+// Root moves are handed out to the worker threads one at a time, every thread searches on its own copy
+uint64_t runPerft(const Position &root, int depth, int threads, TranspositionTable *hash, bool divide) {
+    MoveList rootMoves;
+    generateMoves(root, rootMoves);
+    if(depth <= 1 && !divide)
+        return depth == 0 ? 1 : rootMoves.size();
+
+    std::vector<uint64_t> counts(rootMoves.size(), 0);
+    std::atomic<int> nextMove(0);
+    auto worker = [&]() {
+        std::unique_ptr<Position> pos(new Position(root));
+        int i;
+        while((i = nextMove++) < rootMoves.size())
+        {
+            pos->makeMove(rootMoves.moves[i]);
+            counts[i] = perft(*pos, depth - 1, hash);
+            pos->unmakeMove();
+        }
+    };
+    std::vector<std::thread> pool;
+    for(int t = 1; t < std::min(threads, rootMoves.size()); t++)
+        pool.emplace_back(worker);
+    worker();
+    for(std::thread &t : pool)
+        t.join();
+
+    uint64_t nodes = 0;
+    for(int i = 0; i < rootMoves.size(); i++)
+    {
+        if(divide)
+            std::cout << moveToString(rootMoves.moves[i]) << ": " << counts[i] << std::endl;
+        nodes += counts[i];
+    }
+    return nodes;
+}
+
+int runSuite(int maxDepth, int threads, size_t hashMegabytes) {
+    int failures = 0;
+    uint64_t totalNodes = 0;
+    double totalSeconds = 0;
+    for(const ReferencePosition &ref : referencePositions)
+    {
+        Position pos;
+        pos.setFen(ref.fen);
+        int depth = maxDepth > 0 ? std::min(maxDepth, ref.depth) : ref.depth;
+        // A fresh table per position so no result leans on an earlier one
+        std::unique_ptr<TranspositionTable> hash(hashMegabytes ? new TranspositionTable(hashMegabytes) : nullptr);
+        auto start = std::chrono::steady_clock::now();
+        uint64_t nodes = runPerft(pos, depth, threads, hash.get(), false);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        bool ok = nodes == ref.nodes[depth - 1];
+        failures += !ok;
+        totalNodes += nodes;
+        totalSeconds += seconds;
+        std::cout << std::left << std::setw(12) << ref.name << " depth " << depth << std::right
+                  << std::setw(12) << nodes << (ok ? "  ok  " : "  FAIL") << " expected " << std::setw(12) << ref.nodes[depth - 1]
+                  << std::fixed << std::setprecision(3) << std::setw(9) << seconds << " s"
+                  << std::setprecision(1) << std::setw(8) << nodes / seconds / 1e6 << " Mnps" << std::endl;
+    }
+    for(const char *fen : rejectedFens)
+    {
+        Position pos;
+        bool ok = !pos.setFen(fen);
+        failures += !ok;
+        std::cout << (ok ? "rejected      " : "FAIL accepted ") << fen << std::endl;
+    }
+    std::cout << "Total " << totalNodes << " nodes in " << std::setprecision(3) << totalSeconds << " s, "
+              << std::setprecision(1) << totalNodes / totalSeconds / 1e6 << " Mnps, "
+              << failures << " failed" << std::endl;
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,75 @@
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <cstdlib>
+
+#include "../classes/PgnReader.h"
+
+// Replays every game of a PGN database, checking each move against the rules, and reports how fast it went.
+//
+// Usage: rg_3d_sah_pgn FILE [--threads N] [--errors N]
+
+int main(int argc, char **argv) {
+    const char *path = nullptr;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    int maxErrors = 10;
+    for(int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if(arg == "--threads" && i + 1 < argc)
+            threads = std::max(1, std::atoi(argv[++i]));
+        else if(arg == "--errors" && i + 1 < argc)
+            maxErrors = std::max(0, std::atoi(argv[++i]));
+        else if(!path && arg[0] != '-')
+            path = argv[i];
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " FILE [--threads N] [--errors N]" << std::endl;
+            return 2;
+        }
+    }
+    if(!path)
+    {
+        std::cerr << "Usage: " << argv[0] << " FILE [--threads N] [--errors N]" << std::endl;
+        return 2;
+    }
+
+    PgnReader reader;
+    if(!reader.open(path))
+    {
+        std::cerr << "Failed to read " << path << std::endl;
+        return 1;
+    }
+
+    std::atomic<uint64_t> whiteWins(0), blackWins(0), draws(0);
+    std::atomic<int> errorsShown(0);
+    std::mutex outputMutex;
+    auto start = std::chrono::steady_clock::now();
+    PgnStats stats = reader.read([&](const PgnGame &game, const Position &) {
+        if(game.result.equals("1-0"))
+            whiteWins++;
+        else if(game.result.equals("0-1"))
+            blackWins++;
+        else if(game.result.equals("1/2-1/2"))
+            draws++;
+        if(game.error != PGN_OK && errorsShown++ < maxErrors)
+        {
+            std::lock_guard<std::mutex> lock(outputMutex);
+            std::cout << "Byte " << game.text.begin - reader.begin() << ", " << game.tag("White").str() << " - "
+                      << game.tag("Black").str() << ": " << (game.error == BAD_FEN ? "bad FEN " : game.error == ILLEGAL_MOVE
+                      ? "illegal move " : "too many moves at ") << game.errorToken.str() << " after " << game.moveCount
+                      << " plies" << std::endl;
+        }
+    }, threads);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << stats.games << " games, " << stats.plies << " plies, " << stats.errors << " with errors" << std::endl;
+    std::cout << "White won " << whiteWins << ", black won " << blackWins << ", drawn " << draws << std::endl;
+    std::cout << std::fixed << std::setprecision(3) << seconds << " s, " << std::setprecision(2)
+              << reader.getSize() / seconds / (1 << 20) << " MB/s, " << std::setprecision(0)
+              << stats.games / seconds * 60 << " games/min, " << stats.plies / seconds << " plies/s" << std::endl;
+    return 0;
+}
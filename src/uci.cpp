@@ -0,0 +1,286 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+#include "../classes/Engine.h"
+#include "../classes/Nnue.h"
+
+// Headless engine speaking the UCI protocol over stdin/stdout.
+//
+// A dedicated I/O thread reads and executes the commands. Nothing it does waits for the search, so a stop
+// reaches the search threads as soon as the line is read. The main thread prints the engine's reports.
+
+const size_t DEFAULT_HASH = 16;
+const size_t MAX_HASH = 65536;
+const int MAX_THREADS = 512;
+// Kept back from every time budget for the GUI and the pipe
+const int64_t MOVE_OVERHEAD = 30;
+
+Engine *engine;
+std::atomic<bool> quit(false);
+
+// Everything written to stdout goes through here, both threads print
+std::mutex outputMutex;
+// An infinite or ponder search must not announce its move before it's told to stop, a result that comes in
+// earlier is held back until then
+bool holdBestMove = false;
+bool bestMovePending = false;
+SearchReport pendingReport;
+
+void send(const std::string &line) {
+    std::cout << line << std::endl;
+}
+
+std::string formatScore(int score) {
+    if(std::abs(score) >= VALUE_MATE_IN_MAX_PLY)
+    {
+        int moves = score > 0 ? (VALUE_MATE - score + 1) / 2 : -(VALUE_MATE + score) / 2;
+        return "mate " + std::to_string(moves);
+    }
+    return "cp " + std::to_string(score);
+}
+
+void sendInfo(const SearchReport &report) {
+    std::ostringstream line;
+    line << "info depth " << report.depth << " score " << formatScore(report.score) << " nodes " << report.nodes
+         << " nps " << (report.elapsed > 0 ? report.nodes * 1000 / report.elapsed : report.nodes)
+         << " hashfull " << report.hashfull << " time " << report.elapsed << " pv";
+    for(int i = 0; i < report.pvLength; i++)
+        line << " " << moveToString(report.pv[i]);
+    send(line.str());
+}
+
+void sendBestMove(const SearchReport &report) {
+    std::string line = "bestmove " + (report.pvLength > 0 ? moveToString(report.bestMove()) : std::string("0000"));
+    if(report.pvLength > 1)
+        line += " ponder " + moveToString(report.pv[1]);
+    send(line);
+}
+
+// Lets a held back result through, called on stop and ponderhit
+void releaseBestMove() {
+    std::lock_guard<std::mutex> lock(outputMutex);
+    holdBestMove = false;
+    if(bestMovePending)
+    {
+        sendBestMove(pendingReport);
+        bestMovePending = false;
+    }
+}
+
+void setPosition(Position &pos, std::istringstream &input) {
+    std::string token, fen;
+    input >> token;
+    if(token == "startpos")
+    {
+        pos.setStartPosition();
+        input >> token;
+    }
+    else if(token == "fen")
+    {
+        while(input >> token && token != "moves")
+            fen += token + " ";
+        if(!pos.setFen(fen.c_str()))
+        {
+            std::lock_guard<std::mutex> lock(outputMutex);
+            send("info string invalid fen " + fen);
+            pos.setStartPosition();
+            return;
+        }
+    }
+    else
+        return;
+    // token is "moves" now if any follow
+    while(input >> token)
+    {
+        // The move stack has to keep room for the search
+        if(pos.getGamePly() >= MAX_GAME_PLY - 1)
+        {
+            std::lock_guard<std::mutex> lock(outputMutex);
+            send("info string game too long, ignoring the moves from " + token);
+            return;
+        }
+        Move m = parseMove(pos, token);
+        if(m == NO_MOVE)
+        {
+            std::lock_guard<std::mutex> lock(outputMutex);
+            send("info string illegal move " + token);
+            return;
+        }
+        pos.makeMove(m);
+    }
+}
+
+void go(const Position &pos, std::istringstream &input) {
+    SearchLimits limits;
+    int64_t time[2] = {0, 0}, increment[2] = {0, 0};
+    int movesToGo = 0;
+    bool infinite = false;
+    std::string token;
+    while(input >> token)
+    {
+        if(token == "wtime")
+            input >> time[WHITE];
+        else if(token == "btime")
+            input >> time[BLACK];
+        else if(token == "winc")
+            input >> increment[WHITE];
+        else if(token == "binc")
+            input >> increment[BLACK];
+        else if(token == "movestogo")
+            input >> movesToGo;
+        else if(token == "movetime")
+            input >> limits.moveTime;
+        else if(token == "depth")
+            input >> limits.depth;
+        else if(token == "nodes")
+            input >> limits.nodes;
+        else if(token == "infinite")
+            infinite = true;
+        else if(token == "ponder")
+            limits.ponder = true;
+    }
+    limits.depth = std::max(1, std::min(limits.depth, MAX_PLY - 1));
+
+    color us = pos.getSideToMove();
+    if(limits.moveTime)
+        limits.moveTime = std::max<int64_t>(1, limits.moveTime - MOVE_OVERHEAD);
+    else if(time[us] > 0 && !infinite)
+    {
+        // An even share of the remaining time plus most of the increment, never more than is on the clock
+        int64_t budget = time[us] / (movesToGo > 0 ? movesToGo + 1 : 30) + increment[us] * 3 / 4;
+        limits.moveTime = std::max<int64_t>(1, std::min(budget, time[us] - MOVE_OVERHEAD));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(outputMutex);
+        holdBestMove = infinite || limits.ponder;
+        bestMovePending = false;
+    }
+    engine->go(pos, limits);
+}
+
+void setOption(std::istringstream &input) {
+    std::string token, name, value;
+    input >> token;
+    while(input >> token && token != "value")
+        name += (name.empty() ? "" : " ") + token;
+    while(input >> token)
+        value += (value.empty() ? "" : " ") + token;
+
+    if(name == "Hash")
+        engine->setHashSize(std::max<size_t>(1, std::min<size_t>(MAX_HASH, std::strtoul(value.c_str(), nullptr, 10))));
+    else if(name == "Threads")
+        engine->setThreads(std::max(1, std::min(MAX_THREADS, std::atoi(value.c_str()))));
+    else if(name == "Clear Hash")
+        engine->clearHash();
+    else if(name == "EvalFile")
+    {
+        if(value.empty() || value == "<empty>")
+            return;
+        // The weights and kernels are swapped under the feet of a running search otherwise
+        engine->waitUntilIdle();
+        bool loaded = nnueLoad(value.c_str());
+        std::lock_guard<std::mutex> lock(outputMutex);
+        if(loaded)
+            send(std::string("info string NNUE evaluation using ") + value + " (" + nnueKernels() + ")");
+        else
+            send("info string failed to load " + value + ", using the classical evaluation");
+    }
+    else if(name != "Ponder")
+    {
+        std::lock_guard<std::mutex> lock(outputMutex);
+        send("info string unknown option " + name);
+    }
+}
+
+void ioLoop() {
+    Position *pos = new Position();
+    std::string line;
+    while(!quit && std::getline(std::cin, line))
+    {
+        std::istringstream input(line);
+        std::string command;
+        input >> command;
+        if(command == "uci")
+        {
+            std::lock_guard<std::mutex> lock(outputMutex);
+            send("id name rg_3d_sah");
+            send("id author aca");
+            send("option name Hash type spin default " + std::to_string(DEFAULT_HASH) + " min 1 max " + std::to_string(MAX_HASH));
+            send("option name Threads type spin default 1 min 1 max " + std::to_string(MAX_THREADS));
+            send("option name Clear Hash type button");
+            send("option name Ponder type check default false");
+            send("option name EvalFile type string default <empty>");
+            send("uciok");
+        }
+        else if(command == "isready")
+        {
+            std::lock_guard<std::mutex> lock(outputMutex);
+            send("readyok");
+        }
+        else if(command == "ucinewgame")
+            engine->clearHash();
+        else if(command == "position")
+            setPosition(*pos, input);
+        else if(command == "go")
+            go(*pos, input);
+        else if(command == "stop")
+        {
+            engine->stop();
+            releaseBestMove();
+        }
+        else if(command == "ponderhit")
+        {
+            engine->ponderhit();
+            releaseBestMove();
+        }
+        else if(command == "setoption")
+            setOption(input);
+        else if(command == "quit")
+            break;
+    }
+    engine->stop();
+    quit = true;
+    delete pos;
+}
+
+int main() {
+    std::ios::sync_with_stdio(false);
+    // Reading std::cin would flush std::cout from the io thread without the output lock
+    std::cin.tie(nullptr);
+    engine = new Engine(DEFAULT_HASH, 1);
+    std::thread io(ioLoop);
+
+    SearchReport report;
+    while(!quit)
+    {
+        if(!engine->poll(report))
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(outputMutex);
+        // A position without moves has no iteration to report, its score still tells mate from stalemate
+        if(!report.finished || !report.pvLength)
+            sendInfo(report);
+        if(!report.finished)
+            continue;
+        if(holdBestMove)
+        {
+            pendingReport = report;
+            bestMovePending = true;
+        }
+        else
+            sendBestMove(report);
+    }
+
+    io.join();
+    delete engine;
+    return 0;
+}